@@ -0,0 +1,126 @@
+/*
+ * @Author: Li RF
+ * @Date: 2025-04-10 10:35:48
+ * @LastEditors: Li RF
+ * @LastEditTime: 2025-04-10 10:35:48
+ * @Description: DFL 解码性能测试：朴素 float 实现（逐 bin 反量化 + expf）与 dfl_decode_i8 对比
+ *               数据为 640x640 输入的 8400 个 cell，分别测试 NCHW（bin 跨平面）与 bin 连续两种布局
+ *               不依赖 NPU 和 OpenCV，可在 x86 开发机上直接编译运行（x86 上向量版本退化为标量参考实现）
+ * Email: 1125962926@qq.com
+ * Copyright (c) 2025 Li RF, All Rights Reserved.
+ */
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include "postprocess_simd.h"
+
+#define REG_MAX 16
+
+/************************************** 朴素实现（仅用于对比） *******************************************/
+static void naive_dfl_i8(const int8_t *bins, int plane_stride, int32_t zp, float scale, float *dist)
+{
+    for (int e = 0; e < 4; e++)
+    {
+        float v[REG_MAX];
+        float vmax = -INFINITY;
+        for (int k = 0; k < REG_MAX; k++)
+        {
+            v[k] = ((float)bins[(e * REG_MAX + k) * plane_stride] - (float)zp) * scale;
+            vmax = std::max(vmax, v[k]);
+        }
+        float sum = 0.f;
+        for (int k = 0; k < REG_MAX; k++)
+        {
+            v[k] = expf(v[k] - vmax);
+            sum += v[k];
+        }
+        float acc = 0.f;
+        for (int k = 0; k < REG_MAX; k++)
+            acc += v[k] / sum * k;
+        dist[e] = acc;
+    }
+}
+
+template <typename Func>
+static double time_us(int iters, Func &&func)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iters; i++)
+        func();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::micro>(end - start).count() / iters;
+}
+
+/************************************** 测试 *******************************************/
+int main()
+{
+    const int cells = 80 * 80 + 40 * 40 + 20 * 20;
+    const int32_t zp = -10;
+    const float scale = 0.1f;
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int> q(-128, 127);
+
+    // NCHW：同一 cell 的 64 个 bin 间隔 cells；连续：每个 cell 的 64 个 bin 相邻
+    std::vector<int8_t> nchw(cells * 4 * REG_MAX), packed(cells * 4 * REG_MAX);
+    for (int c = 0; c < cells; c++)
+    {
+        for (int k = 0; k < 4 * REG_MAX; k++)
+        {
+            int8_t v = (int8_t)q(rng);
+            nchw[k * cells + c] = v;
+            packed[c * 4 * REG_MAX + k] = v;
+        }
+    }
+    float exp_lut[256];
+    build_dfl_exp_lut(exp_lut, scale);
+
+    std::vector<float> ref(cells * 4), out(cells * 4);
+    for (int c = 0; c < cells; c++)
+        naive_dfl_i8(nchw.data() + c, cells, zp, scale, &ref[c * 4]);
+    auto max_err = [&](const std::vector<float> &expect) {
+        float err = 0.f;
+        for (int i = 0; i < cells * 4; i++)
+            err = std::max(err, fabsf(out[i] - expect[i]));
+        return err;
+    };
+
+    const int iters = 20;
+    printf("isa: %s, cells: %d, reg_max: %d\n", postprocess_simd_isa(), cells, REG_MAX);
+    printf("%-28s %12s %12s\n", "kernel", "time (us)", "max err");
+
+    double t = time_us(iters, [&]() {
+        for (int c = 0; c < cells; c++)
+            naive_dfl_i8(nchw.data() + c, cells, zp, scale, &out[c * 4]);
+    });
+    printf("%-28s %12.1f %12.2e\n", "naive float, NCHW", t, max_err(ref));
+
+    t = time_us(iters, [&]() {
+        for (int c = 0; c < cells; c++)
+            dfl_decode_i8_ref(nchw.data() + c, cells, REG_MAX, exp_lut, &out[c * 4]);
+    });
+    printf("%-28s %12.1f %12.2e\n", "dfl_decode_i8_ref, NCHW", t, max_err(ref));
+
+    t = time_us(iters, [&]() {
+        for (int c = 0; c < cells; c++)
+            dfl_decode_i8(nchw.data() + c, cells, REG_MAX, exp_lut, &out[c * 4]);
+    });
+    printf("%-28s %12.1f %12.2e\n", "dfl_decode_i8, NCHW", t, max_err(ref));
+
+    t = time_us(iters, [&]() {
+        for (int c = 0; c < cells; c++)
+            naive_dfl_i8(packed.data() + c * 4 * REG_MAX, 1, zp, scale, &out[c * 4]);
+    });
+    printf("%-28s %12.1f %12.2e\n", "naive float, packed", t, max_err(ref));
+
+    t = time_us(iters, [&]() {
+        for (int c = 0; c < cells; c++)
+            dfl_decode_i8(packed.data() + c * 4 * REG_MAX, 1, REG_MAX, exp_lut, &out[c * 4]);
+    });
+    printf("%-28s %12.1f %12.2e\n", "dfl_decode_i8, packed", t, max_err(ref));
+    return 0;
+}
@@ -0,0 +1,134 @@
+/*
+ * @Author: Li RF
+ * @Date: 2025-04-14 14:20:05
+ * @LastEditors: Li RF
+ * @LastEditTime: 2025-04-14 14:20:05
+ * @Description: 调度测试：用模拟后端代替 rkYolo，对比轮询与负载感知分配的 FPS、延迟和各上下文 / 核心的计数
+ *               每个模拟核心同一时刻只运行一帧（互斥锁），推理耗时按核心配置；
+ *               之后的后处理在 CPU 上进行，按一定概率卡顿（模拟大量候选框的 NMS、绘制耗时长等）
+ *               用法：dispatch_benchmark [各核心耗时 ms，如 8,8,20] [上下文数] [帧数] [卡顿概率] [卡顿 ms]
+ *               不依赖 NPU，可在 x86 开发机上直接编译运行（线程池头文件引用了 OpenCV 的类型）
+ * Email: 1125962926@qq.com
+ * Copyright (c) 2025 Li RF, All Rights Reserved.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "SharedTypes.hpp"
+#include "rknnPool.hpp"
+
+/* 模拟后端的参数 */
+static double core_latency_ms[NPU_CORE_NUM] = {8, 8, 8};
+static double post_ms = 3;
+static double stall_prob = 0.05;
+static double stall_ms = 30;
+static std::mutex core_mtx[NPU_CORE_NUM];
+
+typedef std::vector<int> SimFrame;
+
+/* 模拟模型：接口与 rkYolo 一致，初始化时与 rkYolo 相同地通过 npu_core_assign 绑定核心 */
+class SimModel
+{
+public:
+    SimModel(const AppConfig &config) {}
+    ~SimModel() { npu_core_release(core); }
+
+    int init(int *ctx_in, bool share_weight)
+    {
+        static std::atomic<int> instances(0);
+        timeline.begin = std::chrono::steady_clock::now();
+        core = npu_core_assign();
+        rng.seed(1234 + instances++);
+        timeline.loaded = timeline.queried = timeline.warmed = std::chrono::steady_clock::now();
+        return 0;
+    }
+    int *get_pctx() { return &ctx; }
+    unsigned get_core_mask() const { return 1u << core; }
+    const StartupTimeline &get_timeline() const { return timeline; }
+
+    SimFrame infer(SimFrame frame)
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        {
+            // NPU：同一核心上的上下文排队执行
+            std::lock_guard<std::mutex> core_lock(core_mtx[core]);
+            sleep_ms(core_latency_ms[core]);
+        }
+        std::uniform_real_distribution<double> u(0, 1);
+        sleep_ms(post_ms + (u(rng) < stall_prob ? stall_ms : 0));
+        return frame;
+    }
+    SimFrame flush() { return SimFrame(); }
+
+private:
+    int ctx = 0;
+    int core = 0;
+    StartupTimeline timeline;
+    std::mutex mtx;
+    std::mt19937 rng;
+
+    static void sleep_ms(double ms)
+    {
+        std::this_thread::sleep_for(std::chrono::microseconds((long long)(ms * 1000)));
+    }
+};
+
+/**
+ * @Description: 按 main.cpp 的方式送帧：持续 put，队列达到一定深度后每 put 一帧 get 一帧
+ */
+static void run(int policy, int contexts, int frames)
+{
+    AppConfig config;
+    config.threads = contexts;
+    config.dispatch = policy;
+    rknnPool<SimModel, SimFrame, SimFrame> pool(config);
+    if (pool.init() != 0) {
+        printf("init failed\n");
+        return;
+    }
+    int depth = contexts * 2;
+    int pending = 0;
+    SimFrame out;
+    for (int i = 0; i < frames; i++)
+    {
+        SimFrame frame(1, i);
+        pool.put(frame);
+        if (++pending >= depth && pool.get(out) == 0)
+            pending--;
+    }
+    while (pool.get(out) == 0)
+        ;
+    pool.report();
+    printf("\n");
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 1) {
+        std::stringstream ss(argv[1]);
+        std::string item;
+        for (int i = 0; i < NPU_CORE_NUM && std::getline(ss, item, ','); i++)
+            core_latency_ms[i] = atof(item.c_str());
+    }
+    int contexts = argc > 2 ? atoi(argv[2]) : 6;
+    int frames = argc > 3 ? atoi(argv[3]) : 600;
+    if (argc > 4)
+        stall_prob = atof(argv[4]);
+    if (argc > 5)
+        stall_ms = atof(argv[5]);
+
+    printf("core latency: %.1f/%.1f/%.1f ms, post: %.1f ms, stall: %.0f%% x %.1f ms, contexts: %d, frames: %d\n\n",
+           core_latency_ms[0], core_latency_ms[1], core_latency_ms[2], post_ms, stall_prob * 100, stall_ms, contexts,
+           frames);
+    run(DISPATCH_POLICY::DISPATCH_ROUND_ROBIN, contexts, frames);
+    run(DISPATCH_POLICY::DISPATCH_LEAST_LOADED, contexts, frames);
+    return 0;
+}
@@ -0,0 +1,224 @@
+/*
+ * @Author: Li RF
+ * @Date: 2025-04-12 15:08:21
+ * @LastEditors: Li RF
+ * @LastEditTime: 2025-04-12 15:08:21
+ * @Description: 原生输出布局测试：把 NCHW 输出转换为 NC1HWC2（C2 = 16）和原生 NHWC，
+ *               分别用 NCHW 解码器和原生布局解码器做完整后处理，检查检测结果逐字节一致并对比耗时；
+ *               NCHW 一行另外给出 NC1HWC2 -> NCHW 的转换耗时，即零拷贝输出省掉的部分
+ *               YOLOv5 / YOLOv8 / YOLOv8 + score_sum 三种检测头，640x640 输入、80 类
+ *               可以传入录制的输出张量目录：out0.bin ~ outN.bin 为 rknn_outputs_get（want_float = 0）得到的
+ *               int8 NCHW 数据，quant.txt 每行一个输出的 "zp scale"，没有时使用 -128 / 0.0039
+ *               不依赖 NPU 和 OpenCV，可在 x86 开发机上直接编译运行
+ * Email: 1125962926@qq.com
+ * Copyright (c) 2025 Li RF, All Rights Reserved.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "head_decoder.h"
+#include "postprocess.h"
+
+#define IN_H 640
+#define IN_W 640
+#define NUM_CLASS 80
+#define REG_MAX 16
+/* RK3588 int8 输出的 C2 */
+#define NATIVE_C2 16
+
+/**
+ * @Description: NCHW 转为 NC1HWC2，不足一组的通道补 0；c2 不小于 c 时即为原生 NHWC（通道步长 c2）
+ */
+static std::vector<int8_t> nchw_to_native(const std::vector<int8_t> &src, int c, int h, int w, int c2)
+{
+    int grid_len = h * w;
+    int c1 = (c + c2 - 1) / c2;
+    std::vector<int8_t> dst((size_t)c1 * grid_len * c2, 0);
+    for (int ch = 0; ch < c; ch++)
+        for (int cell = 0; cell < grid_len; cell++)
+            dst[((size_t)(ch / c2) * grid_len + cell) * c2 + ch % c2] = src[(size_t)ch * grid_len + cell];
+    return dst;
+}
+
+/**
+ * @Description: NC1HWC2 转回 NCHW，模拟 rknn_outputs_get 在 NCHW 输出模式下额外做的转换
+ */
+static void native_to_nchw(const int8_t *src, int c, int h, int w, int c2, int8_t *dst)
+{
+    int grid_len = h * w;
+    for (int ch = 0; ch < c; ch++)
+    {
+        const int8_t *s = src + (size_t)(ch / c2) * grid_len * c2 + ch % c2;
+        int8_t *d = dst + (size_t)ch * grid_len;
+        for (int cell = 0; cell < grid_len; cell++)
+            d[cell] = s[cell * c2];
+    }
+}
+
+/**
+ * @Description: 生成模拟输出：背景分数低于 BOX_THRESH，随机放置若干目标（所有通道取随机值）
+ */
+static std::vector<int8_t> make_tensor(std::mt19937 &rng, int c, int h, int w, int objects, int group)
+{
+    std::uniform_int_distribution<int> low(-128, -80), any(-128, 127);
+    std::vector<int8_t> t((size_t)c * h * w);
+    for (auto &v : t)
+        v = (int8_t)low(rng);
+    int grid_len = h * w;
+    for (int k = 0; k < objects; k++)
+    {
+        // group 个通道为一个预测单元（YOLOv5 为 85，其余为整个张量）
+        int a = rng() % (c / group);
+        int cell = rng() % grid_len;
+        for (int ch = 0; ch < group; ch++)
+            t[(size_t)(a * group + ch) * grid_len + cell] = (int8_t)any(rng);
+    }
+    return t;
+}
+
+/**
+ * @Description: 读取录制的输出张量，文件大小必须与形状一致
+ */
+static bool load_recorded(const std::string &dir, std::vector<head_tensor_t> &shapes, std::vector<std::vector<int8_t>> &data)
+{
+    std::ifstream quant(dir + "/quant.txt");
+    for (size_t i = 0; i < shapes.size(); i++)
+    {
+        std::ifstream f(dir + "/out" + std::to_string(i) + ".bin", std::ios::binary);
+        if (!f)
+            return false;
+        data[i].resize((size_t)shapes[i].c * shapes[i].h * shapes[i].w);
+        f.read(reinterpret_cast<char *>(data[i].data()), data[i].size());
+        if (f.gcount() != (std::streamsize)data[i].size())
+            return false;
+        if (quant)
+            quant >> shapes[i].zp >> shapes[i].scale;
+    }
+    return true;
+}
+
+template <typename Func>
+static double time_us(int iters, Func &&func)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iters; i++)
+        func();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::micro>(end - start).count() / iters;
+}
+
+/**
+ * @Description: 运行一种检测头：NCHW / NC1HWC2 / NHWC 三种布局的结果必须一致
+ * @param {int} per: 每个步幅的输出数（YOLOv5 为 1）
+ */
+static void run_head(const char *name, bool yolov5, int per, const char *dir)
+{
+    std::vector<head_tensor_t> shapes;
+    for (int s = 0; s < 3; s++)
+    {
+        int h = IN_H / (8 << s), w = IN_W / (8 << s);
+        if (yolov5)
+            shapes.push_back({3 * (5 + NUM_CLASS), h, w, -128, 0.0039f});
+        else
+        {
+            shapes.push_back({4 * REG_MAX, h, w, -128, 0.0039f});
+            shapes.push_back({NUM_CLASS, h, w, -128, 0.0039f});
+            if (per == 3)
+                shapes.push_back({1, h, w, -128, 0.0039f});
+        }
+    }
+
+    std::vector<std::vector<int8_t>> nchw(shapes.size());
+    bool recorded = dir != nullptr && load_recorded(dir, shapes, nchw);
+    if (!recorded)
+    {
+        std::mt19937 rng(per);
+        for (size_t i = 0; i < shapes.size(); i++)
+            nchw[i] = make_tensor(rng, shapes[i].c, shapes[i].h, shapes[i].w, 60, yolov5 ? 5 + NUM_CLASS : shapes[i].c);
+        // score_sum 与类别分支保持一致，避免把目标筛掉
+        if (!yolov5 && per == 3)
+        {
+            for (int b = 0; b < 3; b++)
+            {
+                const std::vector<int8_t> &score = nchw[b * 3 + 1];
+                std::vector<int8_t> &sum = nchw[b * 3 + 2];
+                int grid_len = shapes[b * 3].h * shapes[b * 3].w;
+                for (int cell = 0; cell < grid_len; cell++)
+                {
+                    int8_t m = -128;
+                    for (int k = 0; k < NUM_CLASS; k++)
+                        m = std::max(m, score[(size_t)k * grid_len + cell]);
+                    sum[cell] = m;
+                }
+            }
+        }
+    }
+
+    // 三种布局
+    const int layouts[3] = {1, NATIVE_C2, 0};
+    const char *layout_names[3] = {"nchw", "nc1hwc2", "nhwc"};
+    std::vector<std::vector<int8_t>> data[3];
+    std::unique_ptr<HeadDecoder> decoders[3];
+    for (int l = 0; l < 3; l++)
+    {
+        std::vector<head_tensor_t> tensors = shapes;
+        for (size_t i = 0; i < tensors.size(); i++)
+        {
+            // 原生 NHWC 的通道步长按 16 对齐
+            int c2 = layouts[l] != 0 ? layouts[l] : (shapes[i].c + 15) / 16 * 16;
+            tensors[i].c2 = c2;
+            data[l].push_back(c2 == 1 ? nchw[i] : nchw_to_native(nchw[i], shapes[i].c, shapes[i].h, shapes[i].w, c2));
+        }
+        decoders[l] = create_head_decoder(tensors, IN_H, IN_W, yolov5 ? "head=yolov5" : "head=yolov8", false, false);
+    }
+
+    printf("== %s (%s tensors) ==\n", name, recorded ? "recorded" : "synthetic");
+    // rknn_outputs_get 的布局转换耗时
+    std::vector<std::vector<int8_t>> converted = nchw;
+    double t_convert = time_us(50, [&]() {
+        for (size_t i = 0; i < shapes.size(); i++)
+            native_to_nchw(data[1][i].data(), shapes[i].c, shapes[i].h, shapes[i].w, NATIVE_C2, converted[i].data());
+    });
+    if (converted != nchw)
+        printf("native_to_nchw mismatch\n");
+
+    printf("%10s %14s %12s %10s %8s\n", "layout", "convert (us)", "post (us)", "objects", "match");
+    BOX_RECT pads = {0, 0, 0, 0};
+    detect_result_group_t results[3];
+    PostprocessWorkspace ws;
+    for (int l = 0; l < 3; l++)
+    {
+        ws.init(decoders[l]->max_candidates(), decoders[l]->max_survivors());
+        std::vector<int8_t *> outs;
+        for (auto &t : data[l])
+            outs.push_back(t.data());
+        post_process(decoders[l].get(), outs.data(), BOX_THRESH, NMS_THRESH, pads, 1.f, 1.f, 0, &ws, &results[l]);
+        double t = time_us(200, [&]() {
+            post_process(decoders[l].get(), outs.data(), BOX_THRESH, NMS_THRESH, pads, 1.f, 1.f, 0, &ws, &results[l]);
+        });
+        bool match = memcmp(&results[0], &results[l], sizeof(detect_result_group_t)) == 0;
+        printf("%10s %14.1f %12.1f %10d %8s\n", layout_names[l], l == 0 ? t_convert : 0.0, t, results[l].count,
+               match ? "yes" : "NO");
+    }
+}
+
+int main(int argc, char **argv)
+{
+    // 录制的张量只对应一种检测头，按第一个参数选择：v5 / v8 / v8sum
+    const char *head = argc > 1 ? argv[1] : nullptr;
+    const char *dir = argc > 2 ? argv[2] : nullptr;
+    if (head == nullptr || strcmp(head, "v5") == 0)
+        run_head("yolov5", true, 1, dir);
+    if (head == nullptr || strcmp(head, "v8") == 0)
+        run_head("yolov8", false, 2, dir);
+    if (head == nullptr || strcmp(head, "v8sum") == 0)
+        run_head("yolov8 + score_sum", false, 3, dir);
+    return 0;
+}
@@ -0,0 +1,189 @@
+/*
+ * @Author: Li RF
+ * @Date: 2025-04-17 15:40:26
+ * @LastEditors: Li RF
+ * @LastEditTime: 2025-04-17 15:40:26
+ * @Description: replay 后端测试：回放录制的输出张量（--record 录制），做完整的解码 + NMS，
+ *               打印每帧后处理耗时和检测结果的摘要（改动后处理后摘要应保持不变），
+ *               并按设定的模拟推理耗时对比同步与异步（提交 / 等待与后处理重叠）的帧率
+ *               用法：replay_benchmark [录制目录] [帧数] [模拟推理耗时 ms]
+ *               不给目录时先生成一份合成的 YOLOv5 录制（640x640、80 类）
+ *               不依赖 NPU，可在 x86 开发机上直接编译运行
+ * Email: 1125962926@qq.com
+ * Copyright (c) 2025 Li RF, All Rights Reserved.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "head_decoder.h"
+#include "inference_backend.h"
+#include "postprocess.h"
+
+#define SYNTH_DIR "/tmp/replay_synthetic"
+#define SYNTH_FRAMES 8
+#define IN_SIZE 640
+#define NUM_CLASS 80
+
+/* 合成后端：背景分数低于 BOX_THRESH，每帧随机放置若干目标，只用于生成录制 */
+class SyntheticBackend : public InferenceBackend
+{
+public:
+    const char *name() const override { return "synthetic"; }
+    int init(InferenceBackend *first, bool verbose) override
+    {
+        width = height = IN_SIZE;
+        channel = 3;
+        for (int s = 0; s < 3; s++)
+        {
+            int g = IN_SIZE / (8 << s);
+            outputs.push_back({3 * (5 + NUM_CLASS), g, g, -128, 1.f / 255});
+            output_bytes.push_back((size_t)3 * (5 + NUM_CLASS) * g * g);
+        }
+        custom_string = "head=yolov5";
+        return 0;
+    }
+    int run(InputBuffer &buf, int8_t **out) override
+    {
+        std::uniform_int_distribution<int> low(-128, -80), any(-128, 127);
+        data.resize(outputs.size());
+        for (size_t i = 0; i < outputs.size(); i++)
+        {
+            const head_tensor_t &t = outputs[i];
+            int grid_len = t.h * t.w, group = 5 + NUM_CLASS;
+            data[i].resize(output_bytes[i]);
+            for (auto &v : data[i])
+                v = (int8_t)low(rng);
+            for (int k = 0; k < 20; k++)
+            {
+                int a = rng() % 3, cell = rng() % grid_len;
+                for (int ch = 0; ch < group; ch++)
+                    data[i][(size_t)(a * group + ch) * grid_len + cell] = (int8_t)any(rng);
+            }
+            out[i] = data[i].data();
+        }
+        return 0;
+    }
+
+private:
+    std::mt19937 rng{7};
+    std::vector<std::vector<int8_t>> data;
+};
+
+static int synthesize(const char *dir)
+{
+    SyntheticBackend backend;
+    backend.init(nullptr, false);
+    if (record_meta(dir, backend) != 0)
+        return -1;
+    HostInputBuffer buf(IN_SIZE, IN_SIZE, 3);
+    std::vector<int8_t *> outs(backend.get_outputs().size());
+    for (int f = 0; f < SYNTH_FRAMES; f++)
+    {
+        backend.run(buf, outs.data());
+        if (record_frame(dir, backend, outs.data()) != 0)
+            return -1;
+    }
+    return 0;
+}
+
+/**
+ * @Description: FNV-1a，累加一帧的检测结果
+ */
+static uint64_t digest(uint64_t h, const detect_result_group_t &group)
+{
+    auto mix = [&h](const void *p, size_t n) {
+        for (size_t i = 0; i < n; i++)
+            h = (h ^ ((const uint8_t *)p)[i]) * 1099511628211ull;
+    };
+    for (int i = 0; i < group.count; i++)
+    {
+        const detect_result_t &r = group.results[i];
+        int prop = (int)(r.prop * 10000);
+        mix(r.name, strlen(r.name));
+        mix(&r.box, sizeof(r.box));
+        mix(&prop, sizeof(prop));
+    }
+    return h;
+}
+
+int main(int argc, char **argv)
+{
+    std::string dir = argc > 1 ? argv[1] : "";
+    int frames = argc > 2 ? atoi(argv[2]) : 200;
+    double latency = argc > 3 ? atof(argv[3]) : 10;
+    if (dir.empty()) {
+        dir = SYNTH_DIR;
+        if (synthesize(SYNTH_DIR) != 0)
+            return -1;
+        printf("synthetic recording: %s (%d frames)\n", SYNTH_DIR, SYNTH_FRAMES);
+    }
+
+    AppConfig config;
+    config.backend = BACKEND_TYPE::BACKEND_REPLAY;
+    config.model_path = dir;
+    config.replay_latency = latency;
+    std::unique_ptr<InferenceBackend> backend = create_replay_backend(config);
+    if (backend->init(nullptr, true) != 0)
+        return -1;
+    std::unique_ptr<HeadDecoder> decoder =
+        create_head_decoder(backend->get_outputs(), backend->get_input_height(), backend->get_input_width(),
+                            backend->get_custom_string().c_str(), false, true);
+    if (!decoder)
+        return -1;
+    PostprocessWorkspace ws;
+    ws.init(decoder->max_candidates(), decoder->max_survivors());
+    std::unique_ptr<InputBuffer> buf = backend->create_input_buffer(false);
+    buf->update_letterbox(buf->get_width(), buf->get_height());
+    std::vector<int8_t *> outs(backend->get_outputs().size());
+
+    auto post = [&](uint64_t &h, long long &objects) {
+        detect_result_group_t group;
+        post_process(decoder.get(), outs.data(), BOX_THRESH, NMS_THRESH, buf->get_pads(), buf->get_scale(),
+                     buf->get_scale(), NMS_MODE::NMS_AUTO, &ws, &group);
+        h = digest(h, group);
+        objects += group.count;
+    };
+
+    // 同步：推理与后处理串行，单独统计后处理耗时
+    uint64_t h_sync = 14695981039346656037ull;
+    long long objects = 0;
+    double post_us = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int f = 0; f < frames; f++)
+    {
+        backend->run(*buf, outs.data());
+        auto t0 = std::chrono::steady_clock::now();
+        post(h_sync, objects);
+        post_us += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count();
+    }
+    double sync_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // 异步：与 rkYolo::infer_async 相同，提交下一帧后再处理上一帧
+    uint64_t h_async = 14695981039346656037ull;
+    long long objects_async = 0;
+    // 单独加载一份录制，从第一帧开始回放，摘要应与同步一致
+    std::unique_ptr<InferenceBackend> async_backend = create_replay_backend(config);
+    async_backend->init(nullptr, false);
+    start = std::chrono::steady_clock::now();
+    async_backend->submit(*buf);
+    for (int f = 0; f < frames; f++)
+    {
+        async_backend->collect(outs.data());
+        if (f + 1 < frames)
+            async_backend->submit(*buf);
+        post(h_async, objects_async);
+    }
+    double async_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    printf("frames: %d, simulated inference: %.1f ms, post_process: %.1f us/frame, objects: %lld\n", frames, latency,
+           post_us / frames, objects);
+    printf("sync FPS: %.1f, async FPS: %.1f\n", frames / sync_s, frames / async_s);
+    printf("detection digest: %016llx%s\n", (unsigned long long)h_sync,
+           h_async == h_sync ? "" : " (async mismatch)");
+    return 0;
+}
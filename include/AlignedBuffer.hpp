@@ -0,0 +1,66 @@
+/*
+ * @Author: Li RF
+ * @Date: 2025-04-08 09:41:20
+ * @LastEditors: Li RF
+ * @LastEditTime: 2025-04-08 09:41:20
+ * @Description: 按缓存行对齐的定长缓冲区，用于后处理中需要预分配、跨帧复用的数组
+ * Email: 1125962926@qq.com
+ * Copyright (c) 2025 Li RF, All Rights Reserved.
+ */
+#ifndef ALIGNEDBUFFER_H
+#define ALIGNEDBUFFER_H
+
+#include <stdlib.h>
+#include <cstddef>
+#include <new>
+
+#include "alloc_trace.h"
+
+/* 缓存行大小（Cortex-A76/A55 均为 64 字节） */
+#define CACHE_LINE_SIZE 64
+
+template <typename T>
+class AlignedBuffer
+{
+public:
+    AlignedBuffer() = default;
+    ~AlignedBuffer() { free(ptr_); }
+
+    // 独占内存，禁止拷贝
+    AlignedBuffer(const AlignedBuffer &) = delete;
+    AlignedBuffer &operator=(const AlignedBuffer &) = delete;
+
+    /**
+     * @Description: 分配 count 个元素，容量足够时不重新分配（内容不保留、不初始化）
+     * @param {size_t} count: 元素数量
+     * @return {*}
+     */
+    void reserve(size_t count)
+    {
+        if (count <= capacity_)
+            return;
+        free(ptr_);
+        ptr_ = nullptr;
+        capacity_ = 0;
+        // 大小向上取整到缓存行，避免相邻缓冲区共享缓存行
+        size_t bytes = (count * sizeof(T) + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE * CACHE_LINE_SIZE;
+        void *p = nullptr;
+        if (posix_memalign(&p, CACHE_LINE_SIZE, bytes) != 0)
+            throw std::bad_alloc();
+        ALLOC_TRACE_NOTE();
+        ptr_ = static_cast<T *>(p);
+        capacity_ = count;
+    }
+
+    T *data() { return ptr_; }
+    const T *data() const { return ptr_; }
+    size_t capacity() const { return capacity_; }
+    T &operator[](size_t i) { return ptr_[i]; }
+    const T &operator[](size_t i) const { return ptr_[i]; }
+
+private:
+    T *ptr_ = nullptr;
+    size_t capacity_ = 0;
+};
+
+#endif // ALIGNEDBUFFER_H
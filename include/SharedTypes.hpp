@@ -11,6 +11,7 @@
 #define SHAREDTYPES_H
 
 #include <string>
+#include <chrono>
 using namespace std;
 
 /* NPU 数量 */
@@ -31,6 +32,77 @@ enum READ_ENGINE {
     EN_OPENCV = 2,
 };
 
+enum NMS_MODE {
+    NMS_AUTO = 0,   // 根据候选框数量自动选择
+    NMS_GREEDY = 1, // 贪心 top-K NMS
+    NMS_GRID = 2,   // 空间哈希 NMS，适合拥挤场景
+};
+
+enum TRACK_MODE {
+    TRACK_OFF = 0,       // 不跟踪
+    TRACK_GREEDY = 1,    // 贪心分配
+    TRACK_HUNGARIAN = 2, // 匈牙利算法分配
+};
+
+enum OUTPUT_MODE {
+    OUT_NCHW = 0,   // rknn_outputs_get 转换为 NCHW 后拷贝
+    OUT_NATIVE = 1, // rknn_set_io_mem 绑定原生布局（NC1HWC2 / NHWC）输出，后处理直接读取
+};
+
+enum CORE_MODE {
+    CORE_THROUGHPUT = 0, // 每个上下文绑定一个核心，轮询分配，吞吐量最高
+    CORE_LATENCY = 1,    // 每个上下文使用全部核心（RKNN_NPU_CORE_0_1_2），单帧延迟最低
+    CORE_MIXED = 2,      // 第一个上下文使用核心 0、1 服务延迟敏感的帧，其余上下文使用核心 2
+};
+
+enum DISPATCH_POLICY {
+    DISPATCH_ROUND_ROBIN = 0,  // 按顺序轮询上下文
+    DISPATCH_LEAST_LOADED = 1, // 交给正在处理的帧最少、所用核心最空闲的上下文
+};
+
+enum BACKEND_TYPE {
+    BACKEND_RKNN = 0,   // NPU 推理
+    BACKEND_CPU = 1,    // OpenCV DNN 运行等价的 ONNX 模型
+    BACKEND_REPLAY = 2, // 回放录制的输出张量，不依赖 NPU
+};
+
+/* 不使用 NPU 的上下文（CPU 后端）的核心掩码，调度时不计入任何核心的负载 */
+const unsigned DISPATCH_CORES_NONE = 0x80000000u;
+
+/* 核心映射模式的名称 */
+inline const char *core_mode_name(int core_mode) {
+    switch (core_mode) {
+    case CORE_MODE::CORE_THROUGHPUT:
+        return "throughput";
+    case CORE_MODE::CORE_LATENCY:
+        return "latency";
+    case CORE_MODE::CORE_MIXED:
+        return "mixed";
+    }
+    return "unknown";
+}
+
+/* 推理后端的名称 */
+inline const char *backend_name(int backend) {
+    switch (backend) {
+    case BACKEND_TYPE::BACKEND_RKNN:
+        return "rknn";
+    case BACKEND_TYPE::BACKEND_CPU:
+        return "cpu";
+    case BACKEND_TYPE::BACKEND_REPLAY:
+        return "replay";
+    }
+    return "unknown";
+}
+
+/* 上下文启动时间线：各阶段结束的时刻，由线程池汇总打印 */
+struct StartupTimeline {
+    std::chrono::steady_clock::time_point begin;   // 开始初始化
+    std::chrono::steady_clock::time_point loaded;  // 模型加载 / 权重共享（dup）完成
+    std::chrono::steady_clock::time_point queried; // 属性查询、解码器与缓冲区准备完成
+    std::chrono::steady_clock::time_point warmed;  // 预热完成，可以接收帧
+};
+
 /* 定义命令行参数结构体 */ 
 struct AppConfig {
     // 在屏幕显示 FPS
@@ -41,14 +113,87 @@ struct AppConfig {
     bool opencl = true;
     // 是否打印命令行参数
     bool verbose = false;
+    // 模型输出为原始 logits（未做 sigmoid），后处理查表时补做 sigmoid
+    bool logits = false;
+    // 零拷贝输入：前处理直接写入 rknn_create_mem 分配的输入张量，默认开启
+    bool zero_copy = true;
+    // 模型内存零拷贝：模型拷贝到 NPU 可直接访问的内存后以 RKNN_FLAG_MODEL_BUFFER_ZERO_COPY 初始化，默认关闭
+    bool model_zero_copy = false;
+    // 异步推理：每个上下文双缓冲，前/后处理与 NPU 运行重叠，结果延迟一帧返回，默认关闭
+    bool async = false;
+    // 动态形状模型：按源图宽高比选择面积最小、不降低分辨率的输入形状，减少 letterbox 填充，默认开启
+    bool dynamic_shape = true;
     // 视频加载引擎，默认为 ffmpeg
     int read_engine = READ_ENGINE::EN_FFMPEG;
     // 输入格式，默认为视频
     int input_format = INPUT_FORMAT::IN_VIDEO;
     // 硬件加速，默认为 RGA
     int accels_2d = ACCELS_2D::ACC_RGA;
+    // NMS 模式，默认为自动
+    int nms_mode = NMS_MODE::NMS_AUTO;
+    // 输出模式，默认为 NCHW
+    int output_mode = OUTPUT_MODE::OUT_NCHW;
+    // NPU 核心映射模式，默认为吞吐量优先
+    int core_mode = CORE_MODE::CORE_THROUGHPUT;
+    // 延迟敏感的视频流：CORE_MIXED 模式下整帧推理固定交给独占核心 0、1 的第一个上下文
+    bool urgent = false;
+    // 帧分配策略，默认为负载感知（异步模式固定为轮询，保证结果顺序）
+    int dispatch = DISPATCH_POLICY::DISPATCH_LEAST_LOADED;
+    // 每个上下文初始化后用合成输入预热的次数，默认为 0（不预热）
+    int warmup = 0;
     // 线程数，默认为1
     int threads = 1;
+    // 分块推理：每帧切成相互重叠的块分别检测后合并，默认关闭
+    bool tiling = false;
+    // 分块的列数和行数，0 表示按模型输入尺寸切块（块数由重叠比例决定）
+    int tile_cols = 0;
+    int tile_rows = 0;
+    // 相邻两块的重叠部分占块边长的比例
+    float tile_overlap = 0.2f;
+    // 分块时追加整帧缩小的一块，找回被切开的大目标
+    bool tile_full = true;
+    // 运动门控：画面没有变化时跳过推理、沿用上一次的结果，每隔 gate_interval 帧强制推理一次，0 为关闭
+    int gate_interval = 0;
+    // 缩小亮度图上亮度差超过 gate_pixel 的像素视为变化
+    int gate_pixel = 12;
+    // 变化像素占比超过 gate_area 视为运动
+    float gate_area = 0.002f;
+    // 平均亮度差超过 gate_scene 视为场景切换
+    float gate_scene = 35.f;
+    // 关键帧检测：只在关键帧上推理，中间帧用光流传播检测框；关键帧间隔按运动和置信度在 1 到 keyframe_interval 之间自适应，0 为关闭
+    int keyframe_interval = 0;
+    // 框的平均位移超过 keyframe_motion 像素/帧时提前推理
+    float keyframe_motion = 8.f;
+    // 传播框的平均置信度低于 keyframe_conf 时提前推理
+    float keyframe_conf = 0.3f;
+    // 多目标跟踪：为检测框分配稳定的轨迹编号，默认关闭
+    int track = TRACK_MODE::TRACK_OFF;
+    // 丢失的轨迹保留的帧数，期间重新出现时沿用原编号
+    int track_buffer = 30;
+    // 二级分类器：对检测框的裁剪图运行的第二个 rknn 模型（车辆类型、颜色、是否戴头盔等），为空时关闭
+    string cls_model = "";
+    // 只对这些类别（逗号分隔）的检测框分类，为空时全部分类
+    string cls_classes = "";
+    // 每帧最多分类的检测框数量
+    int cls_max_crops = 16;
+    // 固定绑定的 NPU 核心，-1 时按 core_mode 绑定；由二级分类器为每个核心的上下文设置，不从命令行读取
+    int npu_core = -1;
+    // 推理后端，默认为 NPU
+    int backend = BACKEND_TYPE::BACKEND_RKNN;
+    // 额外的 CPU 后端上下文数量（使用 cpu_model），NPU 上下文都忙时由调度分配，默认为 0
+    int cpu_contexts = 0;
+    // CPU 上下文使用的 ONNX 模型
+    string cpu_model = "";
+    // 录制推理输出的目录，为空时不录制
+    string record_dir = "";
+    // replay 后端每帧的模拟推理耗时（毫秒）
+    double replay_latency = 0;
+    // 逐层性能分析的帧数，大于 0 时只做分析（--profile），不处理视频
+    int profile_frames = 0;
+    // 分析结果的输出路径（不含扩展名），生成 .csv 和 .json
+    string profile_out = "profile";
+    // 对比两份分析结果："base.csv,test.csv"（--compare）
+    string compare = "";
     // rknn 模型路径
     string model_path = "";
     // 输入源    
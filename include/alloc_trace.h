@@ -0,0 +1,37 @@
+/*
+ * @Author: Li RF
+ * @Date: 2025-04-08 09:41:20
+ * @LastEditors: Li RF
+ * @LastEditTime: 2025-04-08 09:41:20
+ * @Description: 调试用的内存分配计数，cmake 时加 -DALLOC_TRACE=ON 开启
+ *               开启后重载全局 operator new，按线程统计分配次数，用于确认后处理预热后每帧零分配
+ * Email: 1125962926@qq.com
+ * Copyright (c) 2025 Li RF, All Rights Reserved.
+ */
+#ifndef _RKNN_YOLOV5_DEMO_ALLOC_TRACE_H_
+#define _RKNN_YOLOV5_DEMO_ALLOC_TRACE_H_
+
+#include <stdint.h>
+
+/* 预热帧数，之后的帧后处理若仍有分配则打印警告 */
+#define ALLOC_TRACE_WARMUP_FRAMES 3
+
+#ifdef ALLOC_TRACE
+/**
+ * @Description: 当前线程累计的分配次数（operator new 与 AlignedBuffer 的分配）
+ * @return {uint64_t}
+ */
+uint64_t alloc_trace_count();
+
+/**
+ * @Description: 记录一次不经过 operator new 的分配（如 posix_memalign）
+ * @return {*}
+ */
+void alloc_trace_note();
+
+#define ALLOC_TRACE_NOTE() alloc_trace_note()
+#else
+#define ALLOC_TRACE_NOTE()
+#endif
+
+#endif //_RKNN_YOLOV5_DEMO_ALLOC_TRACE_H_
@@ -0,0 +1,112 @@
+/*
+ * @Author: Li RF
+ * @Date: 2025-04-20 10:12:47
+ * @LastEditors: Li RF
+ * @LastEditTime: 2025-04-20 10:12:47
+ * @Description: 关键帧检测：只在关键帧上推理，中间帧用稀疏光流（每个框内少量特征点的金字塔 LK）传播检测框
+ *               关键帧间隔按框的位移和传播后的置信度自适应：运动大、置信度低或跟丢较多时提前推理并缩短间隔，
+ *               稳定时逐步放宽到上限
+ *               每路视频流持有一个实例；reset / propagate 在合并线程中按帧顺序调用，next_keyframe 在主线程调用
+ * Email: 1125962926@qq.com
+ * Copyright (c) 2025 Li RF, All Rights Reserved.
+ */
+#ifndef _RKNN_YOLOV5_DEMO_BOX_PROPAGATOR_H_
+#define _RKNN_YOLOV5_DEMO_BOX_PROPAGATOR_H_
+
+#include <atomic>
+#include <vector>
+
+#include "opencv2/core/core.hpp"
+#include "SharedTypes.hpp"
+#include "postprocess.h"
+
+/* 光流图宽度，高度按源图比例 */
+#define PROPAGATE_WIDTH 640
+/* 每个框选取的特征点数 */
+#define PROPAGATE_POINTS 8
+/* 一个框至少要跟踪到的点数，少于该值视为跟丢 */
+#define PROPAGATE_MIN_POINTS 3
+/* 每传播一帧置信度的衰减系数（全部点都跟踪到时） */
+#define PROPAGATE_DECAY 0.95f
+/* 一帧中跟丢的框超过该比例时提前推理 */
+#define PROPAGATE_LOST_RATIO 0.3f
+
+class BoxPropagator
+{
+public:
+    BoxPropagator(const AppConfig &config);
+
+    /**
+     * @Description: 把一帧缩小为光流用的灰度图，每帧输出到新的 Mat，可以交给合并线程
+     * @param {Mat} &frame: 亮度图（CV_8UC1，如 NV12 的 Y 平面），或 BGR 图像
+     * @param {Mat} &gray: 输出的灰度图，宽度为 PROPAGATE_WIDTH
+     * @return {*}
+     */
+    static void prepare(const cv::Mat &frame, cv::Mat &gray);
+
+    /**
+     * @Description: 决定下一帧是否为关键帧（主线程每提交一帧调用一次）
+     * @return {bool}: true 为关键帧，需要推理
+     */
+    bool next_keyframe();
+
+    /**
+     * @Description: 关键帧：以检测结果为起点，在框内重新选取特征点
+     * @param {Mat} &gray: 该帧的光流灰度图
+     * @param {detect_result_group_t} &group: 该帧的检测结果（源图坐标）
+     * @param {int} src_w, src_h: 源图尺寸
+     * @return {*}
+     */
+    void reset(const cv::Mat &gray, const detect_result_group_t &group, int src_w, int src_h);
+
+    /**
+     * @Description: 中间帧：把上一帧的框按光流移动、缩放，置信度衰减，标记为传播得到
+     * @param {Mat} &gray: 该帧的光流灰度图
+     * @param {int} src_w, src_h: 源图尺寸
+     * @param {detect_result_group_t} *group: 输出的检测结果，跟丢的框不再输出
+     * @return {*}
+     */
+    void propagate(const cv::Mat &gray, int src_w, int src_h, detect_result_group_t *group);
+
+    // 打印关键帧、传播帧数与 NPU 工作量的节省比例
+    void report() const;
+
+private:
+    // 传播中的一个框：源图坐标的浮点框，以及光流图上的特征点
+    struct track_t {
+        detect_result_t det;
+        float x, y, w, h;
+        std::vector<cv::Point2f> points;
+    };
+
+    // 关键帧间隔上限，以及提前推理的运动（源图像素/帧）和置信度阈值
+    int max_interval;
+    float motion_threshold;
+    float conf_threshold;
+
+    // 主线程与合并线程共享：当前关键帧间隔，以及是否需要提前推理
+    std::atomic<int> interval;
+    std::atomic<bool> want_keyframe;
+    // 主线程：距上一个关键帧的帧数
+    int since_keyframe = 0;
+
+    // 合并线程
+    cv::Mat prev;
+    int group_id = 0;
+    std::vector<track_t> tracks;
+    std::vector<cv::Point2f> prev_points, next_points;
+    std::vector<unsigned char> status;
+    std::vector<float> err, dx, dy, ratio;
+    // 当前关键帧区间内的最大位移，以及是否已提前请求推理
+    float span_motion = 0.f;
+    bool span_triggered = false;
+
+    long long keyframes = 0;
+    long long propagated = 0;
+    long long early = 0;
+    long long lost = 0;
+
+    void select_points(const cv::Mat &gray, track_t &track, float sx, float sy);
+};
+
+#endif //_RKNN_YOLOV5_DEMO_BOX_PROPAGATOR_H_
@@ -0,0 +1,98 @@
+/*
+ * @Author: Li RF
+ * @Date: 2025-04-22 09:18:36
+ * @LastEditors: Li RF
+ * @LastEditTime: 2025-04-22 09:18:36
+ * @Description: 二级分类器：检测之后对检测框的裁剪图运行第二个 rknn 模型（车辆类型、颜色、是否戴头盔等）
+ *               一帧的裁剪图缩放后按 NHWC 上下堆叠成一批（模型以 rknn_batch_size 转换），一次推理分摊单次运行的开销；
+ *               每批交给累计耗时最少（空闲时间最多）的 NPU 核心，每个核心一个上下文，共享权重
+ *               每帧分类的框数有上限，优先没有缓存结果的轨迹，其余框沿用该轨迹上一次的分类结果
+ *               每路视频流持有一个实例，在合并线程中按帧顺序调用
+ * Email: 1125962926@qq.com
+ * Copyright (c) 2025 Li RF, All Rights Reserved.
+ */
+#ifndef _RKNN_YOLOV5_DEMO_CLASSIFIER_H_
+#define _RKNN_YOLOV5_DEMO_CLASSIFIER_H_
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "opencv2/core/core.hpp"
+#include "SharedTypes.hpp"
+#include "dispatcher.h"
+#include "inference_backend.h"
+#include "postprocess.h"
+
+/* 宽或高小于该值（源图像素）的框不分类 */
+#define CLS_MIN_SIZE 8
+/* 轨迹的分类结果超过该帧数没有再出现时删除 */
+#define CLS_CACHE_FRAMES 60
+
+class Classifier
+{
+public:
+    Classifier(const AppConfig &config);
+
+    /**
+     * @Description: 为每个 NPU 核心创建一个分类模型的上下文（第一个加载模型，其余共享权重）和批输入缓冲区
+     * @param {Dispatcher} *dispatcher: 检测模型的调度器，用来选择最空闲的核心并计入负载
+     * @return {int}: 0 成功
+     */
+    int init(Dispatcher *dispatcher);
+
+    /**
+     * @Description: 对一帧的检测框分类，结果写入 attr / attr_prop
+     * @param {Mat} &img: BGR 源图
+     * @param {detect_result_group_t} *group: 该帧的检测结果（源图坐标），已分配轨迹编号时按轨迹缓存结果
+     * @return {int}: 本帧分类的框数，小于 0 失败
+     */
+    int classify(const cv::Mat &img, detect_result_group_t *group);
+
+    // 打印分类的框数、批数与平均耗时
+    void report() const;
+
+private:
+    // 一个轨迹最近一次的分类结果
+    struct cached_t {
+        char attr[OBJ_ATTR_MAX_SIZE];
+        float prop;
+        long long frame;
+    };
+
+    AppConfig config;
+    Dispatcher *dispatcher = nullptr;
+    // 每个核心一个上下文，下标为核心编号
+    std::vector<std::unique_ptr<InferenceBackend>> backends;
+    unsigned core_mask = 0;
+    std::unique_ptr<InputBuffer> input;
+    int width = 0, height = 0, batch = 1;
+    // 每个输出的类别数与标签
+    std::vector<int> num_classes;
+    std::vector<std::vector<std::string>> labels;
+    // 只分类这些检测类别，为空时全部分类
+    std::vector<std::string> classes;
+
+    std::unordered_map<int, cached_t> cache;
+    long long frame = 0;
+    // 每帧的临时数据，跨帧复用
+    std::vector<std::pair<float, int>> order;
+    std::vector<int> picked;
+    std::vector<cv::Rect> rects, batch_rects;
+    std::vector<int8_t *> outputs;
+    std::vector<float> probs;
+
+    long long crops = 0;
+    long long batches = 0;
+    long long rga_fallbacks = 0;
+    double total_ms = 0;
+
+    bool wanted(const detect_result_t &det) const;
+    // 把 rects 中的裁剪图写入批输入的前 n 个位置
+    int fill_batch(const cv::Mat &img, int first, int n);
+    // 解码第 slot 个位置的全部输出，写入 det
+    void decode(int slot, detect_result_t &det);
+};
+
+#endif //_RKNN_YOLOV5_DEMO_CLASSIFIER_H_
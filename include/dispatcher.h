@@ -0,0 +1,142 @@
+/*
+ * @Author: Li RF
+ * @Date: 2025-04-14 10:36:52
+ * @LastEditors: Li RF
+ * @LastEditTime: 2025-04-14 10:36:52
+ * @Description: NPU 负载感知调度：记录每个核心、每个上下文正在处理的帧数，
+ *               初始化时把上下文绑定到已绑定上下文最少的核心，推理时把帧交给最空闲的上下文
+ *               不依赖 NPU 和 OpenCV，可以配合模拟后端单独测试
+ * Email: 1125962926@qq.com
+ * Copyright (c) 2025 Li RF, All Rights Reserved.
+ */
+#ifndef _RKNN_YOLOV5_DEMO_DISPATCHER_H_
+#define _RKNN_YOLOV5_DEMO_DISPATCHER_H_
+
+#include <stdint.h>
+#include <mutex>
+#include <vector>
+
+#include "SharedTypes.hpp"
+
+/**
+ * @Description: 为新上下文选择核心：当前绑定上下文最少的核心，数量相同时取编号小的
+ *               替代原来的全局轮询计数，线程池销毁后释放的核心会被优先使用
+ * @return {int}: 核心编号，0 ~ NPU_CORE_NUM-1
+ */
+int npu_core_assign();
+
+/**
+ * @Description: 上下文销毁时归还 npu_core_assign 分配的核心
+ * @param {int} core: 核心编号
+ * @return {*}
+ */
+void npu_core_release(int core);
+
+/* 单个上下文的计数 */
+struct DispatchContextStats
+{
+    unsigned cores = 0;       // 使用的核心（位掩码，bit i 为核心 i）
+    int in_flight = 0;        // 已分配、尚未完成的帧
+    int max_in_flight = 0;    // in_flight 的峰值
+    uint64_t dispatched = 0;  // 累计分配的帧
+    double busy_ms = 0;       // 累计推理耗时
+};
+
+/* 单个 NPU 核心的计数，使用多个核心的上下文按核心数均摊 */
+struct DispatchCoreStats
+{
+    double in_flight = 0;
+    double dispatched = 0;
+    double busy_ms = 0;
+};
+
+class Dispatcher
+{
+public:
+    /**
+     * @param {int} num_contexts: 上下文数量
+     * @param {int} policy: DISPATCH_POLICY
+     */
+    Dispatcher(int num_contexts, int policy);
+
+    /**
+     * @Description: 记录上下文使用的核心，用于按核心汇总负载
+     * @param {int} ctx: 上下文序号
+     * @param {unsigned} cores: 核心位掩码，0 表示由驱动自动选择（按全部核心计），
+     *                           DISPATCH_CORES_NONE 表示不使用 NPU（CPU 后端）
+     * @return {*}
+     */
+    void set_cores(int ctx, unsigned cores);
+
+    /**
+     * @Description: 为一帧选择上下文并计入 in_flight
+     *               DISPATCH_LEAST_LOADED：优先空闲上下文，其次 in_flight 最少的；
+     *               相同时取所用核心负载最轻的，再相同时取最久未分配的
+     *               DISPATCH_ROUND_ROBIN：按顺序轮询
+     * @param {int} first: 可选上下文的起始序号（混合核心模式下跳过保留的上下文）
+     * @return {int}: 上下文序号
+     */
+    int acquire(int first = 0);
+
+    /**
+     * @Description: 指定上下文（例如延迟敏感的帧固定交给保留的上下文），同样计入 in_flight
+     * @param {int} ctx: 上下文序号
+     * @return {int}: ctx
+     */
+    int acquire_fixed(int ctx);
+
+    /**
+     * @Description: 一帧完成，减少 in_flight 并累计耗时
+     * @param {int} ctx: acquire 返回的上下文序号
+     * @param {double} busy_ms: 推理耗时
+     * @return {*}
+     */
+    void release(int ctx, double busy_ms);
+
+    /**
+     * @Description: 上下文之外的 NPU 工作（如二级分类器）选择核心：在 mask 中取 in_flight 最少的核心，
+     *               相同时取累计耗时最少（空闲时间最多）的，并计入该核心的 in_flight，之后检测帧的分配会避开它
+     * @param {unsigned} mask: 可选的核心（位掩码）
+     * @return {int}: 核心编号，mask 为空时返回 -1
+     */
+    int acquire_core(unsigned mask);
+
+    /**
+     * @Description: acquire_core 的工作完成，减少该核心的 in_flight 并累计耗时
+     * @return {*}
+     */
+    void release_core(int core, double busy_ms);
+
+    /**
+     * @Description: 全部上下文按最近一次分配的先后排序（从未分配的在前），结束时按此顺序取出异步模式的最后一帧
+     * @return {std::vector<int>}: 上下文序号
+     */
+    std::vector<int> dispatch_order();
+
+    int num_contexts() const { return (int)contexts.size(); }
+    int get_policy() const { return policy; }
+    // 计数快照
+    std::vector<DispatchContextStats> context_stats();
+    std::vector<DispatchCoreStats> core_stats();
+
+    /**
+     * @Description: 打印每个上下文和核心的计数，用于观察负载是否均衡
+     * @return {*}
+     */
+    void print_stats();
+
+private:
+    std::mutex mtx;
+    int policy;
+    uint64_t sequence = 0;
+    std::vector<DispatchContextStats> contexts;
+    // 每个上下文最近一次分配的序号，负载相同时轮换
+    std::vector<uint64_t> last_dispatch;
+    DispatchCoreStats cores[NPU_CORE_NUM];
+
+    void assign(int ctx);
+    void account(int ctx, double frames, double busy_ms);
+    double core_load(int ctx) const;
+};
+
+#endif //_RKNN_YOLOV5_DEMO_DISPATCHER_H_
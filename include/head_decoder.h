@@ -0,0 +1,169 @@
+/*
+ * @Author: Li RF
+ * @Date: 2025-04-09 14:26:03
+ * @LastEditors: Li RF
+ * @LastEditTime: 2025-04-09 14:26:03
+ * @Description: 检测头解码器：YOLOv5（anchor）与 YOLOv8/YOLO11（anchor-free，DFL 框 + 类别分支）
+ *               在 rkYolo::init 中根据模型的自定义字符串或输出张量的数量、形状选择
+ * Email: 1125962926@qq.com
+ * Copyright (c) 2025 Li RF, All Rights Reserved.
+ */
+#ifndef _RKNN_YOLOV5_DEMO_HEAD_DECODER_H_
+#define _RKNN_YOLOV5_DEMO_HEAD_DECODER_H_
+
+#include <stdint.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "postprocess.h"
+
+/* 默认标签文件，模型自定义字符串中没有标签时使用 */
+#define LABEL_NALE_TXT_PATH "./model/coco_80_labels_list.txt"
+
+/* 检测头类型 */
+enum HEAD_TYPE {
+    HEAD_YOLOV5 = 0, // 3 个输出，每个为 [1, 3 * (5 + 类别数), h, w]
+    HEAD_YOLOV8 = 1  // 每个步幅 2~3 个输出：DFL 框 [1, 4 * reg_max, h, w]、类别 [1, 类别数, h, w]、可选的 score_sum
+};
+
+/* 输出张量的形状（按 NCHW 解释）、内存布局与量化参数 */
+typedef struct _head_tensor_t
+{
+    int c;
+    int h;
+    int w;
+    int32_t zp;
+    float scale;
+    // 通道分组大小：1 为 NCHW（rknn_outputs_get 转换后的布局）；
+    // NC1HWC2 原生布局为 C2；原生 NHWC 为每个 cell 的通道步长（只有一组）
+    int c2 = 1;
+} head_tensor_t;
+
+/* 一个步幅分支的网格 */
+typedef struct _head_branch_t
+{
+    int grid_h;
+    int grid_w;
+    int stride;
+} head_branch_t;
+
+/**
+ * @Description: 编译期特化的解码内核，输入尺寸、步幅、类别数（YOLOv5 还有 anchor）均为模板常量
+ * @param {qnt_lut_t} *luts: 每个输出张量的查找表
+ * @return {int}: 候选框数量
+ */
+typedef int (*head_kernel_t)(int8_t **outputs, const qnt_lut_t *luts, float conf_threshold, PostprocessWorkspace *ws);
+
+class HeadDecoder
+{
+public:
+    virtual ~HeadDecoder() = default;
+
+    virtual const char *name() const = 0;
+
+    /**
+     * @Description: 解码全部输出，候选框写入工作区（模型输入坐标系，(x, y, w, h)）
+     * @param {int8_t} **outputs: 模型输出，顺序与创建时的 tensors 一致
+     * @param {float} conf_threshold: 置信度阈值
+     * @param {PostprocessWorkspace} *ws: 工作区，容量不小于 max_candidates()
+     * @return {int}: 候选框数量
+     */
+    virtual int decode(int8_t **outputs, float conf_threshold, PostprocessWorkspace *ws) = 0;
+
+    int num_classes() const { return num_class; }
+    int input_height() const { return model_in_h; }
+    int input_width() const { return model_in_w; }
+    // 候选框数量上限，用于分配工作区
+    int max_candidates() const { return candidates; }
+    // 预筛选存活下标缓冲区的大小
+    int max_survivors() const { return survivors; }
+    // 空间哈希 NMS 的网格边长，取最大步幅
+    float nms_cell_size() const;
+    const std::vector<head_branch_t> &get_branches() const { return branches; }
+    // 是否使用编译期特化的内核
+    bool specialized() const { return fixed_kernel != nullptr; }
+    // 是否直接读取 NPU 原生布局（NC1HWC2 / NHWC）的输出
+    bool native_layout() const { return native; }
+
+    // 类别标签，下标为类别 id
+    std::vector<std::string> labels;
+
+protected:
+    int model_in_h = 0;
+    int model_in_w = 0;
+    int num_class = 0;
+    int candidates = 0;
+    int survivors = 0;
+    std::vector<head_branch_t> branches;
+    // 每个输出张量的查找表
+    std::vector<qnt_lut_t> luts;
+    // 构造时按模型尺寸选择的特化内核，为空时使用运行时参数的通用实现
+    head_kernel_t fixed_kernel = nullptr;
+    // 每个输出张量的通道分组大小，任一不为 1 时使用原生布局的解码，特化内核只支持 NCHW
+    std::vector<int> channel_groups;
+    bool native = false;
+
+    /**
+     * @Description: 记录每个输出张量的布局
+     * @return {*}
+     */
+    void set_layout(const std::vector<head_tensor_t> &tensors);
+};
+
+/* YOLOv5：每个 cell 3 个 anchor，输出 (x, y, w, h, obj, 类别...) */
+class Yolov5Decoder : public HeadDecoder
+{
+public:
+    /**
+     * @param {vector<int>} &anchors: 每个输出 3 组 (w, h)，为空时使用 YOLOv5 默认 anchor
+     */
+    Yolov5Decoder(const std::vector<head_tensor_t> &tensors, int model_in_h, int model_in_w,
+                  const std::vector<int> &anchors, bool logits);
+    const char *name() const override { return "yolov5"; }
+    int decode(int8_t **outputs, float conf_threshold, PostprocessWorkspace *ws) override;
+
+private:
+    std::vector<int> anchors;
+};
+
+/* YOLOv8 / YOLO11：anchor-free，框为 4 条边的 DFL 分布，类别分支已含 sigmoid */
+class Yolov8Decoder : public HeadDecoder
+{
+public:
+    Yolov8Decoder(const std::vector<head_tensor_t> &tensors, int model_in_h, int model_in_w, bool logits);
+    const char *name() const override { return "yolov8"; }
+    int decode(int8_t **outputs, float conf_threshold, PostprocessWorkspace *ws) override;
+
+private:
+    int reg_max = 16;        // 每条边的 DFL 分布长度
+    int tensors_per_branch;  // 2：框 + 类别；3：再加 score_sum
+};
+
+/**
+ * @Description: 根据模型信息创建解码器
+ *               自定义字符串格式为 "key=value;key=value"，支持的键：
+ *               head=yolov5|yolov8|yolo11、labels=逗号分隔的类别名、anchors=逗号分隔的 18 个整数（仅 YOLOv5）
+ *               未指定 head 时按输出张量数量和形状判断；没有 labels 时读取 LABEL_NALE_TXT_PATH
+ * @param {vector<head_tensor_t>} &tensors: 输出张量
+ * @param {char} *custom_string: RKNN_QUERY_CUSTOM_STRING 的结果，可为空
+ * @param {bool} logits: 类别/置信度输出为原始 logits，需要在查找表中做 sigmoid
+ * @param {bool} verbose: 打印选择结果
+ * @return {unique_ptr<HeadDecoder>}: 无法识别时返回空指针
+ */
+std::unique_ptr<HeadDecoder> create_head_decoder(const std::vector<head_tensor_t> &tensors, int model_in_h,
+                                                 int model_in_w, const char *custom_string, bool logits,
+                                                 bool verbose);
+
+/**
+ * @Description: 按分隔符拆分字符串，去掉首尾空白，忽略空项
+ */
+std::vector<std::string> split_string(const std::string &str, char delim);
+
+/**
+ * @Description: 从 "key=value;key=value" 格式的自定义字符串中取出指定键的值
+ * @return {string}: 不存在时返回空字符串
+ */
+std::string custom_value(const char *custom_string, const std::string &key);
+
+#endif //_RKNN_YOLOV5_DEMO_HEAD_DECODER_H_
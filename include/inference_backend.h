@@ -0,0 +1,149 @@
+/*
+ * @Author: Li RF
+ * @Date: 2025-04-17 09:32:10
+ * @LastEditors: Li RF
+ * @LastEditTime: 2025-04-17 09:32:10
+ * @Description: 推理后端：rkYolo 只负责前处理、后处理和绘制，模型的加载与运行交给后端
+ *               RKNN：NPU 推理（零拷贝输入、原生布局输出、异步、共享权重、核心绑定）；
+ *               CPU：OpenCV DNN 运行等价的 ONNX 模型，输出量化为 int8，复用同一套后处理；
+ *               replay：返回录制的输出张量，延迟可配置，在没有 NPU 的机器上测试前/后处理与调度
+ *               输出统一为 int8 张量 + 每个张量的形状和量化参数（head_tensor_t），检测头解码器不区分后端
+ * Email: 1125962926@qq.com
+ * Copyright (c) 2025 Li RF, All Rights Reserved.
+ */
+#ifndef _RKNN_YOLOV5_DEMO_INFERENCE_BACKEND_H_
+#define _RKNN_YOLOV5_DEMO_INFERENCE_BACKEND_H_
+
+#include <stdint.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "SharedTypes.hpp"
+#include "head_decoder.h"
+#include "input_buffer.h"
+
+/* 输入形状（模型输入坐标系） */
+typedef struct _input_shape_t
+{
+    int width;
+    int height;
+} input_shape_t;
+
+class InferenceBackend
+{
+public:
+    virtual ~InferenceBackend() = default;
+
+    virtual const char *name() const = 0;
+
+    /**
+     * @Description: 加载模型并查询输入输出，完成后 get_input_* / get_outputs 有效
+     * @param {InferenceBackend} *first: 同一线程池的第一个后端（可共享权重、录制数据），自身为第一个时为 nullptr
+     * @param {bool} verbose: 打印模型信息
+     * @return {int}: 0 成功
+     */
+    virtual int init(InferenceBackend *first, bool verbose) = 0;
+
+    /**
+     * @Description: 创建输入缓冲区，默认为普通内存
+     * @return {unique_ptr<InputBuffer>}
+     */
+    virtual std::unique_ptr<InputBuffer> create_input_buffer(bool verbose)
+    {
+        return std::make_unique<HostInputBuffer>(width, height, channel);
+    }
+
+    /**
+     * @Description: 同步推理
+     * @param {InputBuffer} &buf: 已写入当前帧的输入缓冲区
+     * @param {int8_t} **outputs: 每个输出的数据指针，在 release_outputs 或下一次 run 之前有效
+     * @return {int}: 0 成功
+     */
+    virtual int run(InputBuffer &buf, int8_t **outputs) = 0;
+    virtual void release_outputs() {}
+
+    /**
+     * @Description: 异步推理（AppConfig::async）：submit 提交后立即返回，collect 等待完成并取得输出
+     *               collect 得到的输出在下一次 submit 之后、下一次 collect 之前仍然有效，可与下一帧的运行重叠
+     *               不支持的后端 supports_async 返回 false，rkYolo 退回同步推理
+     * @return {int}: 0 成功
+     */
+    virtual bool supports_async() const { return false; }
+    virtual int submit(InputBuffer &buf) { return -1; }
+    virtual int collect(int8_t **outputs) { return -1; }
+    // 是否有已提交、尚未 collect 的帧
+    virtual bool busy() const { return false; }
+
+    // 是否为可切换输入形状的动态形状模型
+    virtual bool dynamic_shape() const { return false; }
+
+    /**
+     * @Description: 动态形状模型：按源图宽高比切换输入形状（choose_input_shape），调用时上下文必须空闲
+     *               切换后 get_input_* / get_outputs / get_output_bytes 为新形状，之前创建的输入缓冲区不再可用
+     * @param {int} src_w: 源图宽度
+     * @param {int} src_h: 源图高度
+     * @return {int}: 1 已切换，0 形状不变，小于 0 失败
+     */
+    virtual int select_input_shape(int src_w, int src_h) { return 0; }
+
+    // 使用的 NPU 核心（位掩码），0 表示由驱动选择，DISPATCH_CORES_NONE 表示不使用 NPU
+    virtual unsigned get_core_mask() const { return 0; }
+
+    int get_input_width() const { return width; }
+    int get_input_height() const { return height; }
+    int get_input_channel() const { return channel; }
+    // 输入的 batch 大小（转换模型时的 rknn_batch_size），输入缓冲区需要容纳 batch 张图
+    int get_input_batch() const { return batch; }
+    // 输出张量的形状、量化参数与布局，顺序与 run 得到的 outputs 一致
+    const std::vector<head_tensor_t> &get_outputs() const { return outputs; }
+    // 每个输出的字节数（原生布局含对齐）
+    const std::vector<size_t> &get_output_bytes() const { return output_bytes; }
+    // 模型自定义字符串（检测头、标签、anchor），没有时为空
+    const std::string &get_custom_string() const { return custom_string; }
+
+protected:
+    int width = 0;
+    int height = 0;
+    int channel = 0;
+    int batch = 1;
+    std::vector<head_tensor_t> outputs;
+    std::vector<size_t> output_bytes;
+    std::string custom_string;
+};
+
+/**
+ * @Description: 按 AppConfig::backend 创建后端
+ * @return {unique_ptr<InferenceBackend>}: 未知的后端类型返回空指针
+ */
+std::unique_ptr<InferenceBackend> create_inference_backend(const AppConfig &config);
+std::unique_ptr<InferenceBackend> create_rknn_backend(const AppConfig &config);
+std::unique_ptr<InferenceBackend> create_cpu_backend(const AppConfig &config);
+std::unique_ptr<InferenceBackend> create_replay_backend(const AppConfig &config);
+
+/**
+ * @Description: 为源图选择输入形状：先取各形状中最大的 letterbox 缩放比例（不降低输入分辨率），
+ *               再在缩放比例达到该值的形状中取面积最小的，例如 1280x720 在 640x640 / 640x384 中选 640x384
+ * @param {vector<input_shape_t>} &shapes: 模型支持的输入形状
+ * @return {int}: 选中的下标，shapes 为空时返回 -1
+ */
+int choose_input_shape(const std::vector<input_shape_t> &shapes, int src_w, int src_h);
+
+/**
+ * @Description: 录制推理输出，供 replay 后端回放：创建目录并写入 meta.txt，后端 init 之后调用
+ *               meta.txt 记录输入尺寸、自定义字符串和每个输出的形状、量化参数、布局与字节数，
+ *               frame_000000.bin 起每帧一个文件，依次为全部输出的原始数据
+ * @param {string} &dir: 录制目录
+ * @param {InferenceBackend} &backend: 提供输入尺寸和输出描述
+ * @return {int}: 0 成功
+ */
+int record_meta(const std::string &dir, const InferenceBackend &backend);
+
+/**
+ * @Description: 录制一帧的全部输出，多个上下文共用一个录制目录，帧号全局递增
+ * @param {int8_t} **outputs: run / collect 得到的输出
+ * @return {int}: 0 成功
+ */
+int record_frame(const std::string &dir, const InferenceBackend &backend, int8_t **outputs);
+
+#endif //_RKNN_YOLOV5_DEMO_INFERENCE_BACKEND_H_
@@ -0,0 +1,146 @@
+/*
+ * @Author: Li RF
+ * @Date: 2025-04-11 10:12:45
+ * @LastEditors: Li RF
+ * @LastEditTime: 2025-04-11 10:12:45
+ * @Description: 模型输入缓冲区：前处理直接写入，NPU 直接读取
+ *               RknnInputBuffer 由 rknn_create_mem 分配并通过 rknn_set_io_mem 绑定到上下文（零拷贝）；
+ *               HostInputBuffer 为普通内存的替身实现，配合 rknn_inputs_set 使用，也可在没有 NPU 的机器上测试前处理
+ * Email: 1125962926@qq.com
+ * Copyright (c) 2025 Li RF, All Rights Reserved.
+ */
+#ifndef _RKNN_YOLOV5_DEMO_INPUT_BUFFER_H_
+#define _RKNN_YOLOV5_DEMO_INPUT_BUFFER_H_
+
+#include <stdint.h>
+
+#include "opencv2/core/core.hpp"
+#include "rknn_api.h"
+#include "AlignedBuffer.hpp"
+#include "postprocess.h"
+
+/* letterbox 填充颜色，与 letterbox() 的默认值一致 */
+#define INPUT_PAD_COLOR 128
+
+class InputBuffer
+{
+public:
+    virtual ~InputBuffer() = default;
+
+    virtual const char *name() const = 0;
+    // 是否已绑定到 rknn 上下文，为 false 时需要通过 rknn_inputs_set 传入 data()
+    virtual bool bound() const = 0;
+    // dma-buf fd，RGA 可以直接导入，没有时返回 -1
+    virtual int fd() const { return -1; }
+
+    /**
+     * @Description: CPU 写入后同步 cache，保证设备（RGA/NPU）看到最新数据
+     * @return {int}: 0 成功
+     */
+    virtual int sync_to_device() { return 0; }
+
+    /**
+     * @Description: 重新绑定到上下文，异步模式下两块输入缓冲区轮流使用时调用；未绑定的实现直接返回
+     * @return {int}: 0 成功
+     */
+    virtual int rebind() { return 0; }
+
+    uint8_t *data() { return buf; }
+    int get_width() const { return width; }
+    int get_height() const { return height; }
+    int get_channel() const { return channel; }
+    // 每行的像素数（含对齐），不小于 width
+    int get_w_stride() const { return w_stride; }
+    // 整个缓冲区的字节数
+    size_t size() const { return (size_t)w_stride * height * channel; }
+
+    /**
+     * @Description: 按源图尺寸更新 letterbox 几何（缩放比例、内容区域、四周填充）
+     *               源图尺寸变化时整块缓冲区重新填充为 INPUT_PAD_COLOR，
+     *               尺寸不变时直接返回，填充区域保持不动，每帧只需重写内容区域
+     * @param {int} src_w: 源图宽度
+     * @param {int} src_h: 源图高度
+     * @return {bool}: 几何是否发生变化
+     */
+    bool update_letterbox(int src_w, int src_h);
+
+    float get_scale() const { return scale; }
+    const BOX_RECT &get_pads() const { return pads; }
+    // 内容区域（模型输入坐标系）
+    const cv::Rect &get_content() const { return content; }
+
+    /**
+     * @Description: 整个缓冲区的 Mat 头，按 w_stride 设置行步长，不拷贝数据
+     * @return {cv::Mat}
+     */
+    cv::Mat view();
+
+    /**
+     * @Description: OpenCV 前处理：BGR 源图缩放后写入内容区域并原地转为 RGB
+     *               需要先调用 update_letterbox，填充区域不再重写
+     * @param {Mat} &bgr: BGR 源图
+     * @param {bool} use_opencl: 缩放使用 OpenCL（UMat），结果再拷贝到内容区域
+     * @return {int}: 0 成功
+     */
+    int write_letterbox(const cv::Mat &bgr, bool use_opencl);
+
+protected:
+    uint8_t *buf = nullptr;
+    int width = 0;
+    int height = 0;
+    int channel = 0;
+    int w_stride = 0;
+
+    // 当前 letterbox 几何对应的源图尺寸
+    int src_width = 0;
+    int src_height = 0;
+    float scale = 1.f;
+    BOX_RECT pads = {0, 0, 0, 0};
+    cv::Rect content;
+};
+
+/* 普通内存实现，不依赖 NPU */
+class HostInputBuffer : public InputBuffer
+{
+public:
+    /**
+     * @param {int} w_stride: 行像素数，0 表示等于 width；可以设置成大于 width 来模拟 NPU 的对齐要求
+     */
+    HostInputBuffer(int width, int height, int channel, int w_stride = 0);
+    const char *name() const override { return "host"; }
+    bool bound() const override { return false; }
+
+private:
+    AlignedBuffer<uint8_t> storage;
+};
+
+/* rknn_create_mem 分配的输入张量内存，按原生输入属性绑定到上下文 */
+class RknnInputBuffer : public InputBuffer
+{
+public:
+    RknnInputBuffer() = default;
+    ~RknnInputBuffer() override;
+
+    /**
+     * @Description: 查询原生输入属性，分配内存并绑定到上下文，失败时不占用任何资源
+     * @param {rknn_context} ctx: 上下文，每个上下文（包括 rknn_dup_context 得到的）都需要单独的输入内存
+     * @param {int} index: 输入序号
+     * @param {bool} verbose: 打印原生属性
+     * @param {bool} current: 动态形状模型，按 rknn_set_input_shapes 设置的当前形状查询
+     * @return {int}: 0 成功
+     */
+    int create(rknn_context ctx, int index, bool verbose, bool current = false);
+
+    const char *name() const override { return "rknn_create_mem"; }
+    bool bound() const override { return mem != nullptr; }
+    int fd() const override { return mem ? mem->fd : -1; }
+    int sync_to_device() override;
+    int rebind() override;
+
+private:
+    rknn_context ctx = 0;
+    rknn_tensor_mem *mem = nullptr;
+    rknn_tensor_attr attr;
+};
+
+#endif //_RKNN_YOLOV5_DEMO_INPUT_BUFFER_H_
@@ -0,0 +1,48 @@
+/*
+ * @Author: Li RF
+ * @Date: 2025-04-15 09:48:17
+ * @LastEditors: Li RF
+ * @LastEditTime: 2025-04-15 09:48:17
+ * @Description: 只读映射的模型文件：mmap 代替整块读入堆内存，多个上下文初始化时共享页缓存
+ * Email: 1125962926@qq.com
+ * Copyright (c) 2025 Li RF, All Rights Reserved.
+ */
+#ifndef _RKNN_YOLOV5_DEMO_MODEL_FILE_H_
+#define _RKNN_YOLOV5_DEMO_MODEL_FILE_H_
+
+#include <stddef.h>
+#include <string>
+
+class ModelFile
+{
+public:
+    ModelFile() = default;
+    ~ModelFile() { close(); }
+
+    // 独占映射，禁止拷贝
+    ModelFile(const ModelFile &) = delete;
+    ModelFile &operator=(const ModelFile &) = delete;
+
+    /**
+     * @Description: 以只读方式映射整个文件，并提示内核顺序预读
+     * @param {string} &path: 模型路径
+     * @return {int}: 0 成功
+     */
+    int open(const std::string &path);
+
+    /**
+     * @Description: 解除映射，rknn_init 返回后即可调用（运行时已把模型拷贝到自己的内存）
+     * @return {*}
+     */
+    void close();
+
+    // rknn_init 的参数不是 const，映射为 PROT_READ + MAP_PRIVATE，运行时不会写入
+    void *data() const { return addr; }
+    size_t size() const { return length; }
+
+private:
+    void *addr = nullptr;
+    size_t length = 0;
+};
+
+#endif //_RKNN_YOLOV5_DEMO_MODEL_FILE_H_
@@ -0,0 +1,62 @@
+/*
+ * @Author: Li RF
+ * @Date: 2025-04-19 09:41:08
+ * @LastEditors: Li RF
+ * @LastEditTime: 2025-04-19 09:41:08
+ * @Description: 运动门控：提交推理前比较当前帧与上一次推理帧的缩小亮度图，画面没有变化时跳过 NPU，
+ *               沿用上一次的检测结果；画面整体变化（镜头切换、开关灯）视为场景切换，每隔 N 帧强制推理一次
+ *               每路视频流持有一个实例，阈值取自该路的 AppConfig
+ * Email: 1125962926@qq.com
+ * Copyright (c) 2025 Li RF, All Rights Reserved.
+ */
+#ifndef _RKNN_YOLOV5_DEMO_MOTION_GATE_H_
+#define _RKNN_YOLOV5_DEMO_MOTION_GATE_H_
+
+#include "opencv2/core/core.hpp"
+#include "SharedTypes.hpp"
+
+/* 比较用的亮度图宽度，高度按源图比例 */
+#define GATE_WIDTH 160
+
+/* 门控结果 */
+enum GATE_RESULT {
+    GATE_SKIP = 0,   // 画面没有变化，沿用上一次的结果
+    GATE_MOTION = 1, // 局部变化
+    GATE_SCENE = 2,  // 整体变化，或者第一帧
+    GATE_FORCED = 3  // 距上一次推理已达 N 帧
+};
+
+class MotionGate
+{
+public:
+    MotionGate(const AppConfig &config);
+
+    /**
+     * @Description: 判断当前帧是否需要推理，需要时把它作为新的参考帧
+     * @param {Mat} &frame: 亮度图（CV_8UC1，如 NV12 的 Y 平面），或 BGR 图像（缩小后转为灰度）
+     * @return {int}: GATE_RESULT
+     */
+    int update(const cv::Mat &frame);
+
+    // 打印各类结果的帧数与跳过比例
+    void report() const;
+    long long get_frames() const { return frames; }
+    long long get_skipped() const { return counts[GATE_SKIP]; }
+
+private:
+    // 变化像素的亮度差阈值
+    int pixel_threshold;
+    // 变化像素占比超过该值视为运动
+    float area_threshold;
+    // 平均亮度差超过该值视为场景切换
+    float scene_threshold;
+    // 强制推理的间隔帧数
+    int interval;
+
+    cv::Mat small, reference, diff, mask;
+    int since_infer = 0;
+    long long frames = 0;
+    long long counts[4] = {0, 0, 0, 0};
+};
+
+#endif //_RKNN_YOLOV5_DEMO_MOTION_GATE_H_
@@ -0,0 +1,83 @@
+/*
+ * @Author: Li RF
+ * @Date: 2025-04-05 15:20:11
+ * @LastEditors: Li RF
+ * @LastEditTime: 2025-04-05 15:20:11
+ * @Description: 非极大值抑制引擎
+ * Email: 1125962926@qq.com
+ * Copyright (c) 2025 Li RF, All Rights Reserved.
+ */
+#ifndef _RKNN_YOLOV5_DEMO_NMS_H_
+#define _RKNN_YOLOV5_DEMO_NMS_H_
+
+#include <stdint.h>
+#include <vector>
+
+#include "AlignedBuffer.hpp"
+
+/* 自动模式下切换到空间哈希 NMS 的候选框数量 */
+#define NMS_GRID_MIN_CANDIDATES 256
+/* 网格单边最多的格子数，候选分布过大时自动放大格子边长 */
+#define NMS_GRID_MAX_DIM 128
+/* 单个保留框最多登记的格子数，超过的当作大框放入单独列表，每个候选都与之比较 */
+#define NMS_GRID_MAX_CELLS_PER_BOX 16
+
+/* NMS 临时缓冲区，预先分配后跨帧复用，稳定运行时不再申请内存 */
+struct NmsScratch
+{
+    int capacity = 0; // 候选框容量
+    int max_keep = 0; // 保留框容量
+
+    AlignedBuffer<int> heap;
+    // 已保留框的 SoA 数组
+    AlignedBuffer<float> kx1, ky1, kx2, ky2;
+    AlignedBuffer<int> kcls;
+    // 空间哈希网格
+    AlignedBuffer<int> cell_head, node_kept, node_next, stamp, large;
+
+    /**
+     * @Description: 按容量分配全部缓冲区，已足够时不重新分配
+     * @param {int} capacity: 候选框数量上限
+     * @param {int} max_keep: 保留框数量上限
+     * @return {*}
+     */
+    void reserve(int capacity, int max_keep);
+};
+
+/**
+ * @Description: 按类别分桶的贪心 NMS，结合部分 top-K 选择
+ *               候选框按置信度降序（相同置信度按下标升序）逐个弹出，只与已保留的同类别框比较 IoU，
+ *               保留数达到 max_keep 后立即停止，不再对剩余候选排序和比较
+ *               结果与"全排序 + 逐类别 NMS + 取前 max_keep 个"一致
+ * @param {int} count: 候选框数量
+ * @param {float} *boxes: 候选框，每 4 个为一组 (x, y, w, h)
+ * @param {float} *scores: 置信度
+ * @param {int} *class_ids: 类别
+ * @param {float} threshold: IoU 阈值
+ * @param {int} max_keep: 最多保留的框数量
+ * @param {int} *keep: 输出，保留框在候选中的下标，按置信度降序，容量不小于 max_keep
+ * @param {NmsScratch} &scratch: 临时缓冲区，容量不足时自动扩大
+ * @return {int}: 保留的框数量
+ */
+int nms_topk(int count, const float *boxes, const float *scores, const int *class_ids, float threshold,
+             int max_keep, int *keep, NmsScratch &scratch);
+
+/**
+ * @Description: 空间哈希版本的 nms_topk，用于候选框很多的拥挤场景
+ *               保留框按其覆盖范围登记到边长为 cell_size 的均匀网格中，
+ *               候选框只与所覆盖网格内的已保留框比较 IoU，结果与 nms_topk 完全一致
+ * @param {float} cell_size: 网格边长（像素），一般取模型的最大步幅
+ * @return {int}: 保留的框数量
+ */
+int nms_topk_grid(int count, const float *boxes, const float *scores, const int *class_ids, float threshold,
+                  int max_keep, int *keep, float cell_size, NmsScratch &scratch);
+
+/**
+ * @Description: 根据 NMS 模式选择实现，NMS_MODE::NMS_AUTO 时候选框数达到 NMS_GRID_MIN_CANDIDATES 才使用网格版本
+ * @param {int} mode: NMS_MODE
+ * @return {int}: 保留的框数量
+ */
+int nms_run(int mode, int count, const float *boxes, const float *scores, const int *class_ids, float threshold,
+            int max_keep, int *keep, float cell_size, NmsScratch &scratch);
+
+#endif //_RKNN_YOLOV5_DEMO_NMS_H_
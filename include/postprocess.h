@@ -13,12 +13,15 @@
 #include <stdint.h>
 #include <vector>
 
+#include "AlignedBuffer.hpp"
+#include "nms.h"
+
 #define OBJ_NAME_MAX_SIZE 16
+/* 二级分类器属性的最大长度（多个输出的标签以逗号连接） */
+#define OBJ_ATTR_MAX_SIZE 32
 #define OBJ_NUMB_MAX_SIZE 64
-#define OBJ_CLASS_NUM 80
 #define NMS_THRESH 0.45
 #define BOX_THRESH 0.25
-#define PROP_BOX_SIZE (5 + OBJ_CLASS_NUM)
 
 typedef struct _BOX_RECT
 {
@@ -33,6 +36,10 @@ typedef struct __detect_result_t
     char name[OBJ_NAME_MAX_SIZE];
     BOX_RECT box;
     float prop;
+    bool propagated; // 由光流从关键帧传播得到，不是本帧的检测结果
+    int track_id;    // 多目标跟踪的轨迹编号，未跟踪或未确认时为 -1
+    char attr[OBJ_ATTR_MAX_SIZE]; // 二级分类器给出的属性，多个输出以逗号分隔，没有时为空
+    float attr_prop;              // 属性的置信度（多个输出取最小值）
 } detect_result_t;
 
 typedef struct _detect_result_group_t
@@ -42,9 +49,49 @@ typedef struct _detect_result_group_t
     detect_result_t results[OBJ_NUMB_MAX_SIZE];
 } detect_result_group_t;
 
-int post_process(int8_t *input0, int8_t *input1, int8_t *input2, int model_in_h, int model_in_w,
-                 float conf_threshold, float nms_threshold, BOX_RECT pads, float scale_w, float scale_h,
-                 std::vector<int32_t> &qnt_zps, std::vector<float> &qnt_scales,
-                 detect_result_group_t *group);
+/* 每个 int8 输出张量的查找表，下标为 (int)qnt + 128 */
+typedef struct _qnt_lut_t
+{
+    int32_t zp;
+    float scale;
+    bool sigmoid;   // 输出为原始 logits，查表值已经过 sigmoid
+    float deq[256]; // 反量化值（sigmoid 模式下为 sigmoid 后的值）
+    float xy[256];  // deq * 2 - 0.5，用于中心点
+    float wh[256];  // (deq * 2)^2，用于宽高
+    float dfl_exp[256]; // exp(-d * scale)，d 为与最大值的量化差，用于 DFL softmax
+} qnt_lut_t;
+
+void build_qnt_lut(qnt_lut_t *lut, int32_t zp, float scale, bool apply_sigmoid);
+
+/* 后处理工作区，每个 rkYolo 持有一份，在 init 中按检测头的网格尺寸一次性分配，之后每帧复用 */
+struct PostprocessWorkspace
+{
+    int capacity = 0;             // 候选框容量
+    AlignedBuffer<float> boxes;   // 候选框，每 4 个为一组 (x, y, w, h)
+    AlignedBuffer<float> probs;   // 候选置信度
+    AlignedBuffer<int> class_ids; // 候选类别
+    AlignedBuffer<int32_t> survivors; // 置信度预筛选的存活下标
+    NmsScratch nms;
+    int keep[OBJ_NUMB_MAX_SIZE];
+
+    /**
+     * @Description: 分配全部缓冲区，已足够时不重新分配
+     * @param {int} max_candidates: 候选框数量上限，见 HeadDecoder::max_candidates()
+     * @param {int} max_survivors: 存活下标数量上限，见 HeadDecoder::max_survivors()
+     * @return {*}
+     */
+    void init(int max_candidates, int max_survivors);
+};
+
+class HeadDecoder;
+
+/**
+ * @Description: 解码模型输出并做 NMS，结果换算回原图坐标
+ * @param {HeadDecoder} *decoder: 检测头解码器，决定输出的解释方式、类别数和标签
+ * @param {int8_t} **outputs: 模型输出
+ * @return {int}: 0 成功
+ */
+int post_process(HeadDecoder *decoder, int8_t **outputs, float conf_threshold, float nms_threshold, BOX_RECT pads,
+                 float scale_w, float scale_h, int nms_mode, PostprocessWorkspace *ws, detect_result_group_t *group);
 
 #endif //_RKNN_YOLOV5_DEMO_POSTPROCESS_H_
@@ -0,0 +1,116 @@
+/*
+ * @Author: Li RF
+ * @Date: 2025-04-02 10:12:45
+ * @LastEditors: Li RF
+ * @LastEditTime: 2025-04-02 10:12:45
+ * @Description: 后处理向量化内核（NEON / SSE2 / AVX2 / 标量参考实现）
+ * Email: 1125962926@qq.com
+ * Copyright (c) 2025 Li RF, All Rights Reserved.
+ */
+#ifndef _RKNN_YOLOV5_DEMO_POSTPROCESS_SIMD_H_
+#define _RKNN_YOLOV5_DEMO_POSTPROCESS_SIMD_H_
+
+#include <stdint.h>
+
+/* 一次处理的 cell 数量（AVX2 为 32，NEON/SSE 为 2 x 16） */
+#define ARGMAX_BLOCK 32
+
+/**
+ * @Description: 对 count 个连续 cell 求类别最大值及其下标（NCHW 布局）
+ *               cls_ptr 指向第 0 个类别平面中的第一个 cell，相邻类别平面间隔 plane_stride 字节
+ *               相同概率时保留较小的类别下标，与逐 cell 标量循环结果完全一致
+ *               num_class 不能超过 256（下标以 uint8_t 保存）
+ * @param {int8_t} *cls_ptr: 类别平面起始地址
+ * @param {int} num_class: 类别数
+ * @param {int} plane_stride: 相邻类别平面的间隔（grid_h * grid_w）
+ * @param {int} count: cell 数量
+ * @param {int8_t} *max_prob: 输出，每个 cell 的最大类别概率（量化值）
+ * @param {uint8_t} *max_id: 输出，每个 cell 的最大类别下标
+ * @return {*}
+ */
+void class_argmax_i8(const int8_t *cls_ptr, int num_class, int plane_stride, int count,
+                     int8_t *max_prob, uint8_t *max_id);
+
+/**
+ * @Description: class_argmax_i8 的标量参考实现，用于 x86 开发机上对拍
+ */
+void class_argmax_i8_ref(const int8_t *cls_ptr, int num_class, int plane_stride, int count,
+                         int8_t *max_prob, uint8_t *max_id);
+
+/**
+ * @Description: 置信度预筛选：将 len 个 int8 置信度与阈值批量比较（向量比较 + 位掩码），
+ *               把满足 plane[i] >= thres 的下标（加上 base）按升序紧凑写入 out_idx
+ * @param {int8_t} *plane: 置信度平面
+ * @param {int} len: 平面长度（grid_h * grid_w）
+ * @param {int8_t} thres: 量化后的阈值
+ * @param {int32_t} base: 写入下标的偏移，用于区分不同 anchor
+ * @param {int32_t} *out_idx: 输出，容量不小于 len
+ * @return {int}: 存活的 cell 数量
+ */
+int objectness_filter_i8(const int8_t *plane, int len, int8_t thres, int32_t base, int32_t *out_idx);
+
+/**
+ * @Description: objectness_filter_i8 的标量参考实现
+ */
+int objectness_filter_i8_ref(const int8_t *plane, int len, int8_t thres, int32_t base, int32_t *out_idx);
+
+/**
+ * @Description: 原生布局（NC1HWC2 / NHWC）下单个 cell 的类别最大值及其下标
+ *               通道按 c2 个一组，组内每个 cell 的 c2 个通道连续存放，相邻组间隔 group_stride 字节；
+ *               类别从第 first 个通道开始，不要求与组边界对齐
+ *               先对全部类别求最大值，只有最大值超过 thres 时才定位下标（相同概率时取较小的类别下标）
+ * @param {int8_t} *cell_ptr: 第 0 组中该 cell 的第 0 个通道
+ * @param {int} first: 第一个类别所在的通道
+ * @param {int} num_class: 类别数
+ * @param {int} c2: 每组通道数，NHWC 时为每个 cell 的通道步长
+ * @param {int} group_stride: 相邻通道组的间隔（grid_h * grid_w * c2）
+ * @param {int8_t} thres: 量化阈值
+ * @param {int} *max_id: 输出，最大类别下标，最大值不超过 thres 时为 -1
+ * @return {int8_t}: 最大类别概率（量化值）
+ */
+int8_t class_argmax_c2_i8(const int8_t *cell_ptr, int first, int num_class, int c2, int group_stride, int8_t thres,
+                          int *max_id);
+
+/**
+ * @Description: class_argmax_c2_i8 的标量参考实现
+ */
+int8_t class_argmax_c2_i8_ref(const int8_t *cell_ptr, int first, int num_class, int c2, int group_stride,
+                              int8_t thres, int *max_id);
+
+/* DFL 每条边最多的 bin 数（YOLOv8/YOLO11 为 16） */
+#define DFL_MAX_REG 32
+
+/**
+ * @Description: 为 int8 DFL 输出构建 exp 查找表：lut[d] = exp(-d * scale)，d = qmax - q ∈ [0, 255]
+ *               softmax 只依赖与最大值的差，因此 256 项即可覆盖全部情况，且与零点无关
+ * @param {float} *lut: 输出，256 项
+ * @param {float} scale: 量化比例
+ * @return {*}
+ */
+void build_dfl_exp_lut(float *lut, float scale);
+
+/**
+ * @Description: 计算一个 cell 的 4 条边距离：每条边 reg_max 个 bin 做 softmax，再求下标的期望
+ *               exp 查表，求和与加权求和在同一遍中完成
+ *               第 e 条边的第 k 个 bin 位于 bins[(e * reg_max + k) * plane_stride]
+ * @param {int8_t} *bins: 第 0 条边第 0 个 bin 的地址
+ * @param {int} plane_stride: 相邻 bin 的间隔，NCHW 布局为 grid_h * grid_w，bin 连续存放时为 1
+ * @param {int} reg_max: 每条边的 bin 数，不超过 DFL_MAX_REG
+ * @param {float} *exp_lut: build_dfl_exp_lut 构建的查找表
+ * @param {float} *dist: 输出，左、上、右、下 4 个距离（以步幅为单位）
+ * @return {*}
+ */
+void dfl_decode_i8(const int8_t *bins, int plane_stride, int reg_max, const float *exp_lut, float *dist);
+
+/**
+ * @Description: dfl_decode_i8 的标量参考实现
+ */
+void dfl_decode_i8_ref(const int8_t *bins, int plane_stride, int reg_max, const float *exp_lut, float *dist);
+
+/**
+ * @Description: 当前编译目标所使用的指令集名称
+ * @return {const char*}: "neon" / "avx2" / "sse2" / "scalar"
+ */
+const char *postprocess_simd_isa();
+
+#endif //_RKNN_YOLOV5_DEMO_POSTPROCESS_SIMD_H_
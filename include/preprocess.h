@@ -11,15 +11,19 @@
 #define _RKNN_YOLOV5_DEMO_PREPROCESS_H_
 
 #include <stdio.h>
+#include <vector>
 #include "im2d.h"
 #include "rga.h"
 #include "opencv2/core/core.hpp"
 #include "opencv2/imgcodecs.hpp"
 #include "opencv2/imgproc.hpp"
 #include "postprocess.h"
+#include "input_buffer.h"
 
 void letterbox(const cv::Mat &image, cv::Mat &padded_image, BOX_RECT &pads, const float scale, const cv::Size &target_size, bool Use_opencl = true, const cv::Scalar &pad_color = cv::Scalar(128, 128, 128));
 int RGA_resize(const cv::Mat &image, cv::Mat &resized_image);
+int RGA_letterbox_into(const cv::Mat &image, InputBuffer &input);
+int RGA_crop_resize_batch(const cv::Mat &image, const std::vector<cv::Rect> &rects, InputBuffer &input, int slot_h);
 int RGA_handle_resize(const cv::Mat &image, cv::Mat &resized_image);
 int RGA_bgr_to_rgb(const cv::Mat& rgb_origin, cv::Mat &bgr_image);
 int RGA_handle_bgr_to_rgb(const cv::Mat& rgb_origin, cv::Mat &bgr_image);
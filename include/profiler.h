@@ -0,0 +1,93 @@
+/*
+ * @Author: Li RF
+ * @Date: 2025-04-16 10:05:44
+ * @LastEditors: Li RF
+ * @LastEditTime: 2025-04-16 10:05:44
+ * @Description: NPU 逐层性能分析：解析 RKNN_QUERY_PERF_DETAIL 的逐层耗时表，多帧取平均后输出 CSV / JSON，
+ *               并可对比两份结果（两个模型或同一模型的两次运行），用于评估量化、剪枝等改动
+ *               解析、输出与对比不依赖 NPU，可在开发机上对比板端导出的 CSV
+ * Email: 1125962926@qq.com
+ * Copyright (c) 2025 Li RF, All Rights Reserved.
+ */
+#ifndef _RKNN_YOLOV5_DEMO_PROFILER_H_
+#define _RKNN_YOLOV5_DEMO_PROFILER_H_
+
+#include <string>
+#include <vector>
+
+#include "SharedTypes.hpp"
+
+/* 一层的耗时 */
+struct LayerPerf
+{
+    int id = 0;
+    std::string op_type;
+    std::string target; // NPU / CPU / GPU
+    std::string name;   // 层的完整名称，旧版运行时没有时为空
+    double time_us = 0;
+};
+
+/* 一次分析的结果，time_us 为多帧平均 */
+struct PerfReport
+{
+    std::string model;
+    int frames = 0;
+    // RKNN_QUERY_PERF_RUN 的平均值（整次 rknn_run 的耗时）
+    double run_us = 0;
+    std::vector<LayerPerf> layers;
+
+    // 所有层耗时之和
+    double total_us() const;
+};
+
+/**
+ * @Description: 解析 RKNN_QUERY_PERF_DETAIL 返回的文本表格
+ *               按表头定位 OpType / Target / Time(us) / FullName 列，兼容 "Op Type" 这类带空格的旧版表头
+ * @param {char} *text: perf_data
+ * @param {vector<LayerPerf>} &layers: 解析结果，按表中顺序
+ * @return {int}: 0 成功，找不到表头或没有任何层时返回 -1
+ */
+int parse_perf_detail(const char *text, std::vector<LayerPerf> &layers);
+
+/**
+ * @Description: 累加一帧的逐层耗时，层数或算子类型与已有结果不一致时返回 -1
+ * @param {PerfReport} &report: 累加结果，全部帧累加后调用 finish_perf_report 取平均
+ * @param {vector<LayerPerf>} &layers: 一帧的解析结果
+ * @param {double} run_us: 该帧的 RKNN_QUERY_PERF_RUN
+ * @return {int}: 0 成功
+ */
+int accumulate_perf(PerfReport &report, const std::vector<LayerPerf> &layers, double run_us);
+void finish_perf_report(PerfReport &report);
+
+/**
+ * @Description: 输出逐层表格（算子类型、耗时、占总耗时的比例）
+ * @param {string} &path: 文件路径
+ * @return {int}: 0 成功
+ */
+int write_perf_csv(const PerfReport &report, const std::string &path);
+int write_perf_json(const PerfReport &report, const std::string &path);
+int read_perf_csv(const std::string &path, PerfReport &report);
+
+/**
+ * @Description: 打印两份结果的差异：总耗时、按算子类型汇总、逐层（两份结果的层结构一致时）变化最大的若干层
+ * @param {PerfReport} &base: 基准
+ * @param {PerfReport} &test: 对比对象
+ * @return {*}
+ */
+void compare_perf_reports(const PerfReport &base, const PerfReport &test);
+
+/**
+ * @Description: --profile：以 RKNN_FLAG_COLLECT_PERF_MASK 初始化上下文，用合成输入运行 config.profile_frames 帧
+ *               （第一帧作为预热不计入），结果写入 config.profile_out + ".csv" / ".json"
+ * @return {int}: 0 成功
+ */
+int run_profile(const AppConfig &config);
+
+/**
+ * @Description: --compare：读取两份 CSV 并打印差异
+ * @param {string} &paths: "base.csv,test.csv"
+ * @return {int}: 0 成功
+ */
+int run_perf_compare(const std::string &paths);
+
+#endif //_RKNN_YOLOV5_DEMO_PROFILER_H_
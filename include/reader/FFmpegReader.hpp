@@ -38,6 +38,8 @@ public:
     void openVideo(const std::string& filePath) override;
     bool readFrame(cv::Mat& frame) override;
     void closeVideo() override;
+    // NV12 的 Y 平面，不拷贝
+    bool getLuma(cv::Mat& luma) override;
 
     // 获取视频信息
     void print_video_info(const string& filePath);
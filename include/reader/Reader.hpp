@@ -25,6 +25,8 @@ public:
     virtual void openVideo(const std::string& filePath) = 0;
     virtual bool readFrame(cv::Mat& frame) = 0;
     virtual void closeVideo() = 0;
+    // 最近一帧的亮度（Y 平面），解码器直接给出时返回 true，数据在下一次 readFrame 之前有效
+    virtual bool getLuma(cv::Mat& luma) { return false; }
 };
 
 #endif // READER_H
\ No newline at end of file
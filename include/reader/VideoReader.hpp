@@ -39,6 +39,7 @@ public:
 
     /* 函数接口 */
     bool readFrame(cv::Mat &frame);  // 读取一帧
+    bool getLuma(cv::Mat &luma);     // 最近一帧的亮度平面，引擎不支持时返回 false
     void Close_Video();              // 关闭视频
 
 
@@ -10,13 +10,12 @@
 #ifndef RKYOLOV5S_H
 #define RKYOLOV5S_H
 
-#include "rknn_api.h"
 #include "opencv2/core/core.hpp"
 #include "SharedTypes.hpp"
-
-static void dump_tensor_attr(rknn_tensor_attr *attr);
-static unsigned char *load_data(FILE *fp, size_t ofst, size_t sz);
-static unsigned char *load_model(const char *filename, int *model_size);
+#include "postprocess.h"
+#include "head_decoder.h"
+#include "inference_backend.h"
+#include "input_buffer.h"
 
 class rkYolo
 {
@@ -25,24 +24,74 @@ private:
     std::mutex mtx;
     AppConfig config;
 
-    rknn_context ctx;
-    rknn_input_output_num io_num;
-    // rknn_tensor_attr *input_attrs;
-    // rknn_tensor_attr *output_attrs;
-    // 更新为智能指针
-    std::unique_ptr<rknn_tensor_attr[]> input_attrs;
-    std::unique_ptr<rknn_tensor_attr[]> output_attrs;
-    rknn_input inputs[1];
+    // 推理后端（RKNN / CPU / replay），模型的加载和运行都在后端中
+    std::unique_ptr<InferenceBackend> backend;
+    int n_output = 0;
+    // 模型输入缓冲区，前处理直接写入；零拷贝时已绑定到上下文，否则由后端传入
+    std::unique_ptr<InputBuffer> input_buf;
+
+    // 异步模式（AppConfig::async，后端支持时）：第二块输入缓冲区，与上面一块轮流使用
+    // 当前帧写入空闲的一块并提交，上一帧的输出在后端的另一组输出中做后处理
+    bool async = false;
+    std::unique_ptr<InputBuffer> input_buf_alt;
+    // 已提交、尚未取回结果的帧
+    bool pending = false;
+    cv::Mat pending_img;
 
     int channel, width, height;
+    // 动态形状模型：当前输入形状对应的源图尺寸，源图尺寸变化时重新选择形状
+    bool dynamic_shape = false;
+    int shape_src_w = 0;
+    int shape_src_h = 0;
 
     float nms_threshold, box_conf_threshold;
 
+    // 检测头解码器，在 init 中根据模型信息选择，持有每个输出张量的查找表和类别标签
+    std::unique_ptr<HeadDecoder> decoder;
+
+    // 后处理工作区，在 init 中按网格尺寸分配，每帧复用
+    PostprocessWorkspace pp_ws;
+    // 已完成后处理的帧数，用于 ALLOC_TRACE 跳过预热帧
+    uint64_t pp_frames = 0;
+
+    // 启动各阶段的时刻
+    StartupTimeline timeline;
+    // 用合成输入预热
+    int warmup(int runs);
+
+    // 动态形状模型：按源图尺寸切换输入形状，并重建解码器和输入缓冲区
+    int update_input_shape(int src_w, int src_h);
+    // 取回异步模式下仍在上下文中的帧并完成后处理，调用前已加锁
+    cv::Mat drain();
+    // 前处理：letterbox 写入指定的输入缓冲区
+    int preprocess(const cv::Mat &orig_img, InputBuffer &buf);
+    // 后处理，pads/scale 取自该帧使用的输入缓冲区，结果为源图坐标
+    void postprocess(int8_t **out_bufs, const InputBuffer &buf, detect_result_group_t *group);
+    // 后处理并在原图上绘制
+    void postprocess_draw(cv::Mat &orig_img, int8_t **out_bufs, const InputBuffer &buf);
+    // 录制该帧的输出（AppConfig::record_dir）
+    void record(int8_t **out_bufs);
+    cv::Mat infer_async(cv::Mat &orig_img);
+
 public:
     rkYolo(const AppConfig& config);
-    int init(rknn_context *ctx_in, bool isChild);
-    rknn_context *get_pctx();
+    // first 为第一个上下文的后端，share 为 false 时表示自身是第一个上下文
+    int init(InferenceBackend *first, bool share);
+    // 后端，用于其余上下文共享权重或录制数据
+    InferenceBackend *get_pctx();
+    // 使用的核心（位掩码），0 表示由驱动选择
+    unsigned get_core_mask() const { return backend ? backend->get_core_mask() : 0; }
+    const StartupTimeline &get_timeline() const { return timeline; }
     cv::Mat infer(cv::Mat ori_img);
+    // 同步检测一幅图（整帧或分块推理中的一块），不绘制，结果为该图坐标
+    // select_shape 为 false 时使用当前输入形状，不切换动态形状
+    int detect(const cv::Mat &img, detect_result_group_t *group, bool select_shape = false);
+    // 在图上绘制检测框
+    static void draw(cv::Mat &img, const detect_result_group_t &group);
+    int get_input_width() const { return width; }
+    int get_input_height() const { return height; }
+    // 取出异步模式下仍在上下文中的最后一帧，同步模式返回空图
+    cv::Mat flush();
     ~rkYolo();
 };
 
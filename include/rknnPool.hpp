@@ -5,9 +5,18 @@
 #include <vector>
 #include <iostream>
 #include <mutex>
+#include <condition_variable>
 #include <queue>
 #include <memory>
+#include <chrono>
+#include <algorithm>
+#include <numeric>
 #include "SharedTypes.hpp"
+#include "dispatcher.h"
+#include "tiling.h"
+#include "box_propagator.h"
+#include "tracker.h"
+#include "classifier.h"
 
 // rknnModel模型类, inputType模型输入类型, outputType模型输出类型
 template <typename rknnModel, typename inputType, typename outputType>
@@ -15,22 +24,92 @@ class rknnPool
 {
 private:
     AppConfig config; // 配置参数
-    long long id;
-    std::mutex idMtx, queueMtx;
+    // 上下文数量：threads 个主后端上下文，之后为 cpu_contexts 个 CPU 后端上下文
+    int contexts;
+    std::mutex queueMtx;
+    // 按每个上下文、每个核心正在处理的帧数选择上下文
+    std::unique_ptr<Dispatcher> dispatcher;
     std::unique_ptr<dpool::ThreadPool> pool;
     std::queue<std::future<outputType>> futs;
     std::vector<std::shared_ptr<rknnModel>> models;
+    // 每个上下文的执行顺序：异步模式下上下文返回的是它上一次收到的帧，同一上下文的任务必须按提交顺序执行，
+    // 线程池的多个线程可能同时取到同一上下文的任务，rkYolo 的互斥锁不保证先后，用序号排队
+    struct ContextTurn
+    {
+        std::mutex mtx;
+        std::condition_variable cv;
+        uint64_t next = 0;    // 下一个提交的任务的序号，在 queueMtx 下分配
+        uint64_t serving = 0; // 允许执行的序号
+    };
+    std::unique_ptr<ContextTurn[]> turns;
+    // 分块推理：各块分散到上下文上检测，合并任务在单独的线程中等待全部块完成，不占用推理线程
+    // 运动门控：跳过的帧同样在该线程中等待上一次推理的结果并绘制
+    std::unique_ptr<dpool::ThreadPool> mergePool;
+    TileMergeWorkspace mergeWs;
+    // 最近一次提交推理的帧的检测结果，跳过的帧沿用
+    std::shared_future<detect_result_group_t> lastResult;
+    // 关键帧检测：中间帧在合并线程中按顺序从上一帧传播检测框
+    std::unique_ptr<BoxPropagator> propagator;
+    // 多目标跟踪：在合并线程中按帧顺序为检测框分配轨迹编号
+    std::unique_ptr<Tracker> tracker;
+    // 二级分类器（由调用方持有）：在合并线程中对检测框的裁剪图批量分类，跟踪之后运行以便按轨迹缓存结果
+    Classifier *classifier = nullptr;
+
+    // 统计：每帧从 put 到推理完成的延迟（毫秒）、返回的有效帧数和起止时间
+    std::mutex statMtx;
+    std::vector<float> latencies;
+    long long frames;
+    // 分块推理已完成的块数
+    long long tiles;
+    // 运动门控跳过、沿用上一次结果的帧数
+    long long reused;
+    // 关键帧检测中由光流传播的帧数
+    long long propagated;
+    bool started;
+    std::chrono::steady_clock::time_point firstPut, lastGet;
 
 protected:
-    int getModelId();
+    int getModelId(bool urgent = false);
+    // 为提交到该上下文的任务分配序号（持有 queueMtx 时调用）
+    uint64_t takeTurn(int modelId);
+    // 任务开始前等待轮到自己，结束后交给下一个序号
+    void waitTurn(int modelId, uint64_t ticket);
+    void endTurn(int modelId);
+    // 打印每个上下文的启动时间线（相对线程池初始化开始的毫秒数）
+    void printTimeline(std::chrono::steady_clock::time_point start);
+    // 整帧或分块检测一帧，合并、跟踪、分类后绘制；gray 不为空时作为关键帧重置光流传播
+    int putMerged(inputType& inputData, bool tiled, const cv::Mat& gray);
 
 public:
     rknnPool(const AppConfig& config);
     int init();
-    // 模型推理
-    int put(inputType& inputData);
+    // 模型推理，urgent 为延迟敏感的帧（CORE_MIXED 模式下交给独占核心 0、1 的第一个上下文）
+    int put(inputType& inputData, bool urgent = false);
+    // 分块推理（AppConfig::tiling）：一帧切成多块分别交给负载最轻的上下文，全部完成后合并、绘制，作为一帧返回
+    int putTiled(inputType& inputData);
+    // 同步检测并绘制一帧，记录检测结果供 putReuse 沿用（运动门控中需要推理的帧）
+    int putDetect(inputType& inputData);
+    // 不推理，在该帧上绘制最近一次推理的结果（运动门控跳过的帧），结果顺序与输入一致
+    int putReuse(inputType& inputData);
+    // 关键帧：检测（AppConfig::tiling 时分块）并绘制，以结果重置光流传播，gray 为 BoxPropagator::prepare 的输出
+    int putKeyframe(inputType& inputData, const cv::Mat& gray);
+    // 中间帧：不推理，用光流把上一帧的框传播到该帧并绘制
+    int putPropagate(inputType& inputData, const cv::Mat& gray);
+    // 跟踪（AppConfig::track）或二级分类（AppConfig::cls_model）：检测（AppConfig::tiling 时分块）后
+    // 在合并线程中按帧顺序跟踪、分类并绘制
+    int putOrdered(inputType& inputData);
     // 获取推理结果
     int get(outputType& outputData);
+    // 取出各模型实例中尚未返回的帧（异步模式），之后用 get 获取
+    int flush();
+    // 打印核心映射模式、平均 FPS 与延迟分位数，以及调度计数
+    void report();
+    // 调度计数，init 之后有效
+    Dispatcher *get_dispatcher() { return dispatcher.get(); }
+    // 关键帧检测（AppConfig::keyframe_interval）的光流传播，主线程用它决定下一帧是否为关键帧
+    BoxPropagator *get_propagator() { return propagator.get(); }
+    // 二级分类器（AppConfig::cls_model），init 之后、提交第一帧之前设置，生命周期长于线程池
+    void set_classifier(Classifier *classifier) { this->classifier = classifier; }
     ~rknnPool();
 };
 
@@ -38,7 +117,12 @@ template <typename rknnModel, typename inputType, typename outputType>
 rknnPool<rknnModel, inputType, outputType>::rknnPool(const AppConfig& config)
 {
     this->config = config;
-    this->id = 0;
+    this->contexts = config.threads;
+    this->frames = 0;
+    this->tiles = 0;
+    this->reused = 0;
+    this->propagated = 0;
+    this->started = false;
 }
 
 template <typename rknnModel, typename inputType, typename outputType>
@@ -46,14 +130,28 @@ int rknnPool<rknnModel, inputType, outputType>::init()
 {
     try
     {
+        // CPU 上下文不支持异步，结果不会延迟一帧返回，与异步的上下文混用会打乱结果顺序
+        if (this->config.cpu_contexts > 0 && this->config.async)
+            std::cout << "cpu contexts are ignored in async mode" << std::endl;
+        else
+            this->contexts = this->config.threads + this->config.cpu_contexts;
         // 创建一个线程池，并将其存储在 this->pool 中
-        this->pool = std::make_unique<dpool::ThreadPool>(this->config.threads);
+        this->pool = std::make_unique<dpool::ThreadPool>(this->contexts);
+        this->turns = std::make_unique<ContextTurn[]>(this->contexts);
         // 创建多个模型实例，并将它们存储在 models 向量中
-        for (int i = 0; i < this->config.threads; i++)
+        for (int i = 0; i < this->contexts; i++)
+        {
             // 创建 rknnModel 实例，并获取一个指向该对象的智能指针，将其存储在 models 向量中
             // 传递 this->modelPath 作为构造函数的参数
             // models.push_back(std::make_shared<rknnModel>(this->modelPath.c_str()));
-            models.push_back(std::make_shared<rknnModel>(this->config));
+            AppConfig modelConfig = this->config;
+            // 排在后面的是 CPU 后端上下文，NPU 上下文都在处理帧时由负载感知调度分配
+            if (i >= this->config.threads) {
+                modelConfig.backend = BACKEND_TYPE::BACKEND_CPU;
+                modelConfig.model_path = this->config.cpu_model;
+            }
+            models.push_back(std::make_shared<rknnModel>(modelConfig));
+        }
     }// 如果 try 块中的代码抛出了异常，程序会跳转到 catch 块
     catch (const std::bad_alloc &e)
     {
@@ -61,30 +159,98 @@ int rknnPool<rknnModel, inputType, outputType>::init()
         return -1;
     }
     // 初始化模型
-    for (int i = 0, ret = 0; i < this->config.threads; i++)
+    // 第一个上下文加载模型，其余上下文共享它的权重，彼此独立，在线程池中并行创建
+    auto start = std::chrono::steady_clock::now();
+    int ret = models[0]->init(models[0]->get_pctx(), false);
+    if (ret != 0)
+        return ret;
+    std::vector<std::future<int>> inits;
+    for (int i = 1; i < this->contexts; i++)
+        inits.push_back(pool->submit(&rknnModel::init, models[i], models[0]->get_pctx(), true));
+    // 等待全部完成后再返回，失败的上下文不能留给析构时仍在初始化
+    for (auto &f : inits)
     {
-        // rknnModel->init
-        // i = 0 时，初始化模型，i != 0 时，共享权重参数
-        ret = models[i]->init(models[0]->get_pctx(), i != 0);
-        if (ret != 0)
-            return ret;
+        int r = f.get();
+        if (r != 0 && ret == 0)
+            ret = r;
     }
+    if (ret != 0)
+        return ret;
+    printTimeline(start);
+
+    // 异步模式下每个上下文返回的是它上一次收到的帧，只有轮询分配才能保证结果顺序
+    int policy = this->config.async ? DISPATCH_POLICY::DISPATCH_ROUND_ROBIN : this->config.dispatch;
+    dispatcher = std::make_unique<Dispatcher>(this->contexts, policy);
+    for (int i = 0; i < this->contexts; i++)
+        dispatcher->set_cores(i, models[i]->get_core_mask());
+    if (this->config.tiling || this->config.gate_interval > 0 || this->config.keyframe_interval > 0 ||
+        this->config.track != TRACK_MODE::TRACK_OFF || !this->config.cls_model.empty())
+        mergePool = std::make_unique<dpool::ThreadPool>(1);
+    if (this->config.track != TRACK_MODE::TRACK_OFF)
+        tracker = std::make_unique<Tracker>(this->config.track, this->config.track_buffer);
+    if (this->config.keyframe_interval > 0)
+        propagator = std::make_unique<BoxPropagator>(this->config);
 
     return 0;
 }
 
 template <typename rknnModel, typename inputType, typename outputType>
-int rknnPool<rknnModel, inputType, outputType>::getModelId()
+void rknnPool<rknnModel, inputType, outputType>::printTimeline(std::chrono::steady_clock::time_point start)
+{
+    auto ms = [start](std::chrono::steady_clock::time_point t) {
+        return std::chrono::duration<double, std::milli>(t - start).count();
+    };
+    printf("startup timeline (ms from pool init):\n");
+    printf("%8s %8s %8s %8s %8s %8s\n", "context", "begin", "load", "query", "warmup", "ready");
+    double ready = 0;
+    for (int i = 0; i < this->contexts; i++)
+    {
+        const StartupTimeline &t = models[i]->get_timeline();
+        printf("%8d %8.1f %8.1f %8.1f %8.1f %8.1f\n", i, ms(t.begin), ms(t.loaded) - ms(t.begin),
+               ms(t.queried) - ms(t.loaded), ms(t.warmed) - ms(t.queried), ms(t.warmed));
+        ready = std::max(ready, ms(t.warmed));
+    }
+    printf("all %d contexts ready in %.1f ms\n", this->contexts, ready);
+}
+
+template <typename rknnModel, typename inputType, typename outputType>
+int rknnPool<rknnModel, inputType, outputType>::getModelId(bool urgent)
+{
+    // 混合模式：延迟敏感的帧直接交给独占核心 0、1 的第一个上下文，其余帧只分配给核心 2 上的上下文
+    if (this->config.core_mode == CORE_MODE::CORE_MIXED)
+        return urgent ? dispatcher->acquire_fixed(0) : dispatcher->acquire(1);
+    // 负载感知：优先空闲、所用核心最轻的上下文；轮询时与原先的取模相同
+    return dispatcher->acquire();
+}
+
+template <typename rknnModel, typename inputType, typename outputType>
+uint64_t rknnPool<rknnModel, inputType, outputType>::takeTurn(int modelId)
+{
+    return turns[modelId].next++;
+}
+
+template <typename rknnModel, typename inputType, typename outputType>
+void rknnPool<rknnModel, inputType, outputType>::waitTurn(int modelId, uint64_t ticket)
 {
-    std::lock_guard<std::mutex> lock(idMtx);
-    // 循环取模，保证 modelId 在 0 到 threadNum-1 之间
-    int modelId = id % this->config.threads;
-    id++;
-    return modelId;
+    // 线程池按提交顺序取任务，更早的序号一定已被其他线程取走并在执行，不会互相等待
+    ContextTurn &turn = turns[modelId];
+    std::unique_lock<std::mutex> lock(turn.mtx);
+    turn.cv.wait(lock, [&turn, ticket] { return turn.serving == ticket; });
 }
 
 template <typename rknnModel, typename inputType, typename outputType>
-int rknnPool<rknnModel, inputType, outputType>::put(inputType& inputData)
+void rknnPool<rknnModel, inputType, outputType>::endTurn(int modelId)
+{
+    ContextTurn &turn = turns[modelId];
+    {
+        std::lock_guard<std::mutex> lock(turn.mtx);
+        turn.serving++;
+    }
+    turn.cv.notify_all();
+}
+
+template <typename rknnModel, typename inputType, typename outputType>
+int rknnPool<rknnModel, inputType, outputType>::put(inputType& inputData, bool urgent)
 {
     // std::lock_guard 会锁定传入的互斥锁，并在析构函数中(作用域结束)自动解锁
     // 只要 std::lock_guard 对象存在，互斥锁就会保持锁定状态
@@ -96,7 +262,196 @@ int rknnPool<rknnModel, inputType, outputType>::put(inputType& inputData)
     // std::future 表示一个异步操作的结果
     // infer 执行推理
     // models[this->getModelId()] 要执行infer的实例
-    futs.push(pool->submit(&rknnModel::infer, models[this->getModelId()], inputData));
+    // 记录提交时刻，推理完成时统计延迟（异步模式下为该上下文返回结果的时刻，包含一帧的延迟返回）
+    auto start = std::chrono::steady_clock::now();
+    {
+        std::lock_guard<std::mutex> statLock(statMtx);
+        if (!started) {
+            firstPut = start;
+            started = true;
+        }
+    }
+    int modelId = this->getModelId(urgent);
+    std::shared_ptr<rknnModel> model = models[modelId];
+    uint64_t ticket = takeTurn(modelId);
+    futs.push(pool->submit([this, model, modelId, ticket, start](inputType input) {
+        waitTurn(modelId, ticket);
+        auto begin = std::chrono::steady_clock::now();
+        outputType output = model->infer(input);
+        auto end = std::chrono::steady_clock::now();
+        endTurn(modelId);
+        // 推理完成，减少该上下文和核心的 in_flight
+        dispatcher->release(modelId, std::chrono::duration<double, std::milli>(end - begin).count());
+        float ms = std::chrono::duration<float, std::milli>(end - start).count();
+        std::lock_guard<std::mutex> statLock(statMtx);
+        latencies.push_back(ms);
+        return output;
+    }, inputData));
+    return 0;
+}
+
+template <typename rknnModel, typename inputType, typename outputType>
+int rknnPool<rknnModel, inputType, outputType>::putTiled(inputType& inputData)
+{
+    return putMerged(inputData, true, cv::Mat());
+}
+
+template <typename rknnModel, typename inputType, typename outputType>
+int rknnPool<rknnModel, inputType, outputType>::putKeyframe(inputType& inputData, const cv::Mat& gray)
+{
+    return putMerged(inputData, this->config.tiling, gray);
+}
+
+template <typename rknnModel, typename inputType, typename outputType>
+int rknnPool<rknnModel, inputType, outputType>::putOrdered(inputType& inputData)
+{
+    return putMerged(inputData, this->config.tiling, cv::Mat());
+}
+
+template <typename rknnModel, typename inputType, typename outputType>
+int rknnPool<rknnModel, inputType, outputType>::putMerged(inputType& inputData, bool tiled, const cv::Mat& gray)
+{
+    std::lock_guard<std::mutex> lock(queueMtx);
+
+    auto start = std::chrono::steady_clock::now();
+    {
+        std::lock_guard<std::mutex> statLock(statMtx);
+        if (!started) {
+            firstPut = start;
+            started = true;
+        }
+    }
+    // 不分块时整帧作为一块，按源图比例选择输入形状
+    std::vector<tile_t> layout;
+    if (tiled)
+        layout = make_tiles(inputData.cols, inputData.rows, models[0]->get_input_width(),
+                            models[0]->get_input_height(), this->config.tile_cols, this->config.tile_rows,
+                            this->config.tile_overlap, this->config.tile_full);
+    else
+        layout.push_back({cv::Rect(0, 0, inputData.cols, inputData.rows), true});
+    auto result = std::make_shared<std::promise<detect_result_group_t>>();
+    lastResult = result->get_future().share();
+    // 每块单独分配上下文，负载感知调度把同一帧的块分散到各个核心；分块时在全部上下文中选择，
+    // 混合模式下也会用到核心 0、1，整帧推理按 getModelId 区分延迟敏感的流
+    auto tileFuts = std::make_shared<std::vector<std::future<detect_result_group_t>>>();
+    for (const tile_t &tile : layout)
+    {
+        int modelId = tiled ? dispatcher->acquire() : this->getModelId(this->config.urgent);
+        std::shared_ptr<rknnModel> model = models[modelId];
+        cv::Rect rect = tile.rect;
+        tileFuts->push_back(pool->submit([this, model, modelId, rect, tiled](inputType input) {
+            auto begin = std::chrono::steady_clock::now();
+            detect_result_group_t group;
+            if (tiled)
+                model->detect(input(rect), &group);
+            else
+                model->detect(input, &group, true);
+            auto end = std::chrono::steady_clock::now();
+            dispatcher->release(modelId, std::chrono::duration<double, std::milli>(end - begin).count());
+            return group;
+        }, inputData));
+    }
+    // 合并在单独的线程中按提交顺序进行，结果顺序与输入一致
+    futs.push(mergePool->submit([this, layout, tileFuts, result, start, tiled, gray](inputType input) {
+        std::vector<detect_result_group_t> groups;
+        groups.reserve(layout.size());
+        for (auto &f : *tileFuts)
+            groups.push_back(f.get());
+        detect_result_group_t merged;
+        if (tiled)
+            merge_tile_detections(layout, groups.data(), input.cols, input.rows, this->config.nms_mode, NMS_THRESH,
+                                  mergeWs, &merged);
+        else
+            merged = groups[0];
+        // 先分配轨迹编号，传播的框沿用
+        if (tracker)
+            tracker->update(&merged);
+        // 传播的框沿用关键帧的分类结果
+        if (classifier)
+            classifier->classify(input, &merged);
+        if (propagator && !gray.empty())
+            propagator->reset(gray, merged, input.cols, input.rows);
+        rknnModel::draw(input, merged);
+        result->set_value(merged);
+        float ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::lock_guard<std::mutex> statLock(statMtx);
+        latencies.push_back(ms);
+        if (tiled)
+            tiles += layout.size();
+        return input;
+    }, inputData));
+    return 0;
+}
+
+template <typename rknnModel, typename inputType, typename outputType>
+int rknnPool<rknnModel, inputType, outputType>::putDetect(inputType& inputData)
+{
+    std::lock_guard<std::mutex> lock(queueMtx);
+
+    auto start = std::chrono::steady_clock::now();
+    {
+        std::lock_guard<std::mutex> statLock(statMtx);
+        if (!started) {
+            firstPut = start;
+            started = true;
+        }
+    }
+    auto result = std::make_shared<std::promise<detect_result_group_t>>();
+    lastResult = result->get_future().share();
+    int modelId = this->getModelId(this->config.urgent);
+    std::shared_ptr<rknnModel> model = models[modelId];
+    futs.push(pool->submit([this, model, modelId, result, start](inputType input) {
+        auto begin = std::chrono::steady_clock::now();
+        detect_result_group_t group;
+        model->detect(input, &group, true);
+        auto end = std::chrono::steady_clock::now();
+        dispatcher->release(modelId, std::chrono::duration<double, std::milli>(end - begin).count());
+        result->set_value(group);
+        rknnModel::draw(input, group);
+        float ms = std::chrono::duration<float, std::milli>(end - start).count();
+        std::lock_guard<std::mutex> statLock(statMtx);
+        latencies.push_back(ms);
+        return input;
+    }, inputData));
+    return 0;
+}
+
+template <typename rknnModel, typename inputType, typename outputType>
+int rknnPool<rknnModel, inputType, outputType>::putReuse(inputType& inputData)
+{
+    std::lock_guard<std::mutex> lock(queueMtx);
+
+    // 线程池按提交顺序取任务，等待的推理任务一定已经在运行或完成，不会互相等待
+    std::shared_future<detect_result_group_t> result = lastResult;
+    futs.push(mergePool->submit([this, result](inputType input) {
+        if (result.valid())
+            rknnModel::draw(input, result.get());
+        std::lock_guard<std::mutex> statLock(statMtx);
+        reused++;
+        return input;
+    }, inputData));
+    return 0;
+}
+
+template <typename rknnModel, typename inputType, typename outputType>
+int rknnPool<rknnModel, inputType, outputType>::putPropagate(inputType& inputData, const cv::Mat& gray)
+{
+    std::lock_guard<std::mutex> lock(queueMtx);
+
+    // 合并线程按提交顺序执行，传播时上一个关键帧已经完成重置
+    auto result = std::make_shared<std::promise<detect_result_group_t>>();
+    lastResult = result->get_future().share();
+    futs.push(mergePool->submit([this, result, gray](inputType input) {
+        detect_result_group_t group;
+        propagator->propagate(gray, input.cols, input.rows, &group);
+        if (tracker)
+            tracker->update(&group);
+        rknnModel::draw(input, group);
+        result->set_value(group);
+        std::lock_guard<std::mutex> statLock(statMtx);
+        propagated++;
+        return input;
+    }, inputData));
     return 0;
 }
 
@@ -108,12 +463,75 @@ int rknnPool<rknnModel, inputType, outputType>::get(outputType& outputData)
         return 1;
     outputData = futs.front().get();
     futs.pop();
+    if (!outputData.empty()) {
+        std::lock_guard<std::mutex> statLock(statMtx);
+        frames++;
+        lastGet = std::chrono::steady_clock::now();
+    }
     return 0;
 }
 
+template <typename rknnModel, typename inputType, typename outputType>
+int rknnPool<rknnModel, inputType, outputType>::flush()
+{
+    std::lock_guard<std::mutex> lock(queueMtx);
+    // 每个上下文恰好取一次，与调度策略和核心模式无关；异步模式下每个实例返回的是它上一次收到的帧，
+    // 按最近一次分配的先后取，结果顺序与输入一致
+    std::vector<int> order = dispatcher->dispatch_order();
+    for (int i = 0; i < this->contexts; i++)
+    {
+        int modelId = dispatcher->acquire_fixed(order[i]);
+        std::shared_ptr<rknnModel> model = models[modelId];
+        uint64_t ticket = takeTurn(modelId);
+        futs.push(pool->submit([this, model, modelId, ticket]() {
+            waitTurn(modelId, ticket);
+            outputType output = model->flush();
+            endTurn(modelId);
+            dispatcher->release(modelId, 0);
+            return output;
+        }));
+    }
+    return 0;
+}
+
+template <typename rknnModel, typename inputType, typename outputType>
+void rknnPool<rknnModel, inputType, outputType>::report()
+{
+    std::lock_guard<std::mutex> lock(statMtx);
+    if (frames == 0 || latencies.empty()) {
+        std::cout << "core mode: " << core_mode_name(this->config.core_mode) << ", no frames" << std::endl;
+        return;
+    }
+    std::vector<float> sorted = latencies;
+    std::sort(sorted.begin(), sorted.end());
+    auto percentile = [&sorted](double q) {
+        size_t idx = std::min(sorted.size() - 1, (size_t)(q * sorted.size()));
+        return sorted[idx];
+    };
+    double seconds = std::chrono::duration<double>(lastGet - firstPut).count();
+    printf("core mode: %s, contexts: %d, frames: %lld, FPS: %.1f, latency avg/p50/p99: %.1f/%.1f/%.1f ms\n",
+           core_mode_name(this->config.core_mode), this->contexts, frames,
+           seconds > 0 ? frames / seconds : 0.0,
+           std::accumulate(sorted.begin(), sorted.end(), 0.0) / sorted.size(), percentile(0.5), percentile(0.99));
+    // 运动门控：跳过的帧也计入 FPS，延迟只统计推理的帧
+    if (reused > 0)
+        printf("reused frames: %lld (%.1f%%)\n", reused, 100.0 * reused / frames);
+    // 关键帧检测：传播的帧不推理，同样计入 FPS
+    if (propagated > 0)
+        printf("propagated frames: %lld (%.1f%%)\n", propagated, 100.0 * propagated / frames);
+    // 分块推理：NPU 的吞吐按块计，帧率按合并后的整帧计
+    if (tiles > 0)
+        printf("tiles: %.1f per frame, tiles/s: %.1f, frames/s: %.1f\n", (double)tiles / frames,
+               seconds > 0 ? tiles / seconds : 0.0, seconds > 0 ? frames / seconds : 0.0);
+    if (tracker)
+        tracker->report();
+    dispatcher->print_stats();
+}
+
 template <typename rknnModel, typename inputType, typename outputType>
 rknnPool<rknnModel, inputType, outputType>::~rknnPool()
 {
+    // 合并任务等待的块在 pool 中运行，先取完合并结果
     while (!futs.empty())
     {
         outputType temp = futs.front().get();
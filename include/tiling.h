@@ -0,0 +1,79 @@
+/*
+ * @Author: Li RF
+ * @Date: 2025-04-18 10:05:37
+ * @LastEditors: Li RF
+ * @LastEditTime: 2025-04-18 10:05:37
+ * @Description: 分块推理：高分辨率源图切成相互重叠的块分别检测，再把各块的结果换算回整帧坐标并做跨块 NMS
+ *               远处的小目标不再随整帧一起缩小到模型输入以下；可选的整帧缩小一块用于找回被切开的大目标
+ * Email: 1125962926@qq.com
+ * Copyright (c) 2025 Li RF, All Rights Reserved.
+ */
+#ifndef _RKNN_YOLOV5_DEMO_TILING_H_
+#define _RKNN_YOLOV5_DEMO_TILING_H_
+
+#include <vector>
+
+#include "opencv2/core/core.hpp"
+#include "nms.h"
+#include "postprocess.h"
+
+/* 检测框距离块内部切边小于块边长的该比例时视为被切开，交给相邻的块 */
+#define TILE_EDGE_MARGIN 0.01f
+/* 跨块 NMS 空间哈希的网格边长（整帧像素） */
+#define TILE_NMS_CELL 64.f
+
+/* 一帧中的一块 */
+typedef struct _tile_t
+{
+    cv::Rect rect; // 源图中的区域
+    bool full;     // 整帧缩小的一块，没有内部切边
+} tile_t;
+
+/* 跨块合并的临时缓冲区，跨帧复用 */
+struct TileMergeWorkspace
+{
+    std::vector<float> boxes; // 每 4 个为一组 (x, y, w, h)，整帧坐标
+    std::vector<float> scores;
+    std::vector<int> class_ids;
+    std::vector<const detect_result_t *> sources;
+    // 类别名到 class_ids 的映射，按首次出现的顺序
+    std::vector<const char *> names;
+    NmsScratch nms;
+    int keep[OBJ_NUMB_MAX_SIZE];
+};
+
+/**
+ * @Description: 计算分块布局，同一行 / 列的块在源图上均匀分布，首尾两块贴齐边缘
+ *               cols、rows 为 0 时按模型输入尺寸切块（1:1 像素，不缩放），块数由重叠比例决定；
+ *               否则按 cols x rows 均分，块大于模型输入时由前处理缩放
+ * @param {int} src_w: 源图宽度
+ * @param {int} src_h: 源图高度
+ * @param {int} model_w: 模型输入宽度
+ * @param {int} model_h: 模型输入高度
+ * @param {int} cols: 列数，0 为自动
+ * @param {int} rows: 行数，0 为自动
+ * @param {float} overlap: 相邻两块的重叠部分占块边长的比例
+ * @param {bool} full_frame: 追加整帧缩小的一块（只有一块时不追加）
+ * @return {vector<tile_t>}: 按行优先排列，整帧块在最后
+ */
+std::vector<tile_t> make_tiles(int src_w, int src_h, int model_w, int model_h, int cols, int rows, float overlap,
+                               bool full_frame);
+
+/**
+ * @Description: 合并各块的检测结果：块坐标加上块的偏移换算回整帧，丢弃贴着块内部切边（被切开）的框，
+ *               被切开的目标只要小于重叠部分，就完整地落在相邻的块中；再按类别做跨块 NMS
+ * @param {vector<tile_t>} &tiles: make_tiles 的结果
+ * @param {detect_result_group_t} *groups: 每块的检测结果（块坐标），顺序与 tiles 一致
+ * @param {int} src_w: 源图宽度
+ * @param {int} src_h: 源图高度
+ * @param {int} nms_mode: NMS_MODE
+ * @param {float} nms_threshold: IoU 阈值
+ * @param {TileMergeWorkspace} &ws: 临时缓冲区
+ * @param {detect_result_group_t} *merged: 输出，整帧坐标，按置信度降序
+ * @return {int}: 合并后的检测框数量
+ */
+int merge_tile_detections(const std::vector<tile_t> &tiles, const detect_result_group_t *groups, int src_w,
+                          int src_h, int nms_mode, float nms_threshold, TileMergeWorkspace &ws,
+                          detect_result_group_t *merged);
+
+#endif //_RKNN_YOLOV5_DEMO_TILING_H_
@@ -0,0 +1,122 @@
+/*
+ * @Author: Li RF
+ * @Date: 2025-04-21 14:26:09
+ * @LastEditors: Li RF
+ * @LastEditTime: 2025-04-21 14:26:09
+ * @Description: 多目标跟踪（ByteTrack）：后处理之后为每个检测框分配稳定的轨迹编号
+ *               卡尔曼滤波状态为 (cx, cy, a, h) 及其速度，按维度以 SoA 数组存放；匀速模型下观测只含位置，
+ *               过程与观测噪声都是对角阵，协方差分解为每个维度独立的 2x2 块，预测与更新按轨迹连续向量化
+ *               关联分两阶段：高分检测先与全部已确认轨迹（含丢失的）匹配，低分检测再与剩余的跟踪中轨迹匹配，
+ *               代价为 IoU 矩阵，分配用贪心或匈牙利算法（按连通分量分解后求解）
+ *               每路视频流持有一个实例，在合并线程中按帧顺序调用
+ * Email: 1125962926@qq.com
+ * Copyright (c) 2025 Li RF, All Rights Reserved.
+ */
+#ifndef _RKNN_YOLOV5_DEMO_TRACKER_H_
+#define _RKNN_YOLOV5_DEMO_TRACKER_H_
+
+#include <string>
+#include <vector>
+
+#include "AlignedBuffer.hpp"
+#include "postprocess.h"
+
+/* 置信度不低于该值的检测参与第一阶段匹配 */
+#define TRACK_HIGH_THRESH 0.5f
+/* 置信度低于该值的检测不参与跟踪 */
+#define TRACK_LOW_THRESH 0.1f
+/* 没有匹配上的高分检测置信度不低于该值时新建轨迹 */
+#define TRACK_NEW_THRESH 0.6f
+/* 第一阶段（高分检测）、第二阶段（低分检测）和未确认轨迹匹配所需的最小 IoU */
+#define TRACK_IOU_HIGH 0.2f
+#define TRACK_IOU_LOW 0.5f
+#define TRACK_IOU_TENTATIVE 0.3f
+
+/* 轨迹状态 */
+enum TRACK_STATE {
+    TRACK_TENTATIVE = 0, // 新建，下一帧再次匹配上才确认并分配编号
+    TRACK_TRACKED = 1,   // 本帧匹配上
+    TRACK_LOST = 2,      // 暂时没有匹配上，保留 buffer 帧
+};
+
+/* 关联的临时缓冲区，跨帧复用 */
+struct TrackScratch
+{
+    // 参与本次关联的轨迹的预测框（SoA，连续存放以便向量化）
+    AlignedBuffer<float> tx1, ty1, tx2, ty2, tarea;
+    AlignedBuffer<int> tcls;
+    // IoU 矩阵，按检测行优先
+    AlignedBuffer<float> iou;
+    // 候选匹配对与分配结果
+    std::vector<std::pair<float, int>> pairs;
+    std::vector<int> row_match, col_match;
+    // 匈牙利算法：并查集、按分量排列的节点、分量内的行列、增广路与势
+    std::vector<int> parent, order, comp_rows, comp_cols, way, p;
+    std::vector<double> u, v, minv;
+    std::vector<char> used;
+};
+
+class Tracker
+{
+public:
+    /**
+     * @Description: 创建跟踪器
+     * @param {int} match_mode: 分配方式，TRACK_MODE
+     * @param {int} buffer: 丢失的轨迹保留的帧数
+     * @return {*}
+     */
+    Tracker(int match_mode, int buffer);
+
+    /**
+     * @Description: 用一帧的检测结果更新轨迹，为属于已确认轨迹的检测写入 track_id，其余写入 -1
+     * @param {detect_result_t} *dets: 检测结果（源图坐标），数量不受 OBJ_NUMB_MAX_SIZE 限制
+     * @param {int} count: 检测数量
+     * @return {int}: 本帧跟踪中的轨迹数
+     */
+    int update(detect_result_t *dets, int count);
+    int update(detect_result_group_t *group) { return update(group->results, group->count); }
+
+    // 活动轨迹数（含未确认和丢失的）
+    int size() const { return (int)id.size(); }
+    // 打印帧数、已分配的编号数与平均耗时
+    void report() const;
+
+private:
+    int match_mode;
+    int buffer;
+    int frame = 0;
+    int next_id = 0;
+    long long frames = 0;
+    double total_us = 0;
+
+    // 轨迹属性
+    std::vector<int> id, state, cls, last_frame;
+    // 卡尔曼滤波：每个维度（0 cx、1 cy、2 a、3 h）的位置、速度和 2x2 协方差块
+    std::vector<float> pos[4], vel[4], p00[4], p01[4], p11[4];
+    // 类别名，按出现顺序编号
+    std::vector<std::string> names;
+
+    // 每帧的检测：框（x1, y1, x2, y2）、类别与分组
+    std::vector<float> dx1, dy1, dx2, dy2;
+    std::vector<int> dcls;
+    std::vector<int> high, low, rest, cand, matched;
+    TrackScratch ws;
+
+    int class_id(const char *name);
+    void predict();
+    void add_track(const detect_result_t &det, int c, bool confirmed);
+    void correct(int t, const detect_result_t &det);
+    void remove_tracks();
+    /**
+     * @Description: 关联一组轨迹与一组检测，结果写入 ws.row_match（每个轨迹对应的检测下标，-1 为未匹配）
+     * @param {vector<int>} &tracks: 轨迹下标
+     * @param {vector<int>} &dets: 检测下标
+     * @param {float} min_iou: 最小 IoU
+     * @return {*}
+     */
+    void associate(const std::vector<int> &tracks, const std::vector<int> &dets, float min_iou);
+    void assign_greedy(int rows, int cols, float min_iou);
+    void assign_hungarian(int rows, int cols, float min_iou);
+};
+
+#endif //_RKNN_YOLOV5_DEMO_TRACKER_H_
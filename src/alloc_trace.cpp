@@ -0,0 +1,48 @@
+/*
+ * @Author: Li RF
+ * @Date: 2025-04-08 09:41:20
+ * @LastEditors: Li RF
+ * @LastEditTime: 2025-04-08 09:41:20
+ * @Description: 调试用的内存分配计数，未定义 ALLOC_TRACE 时本文件为空
+ * Email: 1125962926@qq.com
+ * Copyright (c) 2025 Li RF, All Rights Reserved.
+ */
+#include "alloc_trace.h"
+
+#ifdef ALLOC_TRACE
+#include <stdlib.h>
+#include <new>
+
+// 每个线程独立计数，推理线程之间互不干扰
+static thread_local uint64_t alloc_count = 0;
+
+uint64_t alloc_trace_count() { return alloc_count; }
+
+void alloc_trace_note() { alloc_count++; }
+
+void *operator new(size_t size)
+{
+    alloc_count++;
+    if (size == 0)
+        size = 1;
+    void *p = malloc(size);
+    if (p == nullptr)
+        throw std::bad_alloc();
+    return p;
+}
+
+void *operator new[](size_t size) { return operator new(size); }
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept
+{
+    alloc_count++;
+    return malloc(size == 0 ? 1 : size);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &tag) noexcept { return operator new(size, tag); }
+
+void operator delete(void *p) noexcept { free(p); }
+void operator delete[](void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+void operator delete[](void *p, size_t) noexcept { free(p); }
+#endif
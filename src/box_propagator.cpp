@@ -0,0 +1,239 @@
+/*
+ * @Author: Li RF
+ * @Date: 2025-04-20 10:12:47
+ * @LastEditors: Li RF
+ * @LastEditTime: 2025-04-20 10:12:47
+ * @Description: 关键帧检测：框内特征点的金字塔 LK 光流传播与自适应关键帧间隔
+ * Email: 1125962926@qq.com
+ * Copyright (c) 2025 Li RF, All Rights Reserved.
+ */
+#include <math.h>
+#include <stdio.h>
+#include <algorithm>
+
+#include "opencv2/imgproc.hpp"
+#include "opencv2/video/tracking.hpp"
+
+#include "box_propagator.h"
+
+/**
+ * @Description: 中位数，会打乱 v 的顺序
+ */
+static float median(std::vector<float> &v)
+{
+    std::nth_element(v.begin(), v.begin() + v.size() / 2, v.end());
+    return v[v.size() / 2];
+}
+
+BoxPropagator::BoxPropagator(const AppConfig &config)
+{
+    max_interval = std::max(1, config.keyframe_interval);
+    motion_threshold = config.keyframe_motion;
+    conf_threshold = config.keyframe_conf;
+    // 从上限的一半开始，按画面情况调整
+    interval = std::max(1, max_interval / 2);
+    want_keyframe = false;
+    // 第一帧一定是关键帧
+    since_keyframe = max_interval;
+}
+
+void BoxPropagator::prepare(const cv::Mat &frame, cv::Mat &gray)
+{
+    cv::Size size(PROPAGATE_WIDTH, std::max(1, PROPAGATE_WIDTH * frame.rows / std::max(1, frame.cols)));
+    if (frame.channels() == 1) {
+        cv::resize(frame, gray, size, 0, 0, cv::INTER_AREA);
+    }
+    else {
+        cv::Mat small;
+        cv::resize(frame, small, size, 0, 0, cv::INTER_AREA);
+        cv::cvtColor(small, gray, cv::COLOR_BGR2GRAY);
+    }
+}
+
+bool BoxPropagator::next_keyframe()
+{
+    // 合并线程的提前请求最多晚几帧（队列中的帧数）被看到
+    if (want_keyframe.exchange(false) || since_keyframe + 1 >= interval.load()) {
+        since_keyframe = 0;
+        return true;
+    }
+    since_keyframe++;
+    return false;
+}
+
+/**
+ * @Description: 在框内选取特征点，纹理不足时补上均匀分布的网格点
+ * @param {Mat} &gray: 光流灰度图
+ * @param {track_t} &track: 框，坐标为源图坐标
+ * @param {float} sx, sy: 源图到光流图的缩放比例
+ * @return {*}
+ */
+void BoxPropagator::select_points(const cv::Mat &gray, track_t &track, float sx, float sy)
+{
+    track.points.clear();
+    cv::Rect roi((int)(track.x * sx), (int)(track.y * sy), std::max(2, (int)(track.w * sx)),
+                 std::max(2, (int)(track.h * sy)));
+    roi = roi & cv::Rect(0, 0, gray.cols, gray.rows);
+    if (roi.width < 2 || roi.height < 2)
+        return;
+    cv::goodFeaturesToTrack(gray(roi), track.points, PROPAGATE_POINTS, 0.01, std::max(2.0, roi.width / 8.0));
+    for (auto &p : track.points)
+    {
+        p.x += roi.x;
+        p.y += roi.y;
+    }
+    if (track.points.size() >= PROPAGATE_MIN_POINTS)
+        return;
+    for (int j = 0; j < 3; j++)
+        for (int i = 0; i < 3; i++)
+            track.points.push_back(
+                cv::Point2f(roi.x + roi.width * (0.2f + 0.3f * i), roi.y + roi.height * (0.2f + 0.3f * j)));
+}
+
+void BoxPropagator::reset(const cv::Mat &gray, const detect_result_group_t &group, int src_w, int src_h)
+{
+    keyframes++;
+    // 上一个区间没有提前推理且运动较小，放宽间隔
+    if (keyframes > 1 && !span_triggered && span_motion < motion_threshold * 0.5f)
+        interval = std::min(max_interval, interval.load() + 1);
+    span_motion = 0.f;
+    span_triggered = false;
+    want_keyframe = false;
+
+    float sx = (float)gray.cols / src_w, sy = (float)gray.rows / src_h;
+    group_id = group.id;
+    tracks.resize(group.count);
+    for (int i = 0; i < group.count; i++)
+    {
+        track_t &t = tracks[i];
+        t.det = group.results[i];
+        t.x = (float)t.det.box.left;
+        t.y = (float)t.det.box.top;
+        t.w = (float)(t.det.box.right - t.det.box.left);
+        t.h = (float)(t.det.box.bottom - t.det.box.top);
+        select_points(gray, t, sx, sy);
+    }
+    prev = gray;
+}
+
+void BoxPropagator::propagate(const cv::Mat &gray, int src_w, int src_h, detect_result_group_t *group)
+{
+    propagated++;
+    group->id = group_id;
+    group->count = 0;
+    if (prev.empty() || prev.rows != gray.rows || prev.cols != gray.cols) {
+        tracks.clear();
+        prev = gray;
+        return;
+    }
+
+    prev_points.clear();
+    for (const auto &t : tracks)
+        prev_points.insert(prev_points.end(), t.points.begin(), t.points.end());
+    if (!prev_points.empty())
+        cv::calcOpticalFlowPyrLK(prev, gray, prev_points, next_points, status, err, cv::Size(21, 21), 3);
+
+    float sx = (float)gray.cols / src_w, sy = (float)gray.rows / src_h;
+    size_t offset = 0, kept = 0;
+    int dropped = 0;
+    float motion_sum = 0.f, conf_sum = 0.f;
+    for (size_t i = 0; i < tracks.size(); i++)
+    {
+        track_t &t = tracks[i];
+        size_t n = t.points.size();
+        size_t first = offset;
+        offset += n;
+
+        // 各点位移的中位数作为框的平移，抗少量错误匹配
+        dx.clear();
+        dy.clear();
+        for (size_t k = first; k < first + n; k++)
+        {
+            if (!status[k])
+                continue;
+            dx.push_back(next_points[k].x - prev_points[k].x);
+            dy.push_back(next_points[k].y - prev_points[k].y);
+        }
+        size_t good = dx.size();
+        if (good < PROPAGATE_MIN_POINTS) {
+            dropped++;
+            continue;
+        }
+        float mx = median(dx), my = median(dy);
+
+        // 各点到框中心的距离之比的中位数作为尺度变化，每帧限制在 10% 以内
+        float pcx = (t.x + t.w * 0.5f) * sx, pcy = (t.y + t.h * 0.5f) * sy;
+        ratio.clear();
+        for (size_t k = first; k < first + n; k++)
+        {
+            if (!status[k])
+                continue;
+            float dp = hypotf(prev_points[k].x - pcx, prev_points[k].y - pcy);
+            if (dp > 1.f)
+                ratio.push_back(hypotf(next_points[k].x - pcx - mx, next_points[k].y - pcy - my) / dp);
+        }
+        float s = ratio.size() >= PROPAGATE_MIN_POINTS ? std::min(1.1f, std::max(0.9f, median(ratio))) : 1.f;
+
+        float cx = t.x + t.w * 0.5f + mx / sx, cy = t.y + t.h * 0.5f + my / sy;
+        if (cx < 0 || cy < 0 || cx >= src_w || cy >= src_h) {
+            dropped++;
+            continue;
+        }
+        t.w *= s;
+        t.h *= s;
+        t.x = cx - t.w * 0.5f;
+        t.y = cy - t.h * 0.5f;
+        t.det.box.left = std::max(0, (int)t.x);
+        t.det.box.top = std::max(0, (int)t.y);
+        t.det.box.right = std::min(src_w - 1, (int)(t.x + t.w));
+        t.det.box.bottom = std::min(src_h - 1, (int)(t.y + t.h));
+        // 跟踪到的点越少，衰减越快
+        t.det.prop *= PROPAGATE_DECAY * (0.5f + 0.5f * good / n);
+        t.det.propagated = true;
+
+        // 保留跟踪到的点，剩下不到一半时在新位置重新选取
+        if (good * 2 < PROPAGATE_POINTS) {
+            select_points(gray, t, sx, sy);
+        }
+        else {
+            t.points.clear();
+            for (size_t k = first; k < first + n; k++)
+                if (status[k])
+                    t.points.push_back(next_points[k]);
+        }
+
+        motion_sum += hypotf(mx / sx, my / sy);
+        conf_sum += t.det.prop;
+        if (kept != i)
+            tracks[kept] = std::move(t);
+        kept++;
+    }
+    tracks.resize(kept);
+    lost += dropped;
+
+    for (size_t i = 0; i < tracks.size() && i < OBJ_NUMB_MAX_SIZE; i++)
+        group->results[group->count++] = tracks[i].det;
+
+    // 运动大、置信度低或跟丢较多时，提前推理并把间隔减半
+    float motion = kept > 0 ? motion_sum / kept : 0.f;
+    span_motion = std::max(span_motion, motion);
+    bool trigger = dropped > PROPAGATE_LOST_RATIO * (kept + dropped) || motion > motion_threshold ||
+                   (kept > 0 && conf_sum / kept < conf_threshold);
+    if (trigger && !span_triggered) {
+        span_triggered = true;
+        early++;
+        interval = std::max(1, interval.load() / 2);
+        want_keyframe = true;
+    }
+    prev = gray;
+}
+
+void BoxPropagator::report() const
+{
+    long long frames = keyframes + propagated;
+    if (frames == 0)
+        return;
+    printf("keyframe: frames: %lld, keyframes: %lld (early %lld), propagated: %lld (%.1f%% NPU work saved), "
+           "lost boxes: %lld, interval: %d/%d\n",
+           frames, keyframes, early, propagated, 100.0 * propagated / frames, lost, interval.load(), max_interval);
+}
@@ -0,0 +1,274 @@
+/*
+ * @Author: Li RF
+ * @Date: 2025-04-22 09:18:36
+ * @LastEditors: Li RF
+ * @LastEditTime: 2025-04-22 09:18:36
+ * @Description: 二级分类器：批量裁剪、按核心空闲程度分配批推理、输出解码与按轨迹缓存
+ * Email: 1125962926@qq.com
+ * Copyright (c) 2025 Li RF, All Rights Reserved.
+ */
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+#include "opencv2/imgproc.hpp"
+
+#include "classifier.h"
+#include "head_decoder.h"
+#include "preprocess.h"
+
+Classifier::Classifier(const AppConfig &config)
+{
+    // 分类模型的上下文：同步推理，NCHW 输出（[batch, 类别数] 连续存放），批输入通过 rknn_inputs_set 传入
+    this->config = config;
+    this->config.model_path = config.cls_model;
+    this->config.output_mode = OUTPUT_MODE::OUT_NCHW;
+    this->config.async = false;
+    this->config.zero_copy = false;
+    this->config.record_dir = "";
+    classes = split_string(config.cls_classes, ',');
+}
+
+int Classifier::init(Dispatcher *dispatcher)
+{
+    this->dispatcher = dispatcher;
+    for (int core = 0; core < NPU_CORE_NUM; core++)
+    {
+        AppConfig coreConfig = this->config;
+        coreConfig.npu_core = core;
+        std::unique_ptr<InferenceBackend> backend = create_rknn_backend(coreConfig);
+        if (!backend || backend->init(backends.empty() ? nullptr : backends[0].get(), core == 0) != 0) {
+            std::cerr << "classifier context on core " << core << " init failed" << std::endl;
+            // 至少有一个核心可用即可
+            if (backends.empty())
+                return -1;
+            break;
+        }
+        backends.push_back(std::move(backend));
+        core_mask |= 1u << core;
+    }
+
+    InferenceBackend *first = backends[0].get();
+    width = first->get_input_width();
+    height = first->get_input_height();
+    batch = first->get_input_batch();
+    if (first->get_input_channel() != 3) {
+        std::cerr << "classifier input must have 3 channels" << std::endl;
+        return -1;
+    }
+    // 批输入：batch 张图按 NHWC 上下堆叠
+    input = std::make_unique<HostInputBuffer>(width, height * batch, 3);
+    outputs.resize(first->get_outputs().size());
+
+    // 每个输出的类别数与标签，标签来自模型自定义字符串：labels=a,b,c;labels1=x,y
+    const std::vector<size_t> &bytes = first->get_output_bytes();
+    num_classes.resize(outputs.size());
+    labels.resize(outputs.size());
+    for (size_t i = 0; i < outputs.size(); i++)
+    {
+        num_classes[i] = (int)(bytes[i] / batch);
+        std::string key = i == 0 ? "labels" : "labels" + std::to_string(i);
+        labels[i] = split_string(custom_value(first->get_custom_string().c_str(), key), ',');
+    }
+    printf("classifier: %s, input %dx%d, batch %d, %zu outputs, %zu contexts, max %d crops per frame\n",
+           this->config.model_path.c_str(), width, height, batch, outputs.size(), backends.size(),
+           this->config.cls_max_crops);
+    return 0;
+}
+
+bool Classifier::wanted(const detect_result_t &det) const
+{
+    if (det.box.right - det.box.left < CLS_MIN_SIZE || det.box.bottom - det.box.top < CLS_MIN_SIZE)
+        return false;
+    if (classes.empty())
+        return true;
+    for (const std::string &c : classes)
+        if (strcmp(c.c_str(), det.name) == 0)
+            return true;
+    return false;
+}
+
+/**
+ * @Description: 写入一批裁剪图：RGA 在一个 job 中完成全部裁剪、缩放和换通道，失败时改用 OpenCV 逐个处理
+ * @param {Mat} &img: BGR 源图
+ * @param {int} first: rects 中的起始下标
+ * @param {int} n: 数量，不超过 batch
+ * @return {int}: 0 成功
+ */
+int Classifier::fill_batch(const cv::Mat &img, int first, int n)
+{
+    if (this->config.accels_2d == ACCELS_2D::ACC_RGA) {
+        batch_rects.assign(rects.begin() + first, rects.begin() + first + n);
+        if (RGA_crop_resize_batch(img, batch_rects, *input, height) == 0)
+            return 0;
+        rga_fallbacks++;
+    }
+    cv::Mat whole = input->view();
+    for (int i = 0; i < n; i++)
+    {
+        cv::Mat slot = whole.rowRange(i * height, (i + 1) * height);
+        cv::resize(img(rects[first + i]), slot, cv::Size(width, height), 0, 0, cv::INTER_LINEAR);
+        cv::cvtColor(slot, slot, cv::COLOR_BGR2RGB);
+    }
+    return 0;
+}
+
+/**
+ * @Description: 反量化后取最大的类别；输出已是概率（和约为 1）时直接使用，否则先做 softmax
+ *               多个输出的标签以逗号连接，置信度取最小值
+ * @param {int} slot: 批中的位置
+ * @param {detect_result_t} &det: 写入 attr / attr_prop
+ * @return {*}
+ */
+void Classifier::decode(int slot, detect_result_t &det)
+{
+    const std::vector<head_tensor_t> &tensors = backends[0]->get_outputs();
+    int len = 0;
+    float conf = 1.f;
+    det.attr[0] = '\0';
+    for (size_t o = 0; o < outputs.size(); o++)
+    {
+        int n = num_classes[o];
+        const int8_t *p = outputs[o] + (size_t)slot * n;
+        probs.resize(n);
+        float sum = 0.f, lo = 0.f, hi = 0.f;
+        int best = 0;
+        for (int k = 0; k < n; k++)
+        {
+            probs[k] = (p[k] - tensors[o].zp) * tensors[o].scale;
+            sum += probs[k];
+            lo = k == 0 ? probs[k] : std::min(lo, probs[k]);
+            hi = k == 0 ? probs[k] : std::max(hi, probs[k]);
+            if (probs[k] > probs[best])
+                best = k;
+        }
+        float prop;
+        if (lo >= 0.f && hi <= 1.f && fabsf(sum - 1.f) < 0.05f) {
+            prop = probs[best];
+        }
+        else {
+            float e = 0.f;
+            for (int k = 0; k < n; k++)
+                e += expf(probs[k] - probs[best]);
+            prop = 1.f / e;
+        }
+        conf = std::min(conf, prop);
+        const char *sep = o == 0 ? "" : ",";
+        if (best < (int)labels[o].size())
+            len += snprintf(det.attr + len, std::max(0, OBJ_ATTR_MAX_SIZE - len), "%s%s", sep,
+                            labels[o][best].c_str());
+        else
+            len += snprintf(det.attr + len, std::max(0, OBJ_ATTR_MAX_SIZE - len), "%s%d", sep, best);
+        len = std::min(len, OBJ_ATTR_MAX_SIZE - 1);
+    }
+    det.attr_prop = conf;
+}
+
+int Classifier::classify(const cv::Mat &img, detect_result_group_t *group)
+{
+    frame++;
+    // 排序：没有缓存结果的框在前（按置信度），其次按缓存的新旧，越旧越先重新分类
+    order.clear();
+    for (int i = 0; i < group->count; i++)
+    {
+        const detect_result_t &det = group->results[i];
+        if (!wanted(det))
+            continue;
+        auto it = det.track_id >= 0 ? cache.find(det.track_id) : cache.end();
+        if (it == cache.end()) {
+            order.push_back({2.f + det.prop, i});
+        }
+        else {
+            float age = (float)(frame - it->second.frame);
+            order.push_back({age / (age + 1.f), i});
+        }
+    }
+    std::sort(order.begin(), order.end(),
+              [](const std::pair<float, int> &a, const std::pair<float, int> &b) { return a.first > b.first; });
+
+    picked.clear();
+    rects.clear();
+    cv::Rect bounds(0, 0, img.cols, img.rows);
+    for (const auto &o : order)
+    {
+        detect_result_t &det = group->results[o.second];
+        if ((int)picked.size() < this->config.cls_max_crops) {
+            cv::Rect rect = cv::Rect(det.box.left, det.box.top, det.box.right - det.box.left,
+                                     det.box.bottom - det.box.top) & bounds;
+            if (rect.width >= CLS_MIN_SIZE && rect.height >= CLS_MIN_SIZE) {
+                picked.push_back(o.second);
+                rects.push_back(rect);
+                continue;
+            }
+        }
+        // 超出上限的框沿用该轨迹上一次的结果；轨迹仍在画面中，缓存不删除，但年龄继续增长（最多记到
+        // CLS_CACHE_FRAMES / 2），之后仍按新旧轮流重新分类
+        auto it = det.track_id >= 0 ? cache.find(det.track_id) : cache.end();
+        if (it != cache.end()) {
+            memcpy(det.attr, it->second.attr, sizeof(det.attr));
+            det.attr_prop = it->second.prop;
+            it->second.frame = std::max(it->second.frame, frame - CLS_CACHE_FRAMES / 2);
+        }
+    }
+    int count = (int)picked.size();
+
+    for (int first = 0; first < count; first += batch)
+    {
+        int n = std::min(batch, count - first);
+        auto begin = std::chrono::steady_clock::now();
+        fill_batch(img, first, n);
+        // 交给累计耗时最少的核心，同时计入调度器，检测帧的分配会避开它
+        int core = dispatcher ? dispatcher->acquire_core(core_mask) : 0;
+        InferenceBackend *backend = backends[std::max(0, core)].get();
+        auto run_begin = std::chrono::steady_clock::now();
+        int ret = backend->run(*input, outputs.data());
+        double run_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - run_begin).count();
+        if (ret == 0) {
+            for (int i = 0; i < n; i++)
+                decode(i, group->results[picked[first + i]]);
+            backend->release_outputs();
+        }
+        if (dispatcher)
+            dispatcher->release_core(core, run_ms);
+        if (ret != 0) {
+            std::cerr << "classifier run error" << std::endl;
+            return -1;
+        }
+        total_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+        batches++;
+        crops += n;
+    }
+
+    // 更新轨迹缓存，删除长时间没有出现的轨迹
+    for (int i : picked)
+    {
+        const detect_result_t &det = group->results[i];
+        if (det.track_id < 0)
+            continue;
+        cached_t &c = cache[det.track_id];
+        memcpy(c.attr, det.attr, sizeof(c.attr));
+        c.prop = det.attr_prop;
+        c.frame = frame;
+    }
+    for (auto it = cache.begin(); it != cache.end();)
+    {
+        if (frame - it->second.frame > CLS_CACHE_FRAMES)
+            it = cache.erase(it);
+        else
+            ++it;
+    }
+    return count;
+}
+
+void Classifier::report() const
+{
+    if (frame == 0)
+        return;
+    printf("classifier: frames: %lld, crops: %lld (%.1f per frame), batches: %lld (%.1f crops per batch), "
+           "%.2f ms per frame, %.2f ms per crop, rga fallbacks: %lld\n",
+           frame, crops, (double)crops / frame, batches, batches > 0 ? (double)crops / batches : 0.0,
+           total_ms / frame, crops > 0 ? total_ms / crops : 0.0, rga_fallbacks);
+}
@@ -0,0 +1,227 @@
+/*
+ * @Author: Li RF
+ * @Date: 2025-04-14 10:36:52
+ * @LastEditors: Li RF
+ * @LastEditTime: 2025-04-14 10:36:52
+ * @Description: NPU 负载感知调度
+ * Email: 1125962926@qq.com
+ * Copyright (c) 2025 Li RF, All Rights Reserved.
+ */
+#include <stdio.h>
+#include <algorithm>
+
+#include "dispatcher.h"
+
+/* 每个核心当前绑定的上下文数量，所有线程池共用 */
+static int core_contexts[NPU_CORE_NUM] = {0};
+static std::mutex core_mtx;
+
+int npu_core_assign()
+{
+    std::lock_guard<std::mutex> lock(core_mtx);
+    int best = 0;
+    for (int i = 1; i < NPU_CORE_NUM; i++)
+        if (core_contexts[i] < core_contexts[best])
+            best = i;
+    core_contexts[best]++;
+    return best;
+}
+
+void npu_core_release(int core)
+{
+    std::lock_guard<std::mutex> lock(core_mtx);
+    if (core >= 0 && core < NPU_CORE_NUM && core_contexts[core] > 0)
+        core_contexts[core]--;
+}
+
+/**
+ * @Description: 核心位掩码中的核心数，0（自动）按全部核心计
+ */
+static int core_count(unsigned cores)
+{
+    int n = 0;
+    for (int i = 0; i < NPU_CORE_NUM; i++)
+        n += (cores >> i) & 1;
+    return n;
+}
+
+Dispatcher::Dispatcher(int num_contexts, int policy)
+    : policy(policy), contexts(num_contexts), last_dispatch(num_contexts, 0)
+{
+    for (auto &c : contexts)
+        c.cores = (1u << NPU_CORE_NUM) - 1;
+}
+
+void Dispatcher::set_cores(int ctx, unsigned cores)
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    // 不使用 NPU 的上下文记为 0，不计入任何核心
+    if (cores == DISPATCH_CORES_NONE) {
+        contexts[ctx].cores = 0;
+        return;
+    }
+    cores &= (1u << NPU_CORE_NUM) - 1;
+    contexts[ctx].cores = cores != 0 ? cores : (1u << NPU_CORE_NUM) - 1;
+}
+
+/**
+ * @Description: 按核心数均摊，把 in_flight 的变化和耗时记到上下文使用的每个核心上
+ * @param {double} frames: 1 为分配（同时计入 dispatched），-1 为完成
+ */
+void Dispatcher::account(int ctx, double frames, double busy_ms)
+{
+    unsigned mask = contexts[ctx].cores;
+    int n = core_count(mask);
+    if (n == 0)
+        return;
+    for (int i = 0; i < NPU_CORE_NUM; i++)
+    {
+        if (!((mask >> i) & 1))
+            continue;
+        cores[i].in_flight += frames / n;
+        if (frames > 0)
+            cores[i].dispatched += frames / n;
+        cores[i].busy_ms += busy_ms / n;
+    }
+}
+
+/**
+ * @Description: 上下文所用核心的平均 in_flight
+ *               不使用 NPU 的上下文（CPU 后端）视为最重，in_flight 相同时优先 NPU 上下文，NPU 都忙时才分给它
+ */
+double Dispatcher::core_load(int ctx) const
+{
+    unsigned mask = contexts[ctx].cores;
+    if (mask == 0)
+        return 1e9;
+    double load = 0;
+    for (int i = 0; i < NPU_CORE_NUM; i++)
+        if ((mask >> i) & 1)
+            load += cores[i].in_flight;
+    return load / core_count(mask);
+}
+
+int Dispatcher::acquire(int first)
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    int n = (int)contexts.size();
+    if (first >= n)
+        first = 0;
+    int best = first;
+    if (policy == DISPATCH_POLICY::DISPATCH_ROUND_ROBIN) {
+        // 与原 getModelId 相同：按分配次数轮询
+        best = first + (int)(sequence % (n - first));
+    }
+    else {
+        for (int i = first + 1; i < n; i++)
+        {
+            const DispatchContextStats &a = contexts[i], &b = contexts[best];
+            if (a.in_flight != b.in_flight) {
+                if (a.in_flight < b.in_flight)
+                    best = i;
+                continue;
+            }
+            double la = core_load(i), lb = core_load(best);
+            if (la < lb || (la == lb && last_dispatch[i] < last_dispatch[best]))
+                best = i;
+        }
+    }
+    assign(best);
+    return best;
+}
+
+int Dispatcher::acquire_fixed(int ctx)
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    assign(ctx);
+    return ctx;
+}
+
+/**
+ * @Description: 把一帧记到上下文上，调用时已持有 mtx
+ */
+void Dispatcher::assign(int ctx)
+{
+    sequence++;
+    last_dispatch[ctx] = sequence;
+    DispatchContextStats &c = contexts[ctx];
+    c.in_flight++;
+    c.max_in_flight = std::max(c.max_in_flight, c.in_flight);
+    c.dispatched++;
+    account(ctx, 1, 0);
+}
+
+void Dispatcher::release(int ctx, double busy_ms)
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    DispatchContextStats &c = contexts[ctx];
+    c.in_flight--;
+    c.busy_ms += busy_ms;
+    account(ctx, -1, busy_ms);
+}
+
+int Dispatcher::acquire_core(unsigned mask)
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    int best = -1;
+    for (int i = 0; i < NPU_CORE_NUM; i++)
+    {
+        if (!((mask >> i) & 1))
+            continue;
+        if (best < 0 || cores[i].in_flight < cores[best].in_flight ||
+            (cores[i].in_flight == cores[best].in_flight && cores[i].busy_ms < cores[best].busy_ms))
+            best = i;
+    }
+    if (best >= 0) {
+        cores[best].in_flight += 1;
+        cores[best].dispatched += 1;
+    }
+    return best;
+}
+
+void Dispatcher::release_core(int core, double busy_ms)
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    if (core < 0 || core >= NPU_CORE_NUM)
+        return;
+    cores[core].in_flight -= 1;
+    cores[core].busy_ms += busy_ms;
+}
+
+std::vector<int> Dispatcher::dispatch_order()
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    std::vector<int> order(contexts.size());
+    for (size_t i = 0; i < order.size(); i++)
+        order[i] = (int)i;
+    std::sort(order.begin(), order.end(), [this](int a, int b) { return last_dispatch[a] < last_dispatch[b]; });
+    return order;
+}
+
+std::vector<DispatchContextStats> Dispatcher::context_stats()
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    return contexts;
+}
+
+std::vector<DispatchCoreStats> Dispatcher::core_stats()
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    return std::vector<DispatchCoreStats>(cores, cores + NPU_CORE_NUM);
+}
+
+void Dispatcher::print_stats()
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    printf("dispatch policy: %s\n", policy == DISPATCH_POLICY::DISPATCH_ROUND_ROBIN ? "round-robin" : "least-loaded");
+    printf("%8s %6s %10s %10s %12s %10s\n", "context", "cores", "frames", "in_flight", "max_flight", "busy(ms)");
+    for (size_t i = 0; i < contexts.size(); i++)
+    {
+        const DispatchContextStats &c = contexts[i];
+        printf("%8zu %6x %10llu %10d %12d %10.1f\n", i, c.cores, (unsigned long long)c.dispatched, c.in_flight,
+               c.max_in_flight, c.busy_ms);
+    }
+    printf("%8s %10s %10s %10s\n", "core", "frames", "in_flight", "busy(ms)");
+    for (int i = 0; i < NPU_CORE_NUM; i++)
+        printf("%8d %10.1f %10.1f %10.1f\n", i, cores[i].dispatched, cores[i].in_flight, cores[i].busy_ms);
+}
@@ -0,0 +1,45 @@
+/*
+ * @Author: Li RF
+ * @Date: 2025-04-17 09:32:10
+ * @LastEditors: Li RF
+ * @LastEditTime: 2025-04-17 09:32:10
+ * @Description: 推理后端工厂与输入形状选择，各后端分别实现于 inference_backend_rknn.cpp / _cpu.cpp / _replay.cpp
+ * Email: 1125962926@qq.com
+ * Copyright (c) 2025 Li RF, All Rights Reserved.
+ */
+#include <algorithm>
+
+#include "inference_backend.h"
+
+std::unique_ptr<InferenceBackend> create_inference_backend(const AppConfig &config)
+{
+    switch (config.backend) {
+    case BACKEND_TYPE::BACKEND_RKNN:
+        return create_rknn_backend(config);
+    case BACKEND_TYPE::BACKEND_CPU:
+        return create_cpu_backend(config);
+    case BACKEND_TYPE::BACKEND_REPLAY:
+        return create_replay_backend(config);
+    }
+    return nullptr;
+}
+
+int choose_input_shape(const std::vector<input_shape_t> &shapes, int src_w, int src_h)
+{
+    auto scale_of = [src_w, src_h](const input_shape_t &s) {
+        return std::min((float)s.width / src_w, (float)s.height / src_h);
+    };
+    float best_scale = 0.f;
+    for (const auto &s : shapes)
+        best_scale = std::max(best_scale, scale_of(s));
+    // 缩放比例取整误差在千分之一以内的视为相同
+    int best = -1;
+    for (int i = 0; i < (int)shapes.size(); i++)
+    {
+        if (scale_of(shapes[i]) < best_scale * 0.999f)
+            continue;
+        if (best < 0 || shapes[i].width * shapes[i].height < shapes[best].width * shapes[best].height)
+            best = i;
+    }
+    return best;
+}
@@ -0,0 +1,155 @@
+/*
+ * @Author: Li RF
+ * @Date: 2025-04-17 09:32:10
+ * @LastEditors: Li RF
+ * @LastEditTime: 2025-04-17 09:32:10
+ * @Description: CPU 后端：OpenCV DNN 运行与 RKNN 模型等价的 ONNX 模型（转换 RKNN 前的原始模型）
+ *               输出按张量量化为 int8，与 NPU 的输出一样交给检测头解码器，后处理不区分后端
+ *               量化范围固定，不依赖初始化时合成输入的取值：已经过 sigmoid 的输出（置信度、类别分数）取 [0, 1]，
+ *               原始 logit 输出（DFL 框分布等）取 ±CPU_QNT_LOGIT_RANGE，与 NPU 上下文混用时框的精度一致
+ * Email: 1125962926@qq.com
+ * Copyright (c) 2025 Li RF, All Rights Reserved.
+ */
+#include <math.h>
+#include <stdio.h>
+#include <algorithm>
+#include <iostream>
+
+#include "opencv2/dnn.hpp"
+
+#include "inference_backend.h"
+
+/* 默认输入尺寸，ONNX 模型没有给出固定输入形状时使用 */
+#define CPU_DEFAULT_INPUT_SIZE 640
+/* 原始 logit 输出的量化范围 [-range, range]，覆盖实际画面中 DFL 分布的 logit */
+#define CPU_QNT_LOGIT_RANGE 16.f
+
+class CpuBackend : public InferenceBackend
+{
+public:
+    CpuBackend(const AppConfig &config) : config(config) {}
+
+    const char *name() const override { return "cpu"; }
+    int init(InferenceBackend *first, bool verbose) override;
+    int run(InputBuffer &buf, int8_t **outputs) override;
+    // 不占用 NPU 核心
+    unsigned get_core_mask() const override { return DISPATCH_CORES_NONE; }
+
+private:
+    AppConfig config;
+    cv::dnn::Net net;
+    std::vector<cv::String> out_names;
+    std::vector<cv::Mat> results;
+    // 量化后的输出，每帧复用
+    std::unique_ptr<AlignedBuffer<int8_t>[]> qnt_outputs;
+
+    int forward(InputBuffer &buf);
+};
+
+/**
+ * @Description: 运行一次前向，结果为 float 的 [1, C, H, W]
+ * @param {InputBuffer} &buf: RGB 输入，与 NPU 一样由前处理写入
+ * @return {int}: 0 成功
+ */
+int CpuBackend::forward(InputBuffer &buf)
+{
+    // 归一化在 RKNN 模型中由 NPU 完成，ONNX 模型需要在这里做
+    cv::Mat blob = cv::dnn::blobFromImage(buf.view(), 1.0 / 255, cv::Size(), cv::Scalar(), false, false);
+    try {
+        net.setInput(blob);
+        net.forward(results, out_names);
+    } catch (const cv::Exception &e) {
+        std::cerr << "cpu backend forward failed: " << e.what() << std::endl;
+        return -1;
+    }
+    return 0;
+}
+
+int CpuBackend::init(InferenceBackend *first, bool verbose)
+{
+    const std::string &model_path = this->config.model_path;
+    try {
+        net = cv::dnn::readNetFromONNX(model_path);
+    } catch (const cv::Exception &e) {
+        std::cerr << "readNetFromONNX failed: " << e.what() << std::endl;
+        return -1;
+    }
+    net.setPreferableBackend(cv::dnn::DNN_BACKEND_OPENCV);
+    net.setPreferableTarget(cv::dnn::DNN_TARGET_CPU);
+    out_names = net.getUnconnectedOutLayersNames();
+
+    // 输入尺寸：取模型中固定的输入形状 [1, 3, H, W]
+    width = height = CPU_DEFAULT_INPUT_SIZE;
+    channel = 3;
+    try {
+        std::vector<cv::dnn::MatShape> in_shapes, out_shapes;
+        net.getLayerShapes(cv::dnn::MatShape(), 0, in_shapes, out_shapes);
+        if (!out_shapes.empty() && out_shapes[0].size() == 4 && out_shapes[0][2] > 0 && out_shapes[0][3] > 0) {
+            height = out_shapes[0][2];
+            width = out_shapes[0][3];
+        }
+    } catch (const cv::Exception &e) {
+        std::cout << "cpu backend: no fixed input shape, use " << width << "x" << height << std::endl;
+    }
+
+    // 对整幅填充色的输入做一次前向，得到输出形状，并区分输出是否已经过 sigmoid
+    HostInputBuffer calib(width, height, channel);
+    calib.update_letterbox(width, height);
+    if (forward(calib) != 0)
+        return -1;
+    outputs.resize(results.size());
+    output_bytes.resize(results.size());
+    qnt_outputs = std::make_unique<AlignedBuffer<int8_t>[]>(results.size());
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const cv::Mat &r = results[i];
+        if (r.dims != 4 || r.size[0] != 1 || r.type() != CV_32F) {
+            std::cerr << "cpu backend: output " << out_names[i] << " is not [1, C, H, W] float" << std::endl;
+            return -1;
+        }
+        // 合成输入上的取值只用来判断输出类型：全部落在 [0, 1] 的是 sigmoid 之后的分数，其余按原始 logit 处理；
+        // 不用它确定范围，真实画面中的 logit 远超填充色画面的取值，截断后 DFL 的 softmax 变平、框尺寸偏移
+        double min_val, max_val;
+        cv::minMaxIdx(r, &min_val, &max_val);
+        bool sigmoid = min_val >= 0.0 && max_val <= 1.0;
+        float lo = sigmoid ? 0.f : -CPU_QNT_LOGIT_RANGE, hi = sigmoid ? 1.f : CPU_QNT_LOGIT_RANGE;
+        head_tensor_t &t = outputs[i];
+        t.c = r.size[1];
+        t.h = r.size[2];
+        t.w = r.size[3];
+        t.scale = (hi - lo) / 255.f;
+        t.zp = -128 - (int32_t)roundf(lo / t.scale);
+        output_bytes[i] = r.total();
+        qnt_outputs[i].reserve(r.total());
+        if (verbose)
+            printf("cpu backend: output %zu %s, range [%.1f, %.1f]\n", i, sigmoid ? "sigmoid" : "logit", lo, hi);
+    }
+    printf("cpu backend: %s, input %dx%d, %zu outputs\n", model_path.c_str(), width, height, outputs.size());
+    return 0;
+}
+
+int CpuBackend::run(InputBuffer &buf, int8_t **out_bufs)
+{
+    if (forward(buf) != 0)
+        return -1;
+    // 与 NPU 输出相同的仿射量化：q = round(v / scale) + zp
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const float *src = (const float *)results[i].data;
+        int8_t *dst = qnt_outputs[i].data();
+        float inv_scale = 1.f / outputs[i].scale;
+        int32_t zp = outputs[i].zp;
+        for (size_t j = 0; j < output_bytes[i]; j++)
+        {
+            int q = (int)lrintf(src[j] * inv_scale) + zp;
+            dst[j] = (int8_t)std::min(127, std::max(-128, q));
+        }
+        out_bufs[i] = dst;
+    }
+    return 0;
+}
+
+std::unique_ptr<InferenceBackend> create_cpu_backend(const AppConfig &config)
+{
+    return std::make_unique<CpuBackend>(config);
+}
@@ -0,0 +1,246 @@
+/*
+ * @Author: Li RF
+ * @Date: 2025-04-17 09:32:10
+ * @LastEditors: Li RF
+ * @LastEditTime: 2025-04-17 09:32:10
+ * @Description: 输出录制与 replay 后端：回放 record_frame 录制的输出张量，
+ *               不依赖 NPU 和 OpenCV DNN，可在 x86 开发机上测试前/后处理与调度
+ * Email: 1125962926@qq.com
+ * Copyright (c) 2025 Li RF, All Rights Reserved.
+ */
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+#include "dispatcher.h"
+#include "inference_backend.h"
+
+/* 录制的帧号，所有上下文共用 */
+static std::atomic<uint64_t> record_count(0);
+
+static std::string frame_path(const std::string &dir, uint64_t index)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "frame_%06llu.bin", (unsigned long long)index);
+    return dir + "/" + name;
+}
+
+int record_meta(const std::string &dir, const InferenceBackend &backend)
+{
+    if (mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST) {
+        std::cerr << "Failed to create: " << dir << std::endl;
+        return -1;
+    }
+    std::string path = dir + "/meta.txt";
+    FILE *fp = fopen(path.c_str(), "w");
+    if (fp == nullptr) {
+        std::cerr << "Failed to open: " << path << std::endl;
+        return -1;
+    }
+    fprintf(fp, "input %d %d %d\n", backend.get_input_width(), backend.get_input_height(),
+            backend.get_input_channel());
+    fprintf(fp, "custom %s\n", backend.get_custom_string().c_str());
+    const std::vector<head_tensor_t> &outputs = backend.get_outputs();
+    for (size_t i = 0; i < outputs.size(); i++)
+    {
+        const head_tensor_t &t = outputs[i];
+        fprintf(fp, "output %d %d %d %d %.9g %d %zu\n", t.c, t.h, t.w, t.zp, t.scale, t.c2,
+                backend.get_output_bytes()[i]);
+    }
+    fclose(fp);
+    return 0;
+}
+
+int record_frame(const std::string &dir, const InferenceBackend &backend, int8_t **outputs)
+{
+    std::string path = frame_path(dir, record_count++);
+    FILE *fp = fopen(path.c_str(), "wb");
+    if (fp == nullptr) {
+        std::cerr << "Failed to open: " << path << std::endl;
+        return -1;
+    }
+    const std::vector<size_t> &bytes = backend.get_output_bytes();
+    for (size_t i = 0; i < bytes.size(); i++)
+        fwrite(outputs[i], 1, bytes[i], fp);
+    fclose(fp);
+    return 0;
+}
+
+/* 一份录制：全部帧读入内存，同一线程池的 replay 后端共用 */
+struct ReplayRecording
+{
+    int width = 0;
+    int height = 0;
+    int channel = 0;
+    std::string custom_string;
+    std::vector<head_tensor_t> outputs;
+    std::vector<size_t> output_bytes;
+    // 每帧依次为全部输出，offsets 为每个输出在帧内的偏移
+    std::vector<size_t> offsets;
+    std::vector<std::vector<int8_t>> frames;
+    // 下一个回放的帧，多个上下文依次取用，到结尾后从头开始
+    std::atomic<uint64_t> next{0};
+
+    int load(const std::string &dir);
+};
+
+int ReplayRecording::load(const std::string &dir)
+{
+    std::ifstream meta(dir + "/meta.txt");
+    if (!meta.is_open()) {
+        std::cerr << "Failed to open: " << dir << "/meta.txt" << std::endl;
+        return -1;
+    }
+    std::string line;
+    while (std::getline(meta, line))
+    {
+        std::istringstream iss(line);
+        std::string key;
+        iss >> key;
+        if (key == "input") {
+            iss >> width >> height >> channel;
+        }
+        else if (key == "custom") {
+            custom_string = line.size() > 7 ? line.substr(7) : "";
+        }
+        else if (key == "output") {
+            head_tensor_t t;
+            size_t bytes = 0;
+            iss >> t.c >> t.h >> t.w >> t.zp >> t.scale >> t.c2 >> bytes;
+            if (iss.fail() || bytes == 0) {
+                std::cerr << "Invalid line in meta.txt: " << line << std::endl;
+                return -1;
+            }
+            offsets.push_back(offsets.empty() ? 0 : offsets.back() + output_bytes.back());
+            outputs.push_back(t);
+            output_bytes.push_back(bytes);
+        }
+    }
+    if (width <= 0 || height <= 0 || outputs.empty()) {
+        std::cerr << "Invalid meta.txt in " << dir << std::endl;
+        return -1;
+    }
+    size_t frame_bytes = offsets.back() + output_bytes.back();
+    for (uint64_t i = 0;; i++)
+    {
+        std::ifstream f(frame_path(dir, i), std::ios::binary);
+        if (!f.is_open())
+            break;
+        std::vector<int8_t> frame(frame_bytes);
+        f.read((char *)frame.data(), frame_bytes);
+        if ((size_t)f.gcount() != frame_bytes) {
+            std::cerr << "Truncated frame: " << frame_path(dir, i) << std::endl;
+            break;
+        }
+        frames.push_back(std::move(frame));
+    }
+    if (frames.empty()) {
+        std::cerr << "No recorded frames in " << dir << std::endl;
+        return -1;
+    }
+    return 0;
+}
+
+/* replay 后端：按录制顺序返回输出，每帧等待 replay_latency 毫秒模拟推理耗时 */
+class ReplayBackend : public InferenceBackend
+{
+public:
+    ReplayBackend(const AppConfig &config) : config(config) {}
+    ~ReplayBackend() override { npu_core_release(npu_core); }
+
+    const char *name() const override { return "replay"; }
+    int init(InferenceBackend *first, bool verbose) override;
+    int run(InputBuffer &buf, int8_t **outputs) override;
+
+    // 提交时记录完成时刻，collect 等到该时刻，与 NPU 的非阻塞运行一样可以和前/后处理重叠
+    bool supports_async() const override { return true; }
+    int submit(InputBuffer &buf) override;
+    int collect(int8_t **outputs) override;
+    bool busy() const override { return pending; }
+    // 与 throughput 模式的 NPU 上下文一样分配一个核心，调度计数与板上一致
+    unsigned get_core_mask() const override { return npu_core < 0 ? 0 : 1u << npu_core; }
+
+private:
+    AppConfig config;
+    int npu_core = -1;
+    std::shared_ptr<ReplayRecording> recording;
+    bool pending = false;
+    size_t pending_frame = 0;
+    std::chrono::steady_clock::time_point deadline;
+
+    void fill(size_t frame, int8_t **outputs);
+};
+
+int ReplayBackend::init(InferenceBackend *first, bool verbose)
+{
+    // 同一线程池共用一份录制，帧在上下文之间依次分配
+    ReplayBackend *replay_first = dynamic_cast<ReplayBackend *>(first);
+    if (replay_first != nullptr && replay_first->recording) {
+        recording = replay_first->recording;
+    }
+    else {
+        recording = std::make_shared<ReplayRecording>();
+        if (recording->load(this->config.model_path) != 0)
+            return -1;
+    }
+    npu_core = npu_core_assign();
+    width = recording->width;
+    height = recording->height;
+    channel = recording->channel;
+    outputs = recording->outputs;
+    output_bytes = recording->output_bytes;
+    custom_string = recording->custom_string;
+    if (verbose)
+        printf("replay backend: %zu frames from %s, input %dx%dx%d, %zu outputs, latency %.1f ms\n",
+               recording->frames.size(), this->config.model_path.c_str(), width, height, channel, outputs.size(),
+               this->config.replay_latency);
+    return 0;
+}
+
+void ReplayBackend::fill(size_t frame, int8_t **outputs)
+{
+    std::vector<int8_t> &data = recording->frames[frame];
+    for (size_t i = 0; i < this->outputs.size(); i++)
+        outputs[i] = data.data() + recording->offsets[i];
+}
+
+int ReplayBackend::run(InputBuffer &buf, int8_t **outputs)
+{
+    size_t frame = recording->next++ % recording->frames.size();
+    if (this->config.replay_latency > 0)
+        std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(this->config.replay_latency));
+    fill(frame, outputs);
+    return 0;
+}
+
+int ReplayBackend::submit(InputBuffer &buf)
+{
+    pending_frame = recording->next++ % recording->frames.size();
+    deadline = std::chrono::steady_clock::now() +
+               std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                   std::chrono::duration<double, std::milli>(this->config.replay_latency));
+    pending = true;
+    return 0;
+}
+
+int ReplayBackend::collect(int8_t **outputs)
+{
+    if (!pending)
+        return -1;
+    std::this_thread::sleep_until(deadline);
+    pending = false;
+    fill(pending_frame, outputs);
+    return 0;
+}
+
+std::unique_ptr<InferenceBackend> create_replay_backend(const AppConfig &config)
+{
+    return std::make_unique<ReplayBackend>(config);
+}
@@ -0,0 +1,766 @@
+/*
+ * @Author: Li RF
+ * @Date: 2025-04-17 09:32:10
+ * @LastEditors: Li RF
+ * @LastEditTime: 2025-04-17 09:32:10
+ * @Description: RKNN 后端：上下文创建（mmap / 模型零拷贝 / 共享权重）、核心绑定、零拷贝输入、
+ *               原生布局输出、异步双缓冲与动态输入形状，原先位于 rkYolo 中
+ * Email: 1125962926@qq.com
+ * Copyright (c) 2025 Li RF, All Rights Reserved.
+ */
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+
+#include "rknn_api.h"
+
+#include "dispatcher.h"
+#include "inference_backend.h"
+#include "model_file.h"
+
+/**
+ * @Description: 打印 tensor 的格式
+ * @param {rknn_tensor_attr} *attr:
+ * @return {*}
+ */
+static void dump_tensor_attr(rknn_tensor_attr *attr) {
+    std::string shape_str = attr->n_dims < 1 ? "" : std::to_string(attr->dims[0]);
+    for (int i = 1; i < attr->n_dims; ++i)
+    {
+        shape_str += ", " + std::to_string(attr->dims[i]);
+    }
+
+    printf("  index=%d, name=%s, n_dims=%d, dims=[%s], n_elems=%d, size=%d, w_stride = %d, size_with_stride=%d, fmt=%s, "
+           "type=%s, qnt_type=%s, "
+           "zp=%d, scale=%f\n",
+           attr->index, attr->name, attr->n_dims, shape_str.c_str(), attr->n_elems, attr->size, attr->w_stride,
+           attr->size_with_stride, get_format_string(attr->fmt), get_type_string(attr->type),
+           get_qnt_type_string(attr->qnt_type), attr->zp, attr->scale);
+}
+
+/* 已创建的上下文数量，用于编号 */
+static std::atomic<int> context_count(0);
+
+class RknnBackend : public InferenceBackend
+{
+public:
+    RknnBackend(const AppConfig &config) : config(config) {}
+    ~RknnBackend() override;
+
+    const char *name() const override { return "rknn"; }
+    int init(InferenceBackend *first, bool verbose) override;
+    std::unique_ptr<InputBuffer> create_input_buffer(bool verbose) override;
+    int run(InputBuffer &buf, int8_t **outputs) override;
+    void release_outputs() override;
+
+    bool supports_async() const override { return this->config.async; }
+    int submit(InputBuffer &buf) override;
+    int collect(int8_t **outputs) override;
+    bool busy() const override { return pending; }
+    // 使用的核心（位掩码），RKNN_NPU_CORE_AUTO 表示由驱动选择
+    unsigned get_core_mask() const override { return core_mask; }
+    bool dynamic_shape() const override { return input_range != nullptr; }
+    int select_input_shape(int src_w, int src_h) override;
+
+private:
+    int ret = 0;
+    AppConfig config;
+
+    rknn_context ctx = 0;
+    // 上下文编号（按创建顺序）与创建方式（mmap / model_zero_copy / share_weight / dup_context）
+    int context_id = 0;
+    const char *load_method = "";
+    bool verbose = false;
+    // RKNN_FLAG_MODEL_BUFFER_ZERO_COPY 时存放模型的内存，运行时直接引用
+    rknn_tensor_mem *model_mem = nullptr;
+    rknn_input_output_num io_num;
+    std::unique_ptr<rknn_tensor_attr[]> input_attrs;
+    std::unique_ptr<rknn_tensor_attr[]> output_attrs;
+    rknn_input inputs[1];
+    // 原生布局输出内存（OUTPUT_MODE::OUT_NATIVE），为空时使用 rknn_outputs_get
+    std::vector<rknn_tensor_mem *> output_mems;
+    // 原生输出属性，异步模式切换输出内存时重新绑定
+    std::vector<rknn_tensor_attr> native_out_attrs;
+    // 同步模式下 rknn_outputs_get 取得、尚未释放的输出
+    std::unique_ptr<rknn_output[]> held_outputs;
+    bool outputs_held = false;
+
+    // 异步模式：第二组输出内存，与上面一组轮流使用，NPU 写入一组的同时后处理读取另一组
+    std::vector<rknn_tensor_mem *> output_mems_alt;
+    // 异步模式下 rknn_outputs_get 的预分配内存，下一帧运行期间后处理仍可读取
+    std::unique_ptr<AlignedBuffer<int8_t>[]> host_outputs;
+    // 已提交、尚未取回结果的帧
+    bool pending = false;
+    rknn_run_extend run_ext;
+
+    // 动态形状模型的输入形状范围（RKNN_QUERY_INPUT_DYNAMIC_RANGE），静态模型为空
+    std::unique_ptr<rknn_input_range> input_range;
+    std::vector<input_shape_t> input_shapes;
+    // 当前形状在 input_shapes 中的下标
+    int shape_index = -1;
+
+    // 上下文使用的核心：throughput 模式下为 npu_core_assign 分配的核心编号，其余模式为 -1
+    int npu_core = -1;
+    rknn_core_mask core_mask = RKNN_NPU_CORE_AUTO;
+
+    // 创建上下文：映射模型文件，共享第一个上下文的权重
+    int create_context(rknn_context *ctx_in, bool share_weight);
+    // 按核心映射模式设置上下文使用的 NPU 核心
+    int bind_npu_cores(bool first, bool verbose);
+    // 按 input_attrs / output_attrs 更新输入尺寸和输出张量描述
+    void update_io_shapes();
+    // 查询动态形状模型支持的输入形状，静态模型返回 -1
+    int query_input_shapes();
+    // 切换到 input_shapes[index]，并查询当前形状下的输入输出属性
+    int set_input_shape(int index);
+    // 查询原生输出属性，检查后处理是否支持，c2s 为每个输出的通道分组大小
+    int query_native_outputs(std::vector<int> &c2s);
+    // 绑定原生布局的输出内存，并记录每个输出的通道分组大小
+    int bind_native_outputs();
+    // 输入形状切换后，按新的原生输出属性重新绑定已分配的输出内存
+    int rebind_native_outputs();
+    int alloc_native_outputs(std::vector<rknn_tensor_mem *> &mems);
+    void release_native_outputs();
+    // 绑定输入缓冲区：零拷贝时重新绑定，否则通过 rknn_inputs_set 传入
+    int bind_input(InputBuffer &buf);
+};
+
+/**
+ * @Description: 每个上下文都要执行一次，加载模型并查询输入输出
+ * @param {InferenceBackend} *first: 第一个上下文的后端，为 RKNN 后端时共享其权重
+ * @param {bool} verbose:
+ * @return {*}
+ */
+int RknnBackend::init(InferenceBackend *first, bool verbose) {
+    context_id = context_count++;
+    this->verbose = verbose;
+    RknnBackend *rknn_first = dynamic_cast<RknnBackend *>(first);
+    bool share_weight = rknn_first != nullptr;
+
+    // 模型参数复用（为 false 时也代表此时为第一个线程）
+    if (create_context(share_weight ? &rknn_first->ctx : nullptr, share_weight) < 0) {
+        std::cerr << "rknn_init error ret=" << ret << std::endl;
+        return -1;
+    }
+
+    // 每个上下文实际占用的内存，用于确认权重是否共享
+    rknn_mem_size mem_size;
+    memset(&mem_size, 0, sizeof(mem_size));
+    if (rknn_query(ctx, RKNN_QUERY_MEM_SIZE, &mem_size, sizeof(mem_size)) >= 0)
+        printf("context %d (%s): weight %.2f MB, internal %.2f MB, dma allocated %.2f MB\n", context_id, load_method,
+               mem_size.total_weight_size / 1048576.0, mem_size.total_internal_size / 1048576.0,
+               mem_size.total_dma_allocated_size / 1048576.0);
+
+    rknn_sdk_version version;
+    ret = rknn_query(ctx, RKNN_QUERY_SDK_VERSION, &version, sizeof(rknn_sdk_version));
+    if (ret < 0) {
+        std::cerr << "rknn_init error ret=" << ret << std::endl;
+        return -1;
+    }
+    // 只需要第一个线程打印
+    if (verbose)
+        cout << "sdk version: " << version.api_version << " driver version: " << version.drv_version << endl;
+
+    // 获取模型输入输出参数
+    ret = rknn_query(ctx, RKNN_QUERY_IN_OUT_NUM, &io_num, sizeof(io_num));
+    if (ret < 0) {
+        std::cerr << "rknn_init error ret=" << ret << std::endl;
+        return -1;
+    }
+    if (verbose)
+        cout << "model input num: " << io_num.n_input << ", output num: " << io_num.n_output << endl;
+
+    // 设置输入参数
+    input_attrs = std::make_unique<rknn_tensor_attr[]>(io_num.n_input);
+    for (int i = 0; i < io_num.n_input; i++)
+    {
+        input_attrs[i].index = i;
+        ret = rknn_query(ctx, RKNN_QUERY_INPUT_ATTR, &(input_attrs[i]), sizeof(rknn_tensor_attr));
+        if (ret < 0) {
+            cout << "rknn_query input attr failed" << endl;
+            return -1;
+        }
+        // dump_tensor_attr(&(input_attrs[i]));
+    }
+
+    // 设置输出参数
+    output_attrs = std::make_unique<rknn_tensor_attr[]>(io_num.n_output);
+    for (int i = 0; i < io_num.n_output; i++)
+    {
+        output_attrs[i].index = i;
+        ret = rknn_query(ctx, RKNN_QUERY_OUTPUT_ATTR, &(output_attrs[i]), sizeof(rknn_tensor_attr));
+        // dump_tensor_attr(&(output_attrs[i]));
+    }
+
+    // 动态形状模型：先切换到面积最大的形状，输出内存按最大形状分配，之后按源图宽高比切换
+    if (this->config.dynamic_shape && query_input_shapes() == 0) {
+        int largest = 0;
+        for (int i = 1; i < (int)input_shapes.size(); i++)
+            if (input_shapes[i].width * input_shapes[i].height >
+                input_shapes[largest].width * input_shapes[largest].height)
+                largest = i;
+        if (set_input_shape(largest) != 0)
+            return -1;
+    }
+
+    if (verbose)
+        cout << "model input fmt is " << (input_attrs[0].fmt == RKNN_TENSOR_NCHW ? "NCHW" : "NHWC") << endl;
+    update_io_shapes();
+    if (verbose)
+        cout << "model input height=" << height << ", width=" << width << ", channel=" << channel << endl;
+
+    // 设置模型绑定的核心
+    if (bind_npu_cores(!share_weight, verbose) != 0)
+        return -1;
+
+    // 模型自定义字符串：检测头、类别标签、anchor
+    rknn_custom_string custom;
+    memset(&custom, 0, sizeof(custom));
+    if (rknn_query(ctx, RKNN_QUERY_CUSTOM_STRING, &custom, sizeof(custom)) >= 0)
+        custom_string = custom.string;
+    // 原生布局输出：绑定失败时退回 rknn_outputs_get
+    if (this->config.output_mode == OUTPUT_MODE::OUT_NATIVE && bind_native_outputs() != 0 && verbose)
+        cout << "native output unavailable, fall back to rknn_outputs_get" << endl;
+
+    if (output_mems.empty()) {
+        held_outputs = std::make_unique<rknn_output[]>(io_num.n_output);
+        // 异步模式：rknn_outputs_get 的结果写入预分配内存，下一帧运行时仍然有效
+        if (this->config.async) {
+            host_outputs = std::make_unique<AlignedBuffer<int8_t>[]>(io_num.n_output);
+            for (int i = 0; i < io_num.n_output; i++)
+                host_outputs[i].reserve(output_attrs[i].n_elems);
+        }
+    }
+
+    memset(inputs, 0, sizeof(inputs));
+    inputs[0].index = 0;
+    inputs[0].type = RKNN_TENSOR_UINT8;
+    inputs[0].fmt = RKNN_TENSOR_NHWC;
+    inputs[0].pass_through = 0;
+    return 0;
+}
+
+/**
+ * @Description: 按当前的输入输出属性更新输入尺寸、输出形状与量化参数，输出为 NCHW 解释（c2 = 1）
+ * @return {*}
+ */
+void RknnBackend::update_io_shapes() {
+    batch = std::max(1, (int)input_attrs[0].dims[0]);
+    if (input_attrs[0].fmt == RKNN_TENSOR_NCHW) {
+        channel = input_attrs[0].dims[1];
+        height = input_attrs[0].dims[2];
+        width = input_attrs[0].dims[3];
+    }
+    else {
+        height = input_attrs[0].dims[1];
+        width = input_attrs[0].dims[2];
+        channel = input_attrs[0].dims[3];
+    }
+    outputs.resize(io_num.n_output);
+    output_bytes.resize(io_num.n_output);
+    for (int i = 0; i < io_num.n_output; i++)
+    {
+        rknn_tensor_attr *attr = &output_attrs[i];
+        bool nhwc = attr->fmt == RKNN_TENSOR_NHWC;
+        outputs[i].c = nhwc ? attr->dims[3] : attr->dims[1];
+        outputs[i].h = nhwc ? attr->dims[1] : attr->dims[2];
+        outputs[i].w = nhwc ? attr->dims[2] : attr->dims[3];
+        // 输出为 int8 且每个张量的 zp/scale 固定，解码器据此预先构建查找表，后处理时不再逐 cell 反量化
+        outputs[i].zp = attr->zp;
+        outputs[i].scale = attr->scale;
+        outputs[i].c2 = 1;
+        output_bytes[i] = attr->n_elems;
+    }
+}
+
+/**
+ * @Description: 查询动态形状模型支持的输入形状（只支持单输入），结果存入 input_shapes
+ * @return {int}: 0 为动态形状模型且有多个形状可选；静态模型或不支持时返回 -1
+ */
+int RknnBackend::query_input_shapes() {
+    if (io_num.n_input != 1)
+        return -1;
+    input_range = std::make_unique<rknn_input_range>();
+    memset(input_range.get(), 0, sizeof(rknn_input_range));
+    input_range->index = 0;
+    ret = rknn_query(ctx, RKNN_QUERY_INPUT_DYNAMIC_RANGE, input_range.get(), sizeof(rknn_input_range));
+    if (ret < 0 || input_range->shape_number < 2 || input_range->n_dims != 4) {
+        input_range.reset();
+        return -1;
+    }
+    bool nchw = input_range->fmt == RKNN_TENSOR_NCHW;
+    for (uint32_t k = 0; k < input_range->shape_number; k++)
+    {
+        const uint32_t *dims = input_range->dyn_range[k];
+        input_shapes.push_back({(int)(nchw ? dims[3] : dims[2]), (int)(nchw ? dims[2] : dims[1])});
+    }
+    if (verbose) {
+        cout << "dynamic input shapes:";
+        for (const auto &shape : input_shapes)
+            cout << " " << shape.width << "x" << shape.height;
+        cout << endl;
+    }
+    return 0;
+}
+
+/**
+ * @Description: rknn_set_input_shapes 切换到指定形状，再按 RKNN_QUERY_CURRENT_INPUT_ATTR / CURRENT_OUTPUT_ATTR
+ *               更新输入尺寸和输出网格，前处理和后处理都跟随当前形状
+ * @param {int} index: input_shapes 的下标
+ * @return {int}: 0 成功
+ */
+int RknnBackend::set_input_shape(int index) {
+    for (uint32_t j = 0; j < input_range->n_dims; j++)
+        input_attrs[0].dims[j] = input_range->dyn_range[index][j];
+    input_attrs[0].fmt = input_range->fmt;
+    ret = rknn_set_input_shapes(ctx, io_num.n_input, input_attrs.get());
+    if (ret < 0) {
+        std::cerr << "rknn_set_input_shapes error ret=" << ret << std::endl;
+        return -1;
+    }
+    ret = rknn_query(ctx, RKNN_QUERY_CURRENT_INPUT_ATTR, &input_attrs[0], sizeof(rknn_tensor_attr));
+    for (int i = 0; ret >= 0 && i < io_num.n_output; i++)
+    {
+        output_attrs[i].index = i;
+        ret = rknn_query(ctx, RKNN_QUERY_CURRENT_OUTPUT_ATTR, &output_attrs[i], sizeof(rknn_tensor_attr));
+    }
+    if (ret < 0) {
+        std::cerr << "rknn_query current io attr failed ret=" << ret << std::endl;
+        return -1;
+    }
+    shape_index = index;
+    update_io_shapes();
+    return 0;
+}
+
+/**
+ * @Description: 动态形状模型：按源图宽高比切换输入形状，原生布局输出重新绑定（内存按最大形状分配，无需重新申请）
+ * @param {int} src_w: 源图宽度
+ * @param {int} src_h: 源图高度
+ * @return {int}: 1 已切换，0 形状不变，小于 0 失败
+ */
+int RknnBackend::select_input_shape(int src_w, int src_h) {
+    if (!input_range)
+        return 0;
+    int index = choose_input_shape(input_shapes, src_w, src_h);
+    if (index < 0 || index == shape_index)
+        return 0;
+    if (pending) {
+        std::cerr << "select_input_shape: context is busy" << std::endl;
+        return -1;
+    }
+    if (set_input_shape(index) != 0)
+        return -1;
+    if (!output_mems.empty() && rebind_native_outputs() != 0)
+        return -1;
+    if (verbose) {
+        float scale = std::min((float)width / src_w, (float)height / src_h);
+        int content_w = std::min(width, (int)lrintf(src_w * scale));
+        int content_h = std::min(height, (int)lrintf(src_h * scale));
+        printf("dynamic shape: source %dx%d -> input %dx%d, padding %.1f%%\n", src_w, src_h, width, height,
+               100.f * (1.f - (float)content_w * content_h / (width * height)));
+    }
+    return 1;
+}
+
+/**
+ * @Description: 按核心映射模式（AppConfig::core_mode）设置上下文使用的 NPU 核心
+ *               throughput：每个上下文绑定一个核心，取当前绑定上下文最少的核心，多个线程池之间同样均分
+ *               latency：每个上下文使用全部 3 个核心（RKNN_NPU_CORE_0_1_2），单帧延迟最低；
+ *                        batch 大于 1 的模型改用 rknn_set_batch_core_num，每个核心处理一部分 batch
+ *               mixed：第一个上下文独占核心 0、1，服务延迟敏感的帧，其余上下文共用核心 2
+ * @param {bool} first: 是否为线程池的第一个上下文
+ * @param {bool} verbose: 打印选择结果
+ * @return {int}: 0 成功
+ */
+int RknnBackend::bind_npu_cores(bool first, bool verbose) {
+    core_mask = RKNN_NPU_CORE_AUTO;
+    // 指定了核心（二级分类器），不参与 npu_core_assign 的计数
+    if (this->config.npu_core >= 0 && this->config.npu_core < NPU_CORE_NUM) {
+        core_mask = (rknn_core_mask)(RKNN_NPU_CORE_0 << this->config.npu_core);
+        ret = rknn_set_core_mask(ctx, core_mask);
+        if (ret < 0) {
+            std::cerr << "rknn_set_core_mask error ret=" << ret << std::endl;
+            return -1;
+        }
+        return 0;
+    }
+    if (this->config.core_mode == CORE_MODE::CORE_LATENCY) {
+        int batch = input_attrs[0].dims[0];
+        if (batch > 1) {
+            ret = rknn_set_batch_core_num(ctx, std::min(batch, NPU_CORE_NUM));
+            if (ret < 0) {
+                std::cerr << "rknn_set_batch_core_num error ret=" << ret << std::endl;
+                return -1;
+            }
+            if (verbose)
+                cout << "core mode: latency, batch " << batch << " split over " << std::min(batch, NPU_CORE_NUM)
+                     << " cores" << endl;
+            return 0;
+        }
+        core_mask = RKNN_NPU_CORE_0_1_2;
+    }
+    else if (this->config.core_mode == CORE_MODE::CORE_MIXED) {
+        core_mask = first ? RKNN_NPU_CORE_0_1 : RKNN_NPU_CORE_2;
+    }
+    else {
+        // 绑定到当前上下文最少的核心，销毁时归还
+        npu_core = npu_core_assign();
+        core_mask = (rknn_core_mask)(RKNN_NPU_CORE_0 << npu_core);
+    }
+    ret = rknn_set_core_mask(ctx, core_mask);
+    if (ret < 0) {
+        std::cerr << "rknn_set_core_mask error ret=" << ret << std::endl;
+        return -1;
+    }
+    if (verbose)
+        cout << "core mode: " << core_mode_name(this->config.core_mode) << ", first context core mask: "
+             << core_mask << endl;
+    return 0;
+}
+
+/**
+ * @Description: 创建上下文，模型文件通过 mmap 映射，不再整块读入堆内存
+ *               第一个上下文：默认直接用映射的数据 rknn_init；开启 model_zero_copy 时拷贝到 NPU 可直接访问的内存，
+ *                             以 RKNN_FLAG_MODEL_BUFFER_ZERO_COPY 初始化，运行时不再复制模型，该内存与上下文同生命周期
+ *               其余上下文：以 RKNN_FLAG_SHARE_WEIGHT_MEM 初始化并共享第一个上下文的权重，不支持时退回 rknn_dup_context
+ * @param {rknn_context} *ctx_in: 第一个上下文
+ * @param {bool} share_weight: 是否共享 ctx_in 的权重
+ * @return {int}: 小于 0 失败
+ */
+int RknnBackend::create_context(rknn_context *ctx_in, bool share_weight) {
+    // 异步模式只用 non_block 运行 + rknn_wait 实现重叠，不设置 RKNN_FLAG_ASYNC_MASK：
+    // 该标志下 rknn_outputs_get 返回的是上一帧的结果，与提交的帧不对应
+    uint32_t flag = 0;
+    // 映射只在初始化期间需要，函数返回时解除
+    ModelFile model;
+    if (model.open(this->config.model_path) != 0 && !share_weight) {
+        ret = -1;
+        return ret;
+    }
+
+    if (share_weight) {
+        if (model.data() != nullptr) {
+            rknn_init_extend extend;
+            memset(&extend, 0, sizeof(extend));
+            extend.ctx = *ctx_in;
+            ret = rknn_init(&ctx, model.data(), model.size(), flag | RKNN_FLAG_SHARE_WEIGHT_MEM, &extend);
+            if (ret >= 0) {
+                load_method = "share_weight";
+                return ret;
+            }
+        }
+        load_method = "dup_context";
+        ret = rknn_dup_context(ctx_in, &ctx);
+        return ret;
+    }
+
+    if (this->config.model_zero_copy) {
+        model_mem = rknn_create_mem2(0, model.size(), RKNN_MEM_FLAG_ALLOC_NO_CONTEXT);
+        if (model_mem != nullptr) {
+            memcpy(model_mem->virt_addr, model.data(), model.size());
+            rknn_init_extend extend;
+            memset(&extend, 0, sizeof(extend));
+            extend.model_buffer_fd = model_mem->fd;
+            ret = rknn_init(&ctx, model_mem->virt_addr, model.size(), flag | RKNN_FLAG_MODEL_BUFFER_ZERO_COPY, &extend);
+            if (ret >= 0) {
+                load_method = "model_zero_copy";
+                return ret;
+            }
+            rknn_destroy_mem(0, model_mem);
+            model_mem = nullptr;
+        }
+        cout << "model buffer zero-copy unavailable, fall back to mmap" << endl;
+    }
+    load_method = "mmap";
+    ret = rknn_init(&ctx, model.data(), model.size(), flag, NULL);
+    return ret;
+}
+
+/**
+ * @Description: 创建模型输入缓冲区：优先使用 rknn_create_mem 零拷贝，不可用时退回普通内存 + rknn_inputs_set
+ * @param {bool} verbose: 打印原生属性和退回信息
+ * @return {unique_ptr<InputBuffer>}
+ */
+std::unique_ptr<InputBuffer> RknnBackend::create_input_buffer(bool verbose) {
+    if (this->config.zero_copy) {
+        auto rknn_buf = std::make_unique<RknnInputBuffer>();
+        if (rknn_buf->create(ctx, 0, verbose, input_range != nullptr) == 0 && rknn_buf->get_width() == width &&
+            rknn_buf->get_height() == height && rknn_buf->get_channel() == channel)
+            return rknn_buf;
+        if (verbose)
+            cout << "zero-copy input unavailable, fall back to rknn_inputs_set" << endl;
+    }
+    return InferenceBackend::create_input_buffer(verbose);
+}
+
+/**
+ * @Description: 查询原生输出属性（动态形状模型为当前形状），检查网格与逻辑形状一致且为后处理支持的布局
+ * @param {vector<int>} &c2s: 每个输出的通道分组大小
+ * @return {int}: 0 成功
+ */
+int RknnBackend::query_native_outputs(std::vector<int> &c2s) {
+    c2s.assign(io_num.n_output, 1);
+    native_out_attrs.resize(io_num.n_output);
+    for (int i = 0; i < io_num.n_output; i++)
+    {
+        rknn_tensor_attr &attr = native_out_attrs[i];
+        memset(&attr, 0, sizeof(attr));
+        attr.index = i;
+        ret = rknn_query(ctx, input_range ? RKNN_QUERY_CURRENT_NATIVE_OUTPUT_ATTR : RKNN_QUERY_NATIVE_OUTPUT_ATTR,
+                         &attr, sizeof(attr));
+        if (ret < 0 || attr.type != RKNN_TENSOR_INT8)
+            return -1;
+        if (verbose)
+            dump_tensor_attr(&attr);
+
+        // 后处理只支持网格与逻辑形状一致的 NC1HWC2 / NHWC
+        const head_tensor_t &t = outputs[i];
+        size_t grid_len = (size_t)t.h * t.w;
+        if (attr.fmt == RKNN_TENSOR_NC1HWC2 && attr.n_dims == 5 && (int)attr.dims[2] == t.h &&
+            (int)attr.dims[3] == t.w)
+            c2s[i] = attr.dims[4];
+        else if (attr.fmt == RKNN_TENSOR_NHWC && attr.n_dims == 4 && (int)attr.dims[1] == t.h &&
+                 (int)attr.dims[2] == t.w)
+            c2s[i] = attr.size_with_stride / grid_len; // 通道可能按对齐补齐
+        else
+            return -1;
+        if (c2s[i] <= 0 || attr.size_with_stride < (size_t)(t.c + c2s[i] - 1) / c2s[i] * grid_len * c2s[i])
+            return -1;
+    }
+    return 0;
+}
+
+/**
+ * @Description: 查询原生输出属性，为每个输出分配内存并绑定到上下文，推理后不再调用 rknn_outputs_get
+ *               int8 输出的原生布局为 NC1HWC2（或 NHWC），省掉运行时转换为 NCHW 的开销和拷贝
+ * @return {int}: 0 成功，成功时 outputs 记录每个输出的通道分组大小；失败时不占用任何资源，outputs 保持 NCHW
+ */
+int RknnBackend::bind_native_outputs() {
+    std::vector<int> c2s;
+    if (query_native_outputs(c2s) != 0)
+        return -1;
+    // 异步模式需要两组输出内存，NPU 写入一组的同时后处理读取另一组
+    if (alloc_native_outputs(output_mems) != 0 ||
+        (this->config.async && alloc_native_outputs(output_mems_alt) != 0)) {
+        release_native_outputs();
+        return -1;
+    }
+    for (int i = 0; i < io_num.n_output; i++)
+    {
+        outputs[i].c2 = c2s[i];
+        output_bytes[i] = native_out_attrs[i].size_with_stride;
+    }
+    return 0;
+}
+
+/**
+ * @Description: 输入形状切换后重新查询原生输出属性，并把已分配的输出内存按新属性绑定（异步模式的另一组在 submit 时绑定）
+ * @return {int}: 0 成功
+ */
+int RknnBackend::rebind_native_outputs() {
+    std::vector<int> c2s;
+    if (query_native_outputs(c2s) != 0) {
+        std::cerr << "native output unsupported for the current input shape" << std::endl;
+        return -1;
+    }
+    for (int i = 0; i < io_num.n_output; i++)
+    {
+        if (native_out_attrs[i].size_with_stride > output_mems[i]->size) {
+            std::cerr << "native output " << i << " larger than the allocated memory" << std::endl;
+            return -1;
+        }
+        ret = rknn_set_io_mem(ctx, output_mems[i], &native_out_attrs[i]);
+        if (ret < 0) {
+            std::cerr << "rknn_set_io_mem output " << i << " failed ret=" << ret << std::endl;
+            return -1;
+        }
+        outputs[i].c2 = c2s[i];
+        output_bytes[i] = native_out_attrs[i].size_with_stride;
+    }
+    return 0;
+}
+
+/**
+ * @Description: 按 native_out_attrs 为每个输出分配一块内存并绑定到上下文
+ * @param {vector<rknn_tensor_mem *>} &mems: 分配结果，失败时已分配的部分由 release_native_outputs 释放
+ * @return {int}: 0 成功
+ */
+int RknnBackend::alloc_native_outputs(std::vector<rknn_tensor_mem *> &mems) {
+    for (int i = 0; i < io_num.n_output; i++)
+    {
+        rknn_tensor_mem *mem = rknn_create_mem(ctx, native_out_attrs[i].size_with_stride);
+        if (mem == nullptr)
+            return -1;
+        mems.push_back(mem);
+        ret = rknn_set_io_mem(ctx, mem, &native_out_attrs[i]);
+        if (ret < 0) {
+            std::cerr << "rknn_set_io_mem output " << i << " failed ret=" << ret << std::endl;
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void RknnBackend::release_native_outputs() {
+    for (auto mem : output_mems)
+        rknn_destroy_mem(ctx, mem);
+    output_mems.clear();
+    for (auto mem : output_mems_alt)
+        rknn_destroy_mem(ctx, mem);
+    output_mems_alt.clear();
+}
+
+int RknnBackend::bind_input(InputBuffer &buf) {
+    // 零拷贝时输入内存已绑定；异步模式两块输入缓冲区轮流使用，需要重新绑定
+    if (buf.bound())
+        return this->config.async ? buf.rebind() : 0;
+    inputs[0].buf = buf.data();
+    inputs[0].size = buf.size();
+    return rknn_inputs_set(ctx, io_num.n_input, inputs);
+}
+
+int RknnBackend::run(InputBuffer &buf, int8_t **out_bufs) {
+    ret = bind_input(buf);
+    if (ret < 0) {
+        std::cerr << "rknn_inputs_set error ret=" << ret << std::endl;
+        return -1;
+    }
+    // 模型推理
+    ret = rknn_run(ctx, NULL);
+    if (ret < 0) {
+        std::cerr << "rknn_run error ret=" << ret << std::endl;
+        return -1;
+    }
+    // 原生布局输出已由 NPU 写入绑定的内存（rknn_run 默认会刷新输出 cache），直接读取
+    if (!output_mems.empty()) {
+        for (int i = 0; i < io_num.n_output; i++)
+            out_bufs[i] = (int8_t *)output_mems[i]->virt_addr;
+        return 0;
+    }
+    memset(held_outputs.get(), 0, sizeof(rknn_output) * io_num.n_output);
+    for (int i = 0; i < io_num.n_output; i++)
+        held_outputs[i].want_float = 0;
+    ret = rknn_outputs_get(ctx, io_num.n_output, held_outputs.get(), NULL);
+    if (ret < 0) {
+        std::cerr << "rknn_outputs_get error ret=" << ret << std::endl;
+        return -1;
+    }
+    outputs_held = true;
+    for (int i = 0; i < io_num.n_output; i++)
+        out_bufs[i] = (int8_t *)held_outputs[i].buf;
+    return 0;
+}
+
+void RknnBackend::release_outputs() {
+    if (!outputs_held)
+        return;
+    rknn_outputs_release(ctx, io_num.n_output, held_outputs.get());
+    outputs_held = false;
+}
+
+/**
+ * @Description: 异步模式：绑定输入和空闲的一组输出内存并提交推理，rknn_run 不等待完成
+ *               调用前上下文必须空闲（没有提交或已经 collect）；提交后两组输出内存交换，刚提交的一组成为当前组
+ * @param {InputBuffer} &buf: 已写入当前帧的输入缓冲区
+ * @return {int}: 0 成功
+ */
+int RknnBackend::submit(InputBuffer &buf) {
+    ret = bind_input(buf);
+    for (size_t i = 0; ret >= 0 && i < output_mems_alt.size(); i++)
+        ret = rknn_set_io_mem(ctx, output_mems_alt[i], &native_out_attrs[i]);
+    if (ret < 0) {
+        std::cerr << "async bind buffers failed ret=" << ret << std::endl;
+        return -1;
+    }
+
+    memset(&run_ext, 0, sizeof(run_ext));
+    run_ext.non_block = 1;
+    ret = rknn_run(ctx, &run_ext);
+    if (ret < 0) {
+        std::cerr << "rknn_run error ret=" << ret << std::endl;
+        return -1;
+    }
+    pending = true;
+    std::swap(output_mems, output_mems_alt);
+    return 0;
+}
+
+/**
+ * @Description: 异步模式：等待已提交的帧完成，取得输出
+ *               原生布局直接读取 output_mems；否则 rknn_outputs_get 写入预分配的 host_outputs
+ * @param {int8_t} **out_bufs: 每个输出的数据指针，在下一次 submit 之后仍然有效
+ * @return {int}: 0 成功
+ */
+int RknnBackend::collect(int8_t **out_bufs) {
+    if (!pending)
+        return -1;
+    pending = false;
+    ret = rknn_wait(ctx, &run_ext);
+    if (ret < 0) {
+        std::cerr << "rknn_wait error ret=" << ret << std::endl;
+        return -1;
+    }
+
+    if (!output_mems.empty()) {
+        // 非阻塞运行不保证在返回时刷新输出 cache，读取前手动同步
+        for (int i = 0; i < io_num.n_output; i++)
+        {
+            rknn_mem_sync(ctx, output_mems[i], RKNN_MEMORY_SYNC_FROM_DEVICE);
+            out_bufs[i] = (int8_t *)output_mems[i]->virt_addr;
+        }
+        return 0;
+    }
+
+    rknn_output outputs[io_num.n_output];
+    memset(outputs, 0, sizeof(outputs));
+    for (int i = 0; i < io_num.n_output; i++)
+    {
+        outputs[i].want_float = 0;
+        outputs[i].is_prealloc = 1;
+        outputs[i].index = i;
+        outputs[i].buf = host_outputs[i].data();
+        outputs[i].size = output_attrs[i].n_elems;
+        out_bufs[i] = host_outputs[i].data();
+    }
+    rknn_output_extend out_ext;
+    memset(&out_ext, 0, sizeof(out_ext));
+    ret = rknn_outputs_get(ctx, io_num.n_output, outputs, &out_ext);
+    if (ret < 0) {
+        std::cerr << "rknn_outputs_get error ret=" << ret << std::endl;
+        return -1;
+    }
+    rknn_outputs_release(ctx, io_num.n_output, outputs);
+    // 已经等到该帧完成，取到的必须是同一帧，否则输出属于别的帧，不能交给后处理
+    if (out_ext.frame_id != run_ext.frame_id) {
+        std::cerr << "async outputs frame id " << out_ext.frame_id << " != " << run_ext.frame_id << std::endl;
+        return -1;
+    }
+    return 0;
+}
+
+RknnBackend::~RknnBackend()
+{
+    // 异步模式下可能仍有未完成的推理，先等待再释放其使用的内存
+    if (pending)
+        rknn_wait(ctx, &run_ext);
+    release_outputs();
+    // 输出内存属于上下文，需要在 rknn_destroy 之前释放；输入缓冲区由 rkYolo 先于后端释放
+    release_native_outputs();
+    ret = rknn_destroy(ctx);
+    npu_core_release(npu_core);
+    // 零拷贝的模型内存由运行时直接使用，上下文销毁后才能释放
+    if (model_mem != nullptr)
+        rknn_destroy_mem(0, model_mem);
+    if (ret < 0) {
+        cout << "rknn_destroy fail! ret=" << ret << endl;
+    }
+}
+
+std::unique_ptr<InferenceBackend> create_rknn_backend(const AppConfig &config)
+{
+    return std::make_unique<RknnBackend>(config);
+}
@@ -0,0 +1,76 @@
+/*
+ * @Author: Li RF
+ * @Date: 2025-04-11 10:12:45
+ * @LastEditors: Li RF
+ * @LastEditTime: 2025-04-11 10:12:45
+ * @Description: 模型输入缓冲区：letterbox 几何、OpenCV 前处理与普通内存实现
+ *               不依赖 NPU，可单独编译测试
+ * Email: 1125962926@qq.com
+ * Copyright (c) 2025 Li RF, All Rights Reserved.
+ */
+#include <string.h>
+#include <algorithm>
+#include <iostream>
+
+#include "opencv2/imgproc.hpp"
+
+#include "input_buffer.h"
+
+bool InputBuffer::update_letterbox(int src_w, int src_h)
+{
+    if (src_w == src_width && src_h == src_height)
+        return false;
+    src_width = src_w;
+    src_height = src_h;
+
+    // 与 letterbox() 相同：等比例缩放后居中，多出的一个像素放在右/下
+    scale = std::min((float)width / src_w, (float)height / src_h);
+    int content_w = std::min(width, std::max(1, cvRound(src_w * scale)));
+    int content_h = std::min(height, std::max(1, cvRound(src_h * scale)));
+    pads.left = (width - content_w) / 2;
+    pads.right = width - content_w - pads.left;
+    pads.top = (height - content_h) / 2;
+    pads.bottom = height - content_h - pads.top;
+    content = cv::Rect(pads.left, pads.top, content_w, content_h);
+
+    // 只在几何变化时填充一次，之后每帧只重写内容区域
+    memset(buf, INPUT_PAD_COLOR, size());
+    sync_to_device();
+    return true;
+}
+
+cv::Mat InputBuffer::view()
+{
+    return cv::Mat(height, width, CV_8UC(channel), buf, (size_t)w_stride * channel);
+}
+
+int InputBuffer::write_letterbox(const cv::Mat &bgr, bool use_opencl)
+{
+    if (bgr.empty() || bgr.type() != CV_8UC3 || channel != 3) {
+        std::cerr << "Error: write_letterbox needs a CV_8UC3 image." << std::endl;
+        return -1;
+    }
+    // roi 与缓冲区共享内存，尺寸和类型已匹配，resize/cvtColor 不会重新分配
+    cv::Mat roi = view()(content);
+    if (use_opencl) {
+        cv::UMat u_resized;
+        cv::resize(bgr.getUMat(cv::ACCESS_READ), u_resized, content.size());
+        u_resized.copyTo(roi);
+    }
+    else {
+        cv::resize(bgr, roi, content.size());
+    }
+    // 先缩放再换通道，只需处理模型输入大小的区域
+    cv::cvtColor(roi, roi, cv::COLOR_BGR2RGB);
+    return 0;
+}
+
+HostInputBuffer::HostInputBuffer(int width, int height, int channel, int w_stride)
+{
+    this->width = width;
+    this->height = height;
+    this->channel = channel;
+    this->w_stride = std::max(width, w_stride);
+    storage.reserve(size());
+    buf = storage.data();
+}
@@ -0,0 +1,91 @@
+/*
+ * @Author: Li RF
+ * @Date: 2025-04-11 10:12:45
+ * @LastEditors: Li RF
+ * @LastEditTime: 2025-04-11 10:12:45
+ * @Description: 零拷贝输入：rknn_create_mem 分配输入张量，rknn_set_io_mem 绑定到上下文
+ *               前处理直接写入该内存，推理时不再经过 rknn_inputs_set 的拷贝和格式转换
+ * Email: 1125962926@qq.com
+ * Copyright (c) 2025 Li RF, All Rights Reserved.
+ */
+#include <string.h>
+#include <iostream>
+
+#include "input_buffer.h"
+
+int RknnInputBuffer::create(rknn_context ctx, int index, bool verbose, bool current)
+{
+    memset(&attr, 0, sizeof(attr));
+    attr.index = index;
+    int ret = rknn_query(ctx, current ? RKNN_QUERY_CURRENT_NATIVE_INPUT_ATTR : RKNN_QUERY_NATIVE_INPUT_ATTR, &attr,
+                         sizeof(attr));
+    if (ret < 0) {
+        std::cerr << "rknn_query native input attr failed ret=" << ret << std::endl;
+        return -1;
+    }
+    // 原生属性给出的 w_stride 是 NPU 要求的行对齐，前处理按该步长写入
+    if (attr.fmt == RKNN_TENSOR_NCHW) {
+        channel = attr.dims[1];
+        height = attr.dims[2];
+        width = attr.dims[3];
+    }
+    else {
+        height = attr.dims[1];
+        width = attr.dims[2];
+        channel = attr.dims[3];
+    }
+    w_stride = attr.w_stride > 0 ? (int)attr.w_stride : width;
+
+    // 输入为 uint8 NHWC 的 RGB 图像，归一化和量化仍由 NPU 完成
+    attr.type = RKNN_TENSOR_UINT8;
+    attr.fmt = RKNN_TENSOR_NHWC;
+    attr.pass_through = 0;
+    uint32_t mem_size = attr.size_with_stride > 0 ? attr.size_with_stride : (uint32_t)size();
+    if (mem_size < size()) {
+        std::cerr << "native input size " << mem_size << " smaller than " << size() << std::endl;
+        return -1;
+    }
+
+    mem = rknn_create_mem(ctx, mem_size);
+    if (mem == nullptr) {
+        std::cerr << "rknn_create_mem failed" << std::endl;
+        return -1;
+    }
+    ret = rknn_set_io_mem(ctx, mem, &attr);
+    if (ret < 0) {
+        std::cerr << "rknn_set_io_mem input failed ret=" << ret << std::endl;
+        rknn_destroy_mem(ctx, mem);
+        mem = nullptr;
+        return -1;
+    }
+    this->ctx = ctx;
+    buf = (uint8_t *)mem->virt_addr;
+
+    if (verbose)
+        printf("zero-copy input: %dx%dx%d, w_stride=%d, size_with_stride=%u, fd=%d\n", width, height, channel,
+               w_stride, mem_size, mem->fd);
+    return 0;
+}
+
+int RknnInputBuffer::sync_to_device()
+{
+    // rknn_run 默认会刷新输入 cache；这里用于填充区域写入后、RGA 通过 fd 写内容区域之前，
+    // 避免之后的 cache 回写覆盖 RGA 的结果
+    if (mem == nullptr)
+        return -1;
+    return rknn_mem_sync(ctx, mem, RKNN_MEMORY_SYNC_TO_DEVICE);
+}
+
+int RknnInputBuffer::rebind()
+{
+    // 同一上下文只有最后一次 rknn_set_io_mem 的输入生效，需在上下文空闲（rknn_wait 之后）切换
+    if (mem == nullptr)
+        return -1;
+    return rknn_set_io_mem(ctx, mem, &attr);
+}
+
+RknnInputBuffer::~RknnInputBuffer()
+{
+    if (mem != nullptr)
+        rknn_destroy_mem(ctx, mem);
+}
@@ -17,9 +17,13 @@
 #include <opencv2/opencv.hpp>
 #include <opencv2/core/ocl.hpp>
 
+#include "box_propagator.h"
+#include "classifier.h"
+#include "motion_gate.h"
 #include "rkYolo.hpp"
 #include "rknnPool.hpp"
 #include "parse_config.hpp"
+#include "profiler.h"
 #include "VideoReader.hpp"
 #include "SharedTypes.hpp"
 
@@ -55,6 +59,12 @@ int main(int argc, char **argv) {
     ConfigParser parser;
     AppConfig config = parser.parse_arguments(argc, argv);
 
+    /* 逐层性能分析 / 对比，完成后直接退出 */
+    if (!config.compare.empty())
+        return run_perf_compare(config.compare) == 0 ? 0 : -1;
+    if (config.profile_frames > 0)
+        return run_profile(config) == 0 ? 0 : -1;
+
     /* 检查 opencl */ 
     if (config.opencl) {
         // 启用 OpenCL
@@ -80,12 +90,31 @@ int main(int argc, char **argv) {
         return -EXIT_FAILURE;
     }
     
+    /* 二级分类器：先于线程池声明，线程池析构时仍在运行的合并任务可以使用 */
+    std::unique_ptr<Classifier> classifier;
+
     /* 初始化 rknn 线程池 */ 
     rknnPool<rkYolo, cv::Mat, cv::Mat> yolo_pool(config);
     if (yolo_pool.init() != 0) {
         std::cerr << "rknnPool init fail!" << std::endl;
         return -1;
     }
+    /* 每个 NPU 核心一个分类上下文，批推理交给调度器中最空闲的核心 */
+    if (!config.cls_model.empty()) {
+        classifier = std::make_unique<Classifier>(config);
+        if (classifier->init(yolo_pool.get_dispatcher()) != 0) {
+            std::cerr << "classifier init fail!" << std::endl;
+            return -1;
+        }
+        yolo_pool.set_classifier(classifier.get());
+    }
+
+    /* 运动门控：每路视频流一个，阈值取自该路的配置 */
+    std::unique_ptr<MotionGate> gate;
+    if (config.gate_interval > 0)
+        gate = std::make_unique<MotionGate>(config);
+    /* 关键帧检测：由线程池持有，这里决定每一帧是否推理 */
+    BoxPropagator *propagator = yolo_pool.get_propagator();
 
     /* 用于计算 FPS 的参数 */
     int fps = 0;
@@ -109,9 +138,33 @@ int main(int argc, char **argv) {
         // auto start_put = std::chrono::high_resolution_clock::now();
 
         // 放入 rknn 线程池
-        if (!img.empty())
-            if (yolo_pool.put(img) != 0)
+        if (!img.empty()) {
+            int ret;
+            // 优先用解码得到的 NV12 Y 平面，不支持时用 BGR 帧
+            cv::Mat luma;
+            if ((gate || propagator) && !video_reader_ptr->getLuma(luma))
+                luma = img;
+            if (gate && gate->update(luma) == GATE_RESULT::GATE_SKIP) {
+                ret = yolo_pool.putReuse(img);
+            }
+            else if (propagator) {
+                // Y 平面在读取下一帧时会被覆盖，缩小到新的灰度图后再交给合并线程
+                cv::Mat gray;
+                BoxPropagator::prepare(luma, gray);
+                ret = propagator->next_keyframe() ? yolo_pool.putKeyframe(img, gray) : yolo_pool.putPropagate(img, gray);
+            }
+            else if (config.track != TRACK_MODE::TRACK_OFF || !config.cls_model.empty()) {
+                ret = yolo_pool.putOrdered(img);
+            }
+            else if (gate) {
+                ret = config.tiling ? yolo_pool.putTiled(img) : yolo_pool.putDetect(img);
+            }
+            else {
+                ret = config.tiling ? yolo_pool.putTiled(img) : yolo_pool.put(img, config.urgent);
+            }
+            if (ret != 0)
                 break;
+        }
 
         // auto end_put = std::chrono::high_resolution_clock::now();
         // auto start_get = std::chrono::high_resolution_clock::now();
@@ -161,9 +214,18 @@ int main(int argc, char **argv) {
         // std::cout << "-----------------------------" << std::endl;
     }
 
-    // 等待 rknn 线程池处理完所有图像
+    // 等待 rknn 线程池处理完所有图像（异步模式下先取出各上下文中的最后一帧）
+    yolo_pool.flush();
     cv::Mat img;
     while(!yolo_pool.get(img));
+    // 同一输入下对比不同核心映射模式（-k）的 FPS 和延迟
+    yolo_pool.report();
+    if (gate)
+        gate->report();
+    if (propagator)
+        propagator->report();
+    if (classifier)
+        classifier->report();
 
     // 关闭视频文件
     video_reader_ptr->Close_Video();
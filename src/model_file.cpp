@@ -0,0 +1,54 @@
+/*
+ * @Author: Li RF
+ * @Date: 2025-04-15 09:48:17
+ * @LastEditors: Li RF
+ * @LastEditTime: 2025-04-15 09:48:17
+ * @Description: 只读映射的模型文件
+ * Email: 1125962926@qq.com
+ * Copyright (c) 2025 Li RF, All Rights Reserved.
+ */
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <iostream>
+
+#include "model_file.h"
+
+int ModelFile::open(const std::string &path)
+{
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        std::cerr << "Failed to open: " << path << " (" << strerror(errno) << ")" << std::endl;
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        std::cerr << "Failed to get file size: " << path << std::endl;
+        ::close(fd);
+        return -1;
+    }
+    void *p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // 映射建立后 fd 不再需要
+    ::close(fd);
+    if (p == MAP_FAILED) {
+        std::cerr << "mmap failed: " << path << " (" << strerror(errno) << ")" << std::endl;
+        return -1;
+    }
+    // rknn_init 顺序解析整个模型：按顺序访问，并立即开始预读
+    madvise(p, st.st_size, MADV_SEQUENTIAL);
+    madvise(p, st.st_size, MADV_WILLNEED);
+    addr = p;
+    length = st.st_size;
+    return 0;
+}
+
+void ModelFile::close()
+{
+    if (addr != nullptr)
+        munmap(addr, length);
+    addr = nullptr;
+    length = 0;
+}
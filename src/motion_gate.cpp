@@ -0,0 +1,78 @@
+/*
+ * @Author: Li RF
+ * @Date: 2025-04-19 09:41:08
+ * @LastEditors: Li RF
+ * @LastEditTime: 2025-04-19 09:41:08
+ * @Description: 运动门控：缩小亮度图的帧差与场景切换检测
+ * Email: 1125962926@qq.com
+ * Copyright (c) 2025 Li RF, All Rights Reserved.
+ */
+#include <stdio.h>
+#include <algorithm>
+
+#include "opencv2/imgproc.hpp"
+
+#include "motion_gate.h"
+
+MotionGate::MotionGate(const AppConfig &config)
+{
+    interval = std::max(1, config.gate_interval);
+    pixel_threshold = config.gate_pixel;
+    area_threshold = config.gate_area;
+    scene_threshold = config.gate_scene;
+}
+
+int MotionGate::update(const cv::Mat &frame)
+{
+    frames++;
+    // 先缩小再比较，INTER_AREA 取块平均，同时压低传感器噪声；BGR 缩小后再转灰度
+    cv::Size size(GATE_WIDTH, std::max(1, GATE_WIDTH * frame.rows / std::max(1, frame.cols)));
+    if (frame.channels() == 1) {
+        cv::resize(frame, small, size, 0, 0, cv::INTER_AREA);
+    }
+    else {
+        cv::resize(frame, diff, size, 0, 0, cv::INTER_AREA);
+        cv::cvtColor(diff, small, cv::COLOR_BGR2GRAY);
+    }
+
+    int result;
+    if (reference.empty() || reference.rows != small.rows || reference.cols != small.cols) {
+        result = GATE_RESULT::GATE_SCENE;
+    }
+    else {
+        cv::absdiff(small, reference, diff);
+        cv::threshold(diff, mask, pixel_threshold, 255, cv::THRESH_BINARY);
+        float changed = (float)cv::countNonZero(mask) / (float)mask.total();
+        if (cv::mean(diff)[0] > scene_threshold)
+            result = GATE_RESULT::GATE_SCENE;
+        else if (changed > area_threshold)
+            result = GATE_RESULT::GATE_MOTION;
+        else if (since_infer + 1 >= interval)
+            result = GATE_RESULT::GATE_FORCED;
+        else
+            result = GATE_RESULT::GATE_SKIP;
+    }
+
+    counts[result]++;
+    if (result == GATE_RESULT::GATE_SKIP) {
+        since_infer++;
+    }
+    else {
+        // 参考帧只在推理时更新，缓慢的变化也会累积到阈值
+        std::swap(reference, small);
+        since_infer = 0;
+    }
+    return result;
+}
+
+void MotionGate::report() const
+{
+    if (frames == 0)
+        return;
+    long long inferred = frames - counts[GATE_RESULT::GATE_SKIP];
+    printf("motion gate: frames: %lld, inferred: %lld (motion %lld, scene %lld, forced %lld), skipped: %lld (%.1f%% "
+           "NPU work saved)\n",
+           frames, inferred, counts[GATE_RESULT::GATE_MOTION], counts[GATE_RESULT::GATE_SCENE],
+           counts[GATE_RESULT::GATE_FORCED], counts[GATE_RESULT::GATE_SKIP],
+           100.0 * counts[GATE_RESULT::GATE_SKIP] / frames);
+}
@@ -0,0 +1,289 @@
+/*
+ * @Author: Li RF
+ * @Date: 2025-04-05 15:20:11
+ * @LastEditors: Li RF
+ * @LastEditTime: 2025-04-05 15:20:11
+ * @Description: 非极大值抑制引擎
+ *               原实现先对全部候选递归快排，再对每个类别各扫描一遍全部候选，复杂度 O(类别数 × n²)；
+ *               这里改为堆上的部分 top-K 选择 + 单遍按类别分桶的贪心抑制，
+ *               每个候选只与已保留的同类别框比较，保留框以 SoA 数组存放
+ * Email: 1125962926@qq.com
+ * Copyright (c) 2025 Li RF, All Rights Reserved.
+ */
+#include "nms.h"
+#include "SharedTypes.hpp"
+
+#include <float.h>
+#include <math.h>
+#include <algorithm>
+
+/**
+ * @brief 计算两个边界框的交并比（IoU），与原 postprocess.cpp 中的实现保持一致
+ */
+static float CalculateOverlap(float xmin0, float ymin0, float xmax0, float ymax0, float xmin1, float ymin1, float xmax1,
+                              float ymax1)
+{
+    float w = fmax(0.f, fmin(xmax0, xmax1) - fmax(xmin0, xmin1) + 1.0);
+    float h = fmax(0.f, fmin(ymax0, ymax1) - fmax(ymin0, ymin1) + 1.0);
+    float i = w * h;
+    float u = (xmax0 - xmin0 + 1.0) * (ymax0 - ymin0 + 1.0) + (xmax1 - xmin1 + 1.0) * (ymax1 - ymin1 + 1.0) - i;
+    return u <= 0.f ? 0.f : (i / u);
+}
+
+/**
+ * @Description: 堆比较函数：置信度高者优先，相同置信度时下标小者优先
+ */
+struct ScoreLess
+{
+    const float *scores;
+    bool operator()(int a, int b) const
+    {
+        if (scores[a] != scores[b])
+            return scores[a] < scores[b];
+        return a > b;
+    }
+};
+
+void NmsScratch::reserve(int capacity, int max_keep)
+{
+    if (capacity > this->capacity)
+    {
+        heap.reserve(capacity);
+        this->capacity = capacity;
+    }
+    if (max_keep > this->max_keep)
+    {
+        kx1.reserve(max_keep);
+        ky1.reserve(max_keep);
+        kx2.reserve(max_keep);
+        ky2.reserve(max_keep);
+        kcls.reserve(max_keep);
+        stamp.reserve(max_keep);
+        large.reserve(max_keep);
+        node_kept.reserve(max_keep * NMS_GRID_MAX_CELLS_PER_BOX);
+        node_next.reserve(max_keep * NMS_GRID_MAX_CELLS_PER_BOX);
+        this->max_keep = max_keep;
+    }
+    cell_head.reserve(NMS_GRID_MAX_DIM * NMS_GRID_MAX_DIM);
+}
+
+/**
+ * @Description: 建立候选下标的最大堆，堆顶为当前最高分
+ * @return {*}
+ */
+static void build_heap(int count, const float *scores, NmsScratch &scratch)
+{
+    int *heap = scratch.heap.data();
+    for (int i = 0; i < count; i++)
+        heap[i] = i;
+    std::make_heap(heap, heap + count, ScoreLess{scores});
+}
+
+int nms_topk(int count, const float *boxes, const float *scores, const int *class_ids, float threshold,
+             int max_keep, int *keep, NmsScratch &scratch)
+{
+    if (count <= 0 || max_keep <= 0)
+        return 0;
+    scratch.reserve(count, max_keep);
+
+    // 部分 top-K：建堆 O(n)，之后每次只弹出当前最高分，保留数够了就停止
+    build_heap(count, scores, scratch);
+    ScoreLess less{scores};
+    int *heap = scratch.heap.data();
+    int heap_size = count;
+
+    // 已保留框的 SoA 数组
+    float *kx1 = scratch.kx1.data(), *ky1 = scratch.ky1.data();
+    float *kx2 = scratch.kx2.data(), *ky2 = scratch.ky2.data();
+    int *kcls = scratch.kcls.data();
+
+    int n_keep = 0;
+    while (heap_size > 0 && n_keep < max_keep)
+    {
+        std::pop_heap(heap, heap + heap_size, less);
+        int n = heap[--heap_size];
+
+        float x1 = boxes[n * 4 + 0];
+        float y1 = boxes[n * 4 + 1];
+        float x2 = boxes[n * 4 + 0] + boxes[n * 4 + 2];
+        float y2 = boxes[n * 4 + 1] + boxes[n * 4 + 3];
+        int cls = class_ids[n];
+
+        bool suppressed = false;
+        for (int k = 0; k < n_keep; k++)
+        {
+            if (kcls[k] != cls)
+                continue;
+            if (CalculateOverlap(kx1[k], ky1[k], kx2[k], ky2[k], x1, y1, x2, y2) > threshold)
+            {
+                suppressed = true;
+                break;
+            }
+        }
+        if (suppressed)
+            continue;
+
+        kx1[n_keep] = x1;
+        ky1[n_keep] = y1;
+        kx2[n_keep] = x2;
+        ky2[n_keep] = y2;
+        kcls[n_keep] = cls;
+        keep[n_keep] = n;
+        n_keep++;
+    }
+    return n_keep;
+}
+
+/**
+ * @Description: 坐标所在的网格下标，超出范围的截断到边缘格子
+ */
+static inline int grid_index(float v, float origin, float cell_size, int dim)
+{
+    int idx = (int)floorf((v - origin) / cell_size);
+    return idx < 0 ? 0 : (idx >= dim ? dim - 1 : idx);
+}
+
+int nms_topk_grid(int count, const float *boxes, const float *scores, const int *class_ids, float threshold,
+                  int max_keep, int *keep, float cell_size, NmsScratch &scratch)
+{
+    if (count <= 0 || max_keep <= 0)
+        return 0;
+    scratch.reserve(count, max_keep);
+
+    // 网格范围覆盖全部候选框。IoU 公式带 +1 像素，右下边界多扩展 1 像素，
+    // 保证 IoU 大于 0 的两个框至少共享一个格子
+    float min_x = FLT_MAX, min_y = FLT_MAX, max_x = -FLT_MAX, max_y = -FLT_MAX;
+    for (int i = 0; i < count; i++)
+    {
+        min_x = std::min(min_x, boxes[i * 4 + 0]);
+        min_y = std::min(min_y, boxes[i * 4 + 1]);
+        max_x = std::max(max_x, boxes[i * 4 + 0] + boxes[i * 4 + 2] + 1.f);
+        max_y = std::max(max_y, boxes[i * 4 + 1] + boxes[i * 4 + 3] + 1.f);
+    }
+    cell_size = std::max(cell_size, 1.f);
+    cell_size = std::max(cell_size, std::max(max_x - min_x, max_y - min_y) / NMS_GRID_MAX_DIM);
+    int grid_w = (int)((max_x - min_x) / cell_size) + 1;
+    int grid_h = (int)((max_y - min_y) / cell_size) + 1;
+    grid_w = std::min(grid_w, NMS_GRID_MAX_DIM);
+    grid_h = std::min(grid_h, NMS_GRID_MAX_DIM);
+
+    // 每个格子一个单链表，节点保存已保留框的序号
+    int *cell_head = scratch.cell_head.data();
+    int *node_kept = scratch.node_kept.data();
+    int *node_next = scratch.node_next.data();
+    std::fill(cell_head, cell_head + grid_w * grid_h, -1);
+    int n_node = 0;
+    // 覆盖格子过多的大框单独存放，避免登记开销
+    int *large = scratch.large.data();
+    int n_large = 0;
+    // 一个保留框可能登记在多个格子中，用时间戳避免对同一个框重复计算 IoU
+    int *stamp = scratch.stamp.data();
+    std::fill(stamp, stamp + max_keep, -1);
+
+    build_heap(count, scores, scratch);
+    ScoreLess less{scores};
+    int *heap = scratch.heap.data();
+    int heap_size = count;
+
+    float *kx1 = scratch.kx1.data(), *ky1 = scratch.ky1.data();
+    float *kx2 = scratch.kx2.data(), *ky2 = scratch.ky2.data();
+    int *kcls = scratch.kcls.data();
+
+    int n_keep = 0;
+    int serial = 0;
+    while (heap_size > 0 && n_keep < max_keep)
+    {
+        std::pop_heap(heap, heap + heap_size, less);
+        int n = heap[--heap_size];
+
+        float x1 = boxes[n * 4 + 0];
+        float y1 = boxes[n * 4 + 1];
+        float x2 = boxes[n * 4 + 0] + boxes[n * 4 + 2];
+        float y2 = boxes[n * 4 + 1] + boxes[n * 4 + 3];
+        int cls = class_ids[n];
+
+        int gx0 = grid_index(x1, min_x, cell_size, grid_w);
+        int gx1 = grid_index(x2 + 1.f, min_x, cell_size, grid_w);
+        int gy0 = grid_index(y1, min_y, cell_size, grid_h);
+        int gy1 = grid_index(y2 + 1.f, min_y, cell_size, grid_h);
+
+        bool suppressed = false;
+        for (int l = 0; l < n_large; l++)
+        {
+            int k = large[l];
+            if (kcls[k] == cls && CalculateOverlap(kx1[k], ky1[k], kx2[k], ky2[k], x1, y1, x2, y2) > threshold)
+            {
+                suppressed = true;
+                break;
+            }
+        }
+        for (int gy = gy0; gy <= gy1 && !suppressed; gy++)
+        {
+            for (int gx = gx0; gx <= gx1 && !suppressed; gx++)
+            {
+                for (int node = cell_head[gy * grid_w + gx]; node != -1; node = node_next[node])
+                {
+                    int k = node_kept[node];
+                    if (stamp[k] == serial)
+                        continue;
+                    stamp[k] = serial;
+                    if (kcls[k] != cls)
+                        continue;
+                    if (CalculateOverlap(kx1[k], ky1[k], kx2[k], ky2[k], x1, y1, x2, y2) > threshold)
+                    {
+                        suppressed = true;
+                        break;
+                    }
+                }
+            }
+        }
+        serial++;
+        if (suppressed)
+            continue;
+
+        kx1[n_keep] = x1;
+        ky1[n_keep] = y1;
+        kx2[n_keep] = x2;
+        ky2[n_keep] = y2;
+        kcls[n_keep] = cls;
+        keep[n_keep] = n;
+        // 登记到覆盖的所有格子
+        if ((gx1 - gx0 + 1) * (gy1 - gy0 + 1) > NMS_GRID_MAX_CELLS_PER_BOX)
+        {
+            large[n_large++] = n_keep;
+        }
+        else
+        {
+            for (int gy = gy0; gy <= gy1; gy++)
+            {
+                for (int gx = gx0; gx <= gx1; gx++)
+                {
+                    int c = gy * grid_w + gx;
+                    node_kept[n_node] = n_keep;
+                    node_next[n_node] = cell_head[c];
+                    cell_head[c] = n_node++;
+                }
+            }
+        }
+        n_keep++;
+    }
+    return n_keep;
+}
+
+int nms_run(int mode, int count, const float *boxes, const float *scores, const int *class_ids, float threshold,
+            int max_keep, int *keep, float cell_size, NmsScratch &scratch)
+{
+    switch (mode)
+    {
+    case NMS_MODE::NMS_GRID:
+        return nms_topk_grid(count, boxes, scores, class_ids, threshold, max_keep, keep, cell_size, scratch);
+    case NMS_MODE::NMS_GREEDY:
+        return nms_topk(count, boxes, scores, class_ids, threshold, max_keep, keep, scratch);
+    case NMS_MODE::NMS_AUTO:
+    default:
+        // 候选少时网格的建立开销大于收益，直接使用贪心版本
+        if (count >= NMS_GRID_MIN_CANDIDATES)
+            return nms_topk_grid(count, boxes, scores, class_ids, threshold, max_keep, keep, cell_size, scratch);
+        return nms_topk(count, boxes, scores, class_ids, threshold, max_keep, keep, scratch);
+    }
+}
@@ -9,8 +9,10 @@
  */
 #include <iostream>
 #include <cstdlib>
+#include <cstdio>
 #include <getopt.h>
 #include <fstream>
+#include <algorithm>
 
 #include "parse_config.hpp"
 
@@ -40,6 +42,35 @@ void ConfigParser::print_help(const string &program_name) const { // 常量成
     cout << "  -c, --opencl <bool or int> || Configure the opencl mode. true(1):use opencl, fals(0):use cpu. default: True(1)" << endl;
     cout << "  -d, --decodec <string> || Set decoder. default: h264_rkmpp (option: h264)" << endl;
     cout << "  -r, --read_engine <int or string> || Set input sources read engine. default: 1:ffmpeg (option: 2:opencv)" << endl;
+    cout << "  -n, --nms <int or string> || Set NMS mode. default: 0:auto (option: 1:greedy, 2:grid)" << endl;
+    cout << "  -o, --output <int or string> || Set output mode. default: 0:nchw (option: 1:native)" << endl;
+    cout << "  -k, --core_mode <int or string> || Set NPU core mapping. default: 0:throughput (option: 1:latency, 2:mixed)" << endl;
+    cout << "  -H, --urgent <bool or int> || Latency-critical stream: with -k mixed its frames use the context reserved on cores 0 and 1. default: False(0)" << endl;
+    cout << "  -b, --dispatch <int or string> || Set frame dispatch policy. default: 1:load (option: 0:rr). async mode always uses rr" << endl;
+    cout << "  -z, --zero_copy <bool or int> || Configure the zero-copy input. true(1):rknn_create_mem, false(0):rknn_inputs_set. default: True(1)" << endl;
+    cout << "  -M, --model_zero_copy <bool or int> || Init the first context from an NPU buffer with RKNN_FLAG_MODEL_BUFFER_ZERO_COPY. default: False(0)" << endl;
+    cout << "  -A, --async <bool or int> || Configure the async inference (double buffered per context, results delayed one frame). default: False(0)" << endl;
+    cout << "  -D, --dynamic_shape <bool or int> || Pick the input shape of a dynamic-shape model from the source aspect ratio. default: True(1)" << endl;
+    cout << "  -W, --warmup <int> || Warmup runs per context on a synthetic input before the first frame. default: 0" << endl;
+    cout << "  -T, --tiles <string> || Tiled inference: auto (model-sized tiles) or <cols>x<rows>, like 3x2. default: off" << endl;
+    cout << "  -V, --tile_overlap <float> || Overlap of adjacent tiles as a fraction of the tile size. default: 0.2" << endl;
+    cout << "  -F, --tile_full <bool or int> || Add a downscaled full-frame pass to the tiles. default: True(1)" << endl;
+    cout << "  -G, --gate <string> || Motion gate: N[,pixel,area,scene]. Skip static frames and reuse the last result, infer at least every N frames. default: 0 (off), 12, 0.002, 35" << endl;
+    cout << "  -K, --keyframe <string> || Keyframe detection: N[,motion,conf]. Detect on keyframes only and propagate boxes by optical flow in between, the interval adapts up to N frames. default: 0 (off), 8, 0.3" << endl;
+    cout << "  -S, --track <int or string> || Multi-object tracker assigning stable IDs. default: 0:off (option: 1:greedy, 2:hungarian)" << endl;
+    cout << "  -Y, --track_buffer <int> || Frames a lost track is kept before its ID is dropped. default: 30" << endl;
+    cout << "  -E, --cls_model <string> || Secondary classifier rknn model run on batched crops of the detections. default: none" << endl;
+    cout << "  -J, --cls_classes <string> || Comma-separated detector classes to classify. default: all" << endl;
+    cout << "  -Q, --cls_max_crops <int> || Maximum crops classified per frame, other tracked boxes reuse their last result. default: 16" << endl;
+    cout << "  -B, --backend <int or string> || Set inference backend. default: 0:rknn (option: 1:cpu (-m is an ONNX model), 2:replay (-m is a recording directory))" << endl;
+    cout << "  -U, --cpu_contexts <int> || Extra CPU backend contexts next to the NPU ones, fed when the NPU contexts are busy. default: 0" << endl;
+    cout << "  -X, --cpu_model <string> || ONNX model for the CPU contexts" << endl;
+    cout << "  -R, --record <string> || Record output tensors into a directory for the replay backend" << endl;
+    cout << "  -L, --replay_latency <float> || Simulated inference time per frame of the replay backend in ms. default: 0" << endl;
+    cout << "  -P, --profile <int> || Profile N frames per layer with RKNN_QUERY_PERF_DETAIL, write CSV/JSON and exit" << endl;
+    cout << "  -O, --profile_out <string> || Profile output path without extension. default: profile" << endl;
+    cout << "  -C, --compare <string> || Compare two profile CSVs (base.csv,test.csv) and exit" << endl;
+    cout << "  -l, --logits || Model head outputs raw logits, apply sigmoid in postprocess" << endl;
     cout << "  -s, --screen_fps || Show fps on screen" << endl;
     cout << "  -p, --print_fps || Print fps on console" << endl;
     cout << "  -v, --verbose || Enable verbose output" << endl;
@@ -58,10 +89,62 @@ void ConfigParser::printConfig(const AppConfig &config) const {
     cout << "    Model path: " << config.model_path << endl;
     cout << "    Input source: " << config.input << endl;
     cout << "    Threads: " << config.threads << endl;
+    cout << "    Warmup: " << config.warmup << endl;
+    cout << "    Backend: " << backend_name(config.backend) << endl;
+    if (config.gate_interval > 0)
+        cout << "    Motion gate: every " << config.gate_interval << " frames, pixel " << config.gate_pixel << ", area "
+             << config.gate_area << ", scene " << config.gate_scene << endl;
+    if (config.keyframe_interval > 0)
+        cout << "    Keyframe: up to every " << config.keyframe_interval << " frames, motion " << config.keyframe_motion
+             << ", conf " << config.keyframe_conf << endl;
+    if (config.track != TRACK_MODE::TRACK_OFF)
+        cout << "    Tracker: " << (config.track == TRACK_MODE::TRACK_HUNGARIAN ? "hungarian" : "greedy") << ", buffer "
+             << config.track_buffer << " frames" << endl;
+    if (!config.cls_model.empty())
+        cout << "    Classifier: " << config.cls_model << ", classes "
+             << (config.cls_classes.empty() ? "all" : config.cls_classes) << ", max " << config.cls_max_crops
+             << " crops per frame" << endl;
+    if (config.tiling) {
+        cout << "    Tiles: ";
+        if (config.tile_cols > 0)
+            cout << config.tile_cols << "x" << config.tile_rows;
+        else
+            cout << "auto";
+        cout << ", overlap " << config.tile_overlap << ", full frame " << boolalpha << config.tile_full << endl;
+    }
+    if (config.cpu_contexts > 0)
+        cout << "    CPU contexts: " << config.cpu_contexts << " (" << config.cpu_model << ")" << endl;
+    if (!config.record_dir.empty())
+        cout << "    Record: " << config.record_dir << endl;
+    if (config.profile_frames > 0)
+        cout << "    Profile: " << config.profile_frames << " frames -> " << config.profile_out << endl;
     cout << "    Opencl: " << boolalpha << config.opencl << endl; // boolalpha: 将 bool 类型以 true/false 形式输出
     cout << "    Decodec: " << config.decodec << endl;
     cout << "    Screen fps: " << boolalpha << config.screen_fps << endl;
     cout << "    Console fps: " << boolalpha << config.print_fps << endl;
+    cout << "    Logits head: " << boolalpha << config.logits << endl;
+    cout << "    Zero copy: " << boolalpha << config.zero_copy << endl;
+    cout << "    Model zero copy: " << boolalpha << config.model_zero_copy << endl;
+    cout << "    Async: " << boolalpha << config.async << endl;
+    cout << "    Dynamic shape: " << boolalpha << config.dynamic_shape << endl;
+
+    if (config.nms_mode == NMS_MODE::NMS_AUTO)
+        cout << "    NMS mode: auto" << endl;
+    else if (config.nms_mode == NMS_MODE::NMS_GREEDY)
+        cout << "    NMS mode: greedy" << endl;
+    else if (config.nms_mode == NMS_MODE::NMS_GRID)
+        cout << "    NMS mode: grid" << endl;
+
+    cout << "    Core mode: " << core_mode_name(config.core_mode);
+    if (config.core_mode == CORE_MODE::CORE_MIXED)
+        cout << (config.urgent ? ", urgent stream" : ", normal stream");
+    cout << endl;
+    cout << "    Dispatch: " << (config.dispatch == DISPATCH_POLICY::DISPATCH_ROUND_ROBIN ? "rr" : "load") << endl;
+
+    if (config.output_mode == OUTPUT_MODE::OUT_NCHW)
+        cout << "    Output mode: nchw" << endl;
+    else if (config.output_mode == OUTPUT_MODE::OUT_NATIVE)
+        cout << "    Output mode: native" << endl;
 
     if (config.accels_2d == ACCELS_2D::ACC_OPENCV)
         cout << "    Accels_2d: opencv"<< endl;
@@ -99,6 +182,35 @@ AppConfig ConfigParser::parse_arguments(int argc, char *argv[]) const {
         {"opencl",     optional_argument, nullptr, 'c'},
         {"decodec",    optional_argument, nullptr, 'd'},
         {"read_engine",optional_argument, nullptr, 'r'},
+        {"nms",        optional_argument, nullptr, 'n'},
+        {"output",     optional_argument, nullptr, 'o'},
+        {"core_mode",  optional_argument, nullptr, 'k'},
+        {"urgent",     optional_argument, nullptr, 'H'},
+        {"dispatch",   optional_argument, nullptr, 'b'},
+        {"zero_copy",  optional_argument, nullptr, 'z'},
+        {"async",      optional_argument, nullptr, 'A'},
+        {"model_zero_copy", optional_argument, nullptr, 'M'},
+        {"dynamic_shape", optional_argument, nullptr, 'D'},
+        {"warmup",     optional_argument, nullptr, 'W'},
+        {"tiles",      optional_argument, nullptr, 'T'},
+        {"tile_overlap", optional_argument, nullptr, 'V'},
+        {"tile_full",  optional_argument, nullptr, 'F'},
+        {"gate",       optional_argument, nullptr, 'G'},
+        {"keyframe",   optional_argument, nullptr, 'K'},
+        {"track",      optional_argument, nullptr, 'S'},
+        {"track_buffer", optional_argument, nullptr, 'Y'},
+        {"cls_model",  optional_argument, nullptr, 'E'},
+        {"cls_classes", optional_argument, nullptr, 'J'},
+        {"cls_max_crops", optional_argument, nullptr, 'Q'},
+        {"backend",    optional_argument, nullptr, 'B'},
+        {"cpu_contexts", optional_argument, nullptr, 'U'},
+        {"cpu_model",  optional_argument, nullptr, 'X'},
+        {"record",     optional_argument, nullptr, 'R'},
+        {"replay_latency", optional_argument, nullptr, 'L'},
+        {"profile",    optional_argument, nullptr, 'P'},
+        {"profile_out",optional_argument, nullptr, 'O'},
+        {"compare",    optional_argument, nullptr, 'C'},
+        {"logits",     no_argument,       nullptr, 'l'},
         {"screen_fps",   no_argument,       nullptr, 's'},
         {"print_fps",  no_argument,       nullptr, 'p'},
         {"verbose",    no_argument,       nullptr, 'v'},
@@ -111,7 +223,7 @@ AppConfig ConfigParser::parse_arguments(int argc, char *argv[]) const {
     // 支持短选项和长选项
     // : 表示该选项需要一个参数，v 和 h 不需要
     // 如果解析到长选项，返回 val 字段的值（即第四列）
-    while ((opt = getopt_long(argc, argv, "m:i:a:t:c:d:r:spvh", long_options, nullptr)) != -1) {
+    while ((opt = getopt_long(argc, argv, "m:i:a:t:c:d:r:n:o:k:b:z:A:M:D:W:T:V:F:G:K:S:Y:E:J:Q:B:U:X:R:L:P:O:C:H:lspvh", long_options, nullptr)) != -1) {
         string temp_optarg = "";
         // 拷贝防止被修改
         if (optarg)
@@ -208,6 +320,308 @@ AppConfig ConfigParser::parse_arguments(int argc, char *argv[]) const {
                 }
                 break;
             }
+            case 'n': {
+                if (temp_optarg == "auto" || temp_optarg == "0")
+                    config.nms_mode = NMS_MODE::NMS_AUTO;
+                else if (temp_optarg == "greedy" || temp_optarg == "1")
+                    config.nms_mode = NMS_MODE::NMS_GREEDY;
+                else if (temp_optarg == "grid" || temp_optarg == "2")
+                    config.nms_mode = NMS_MODE::NMS_GRID;
+                else {
+                    cerr << "Error: Unsupported NMS mode." << endl;
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            }
+            case 'o': {
+                if (temp_optarg == "nchw" || temp_optarg == "0")
+                    config.output_mode = OUTPUT_MODE::OUT_NCHW;
+                else if (temp_optarg == "native" || temp_optarg == "1")
+                    config.output_mode = OUTPUT_MODE::OUT_NATIVE;
+                else {
+                    cerr << "Error: Unsupported output mode." << endl;
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            }
+            case 'k': {
+                if (temp_optarg == "throughput" || temp_optarg == "0")
+                    config.core_mode = CORE_MODE::CORE_THROUGHPUT;
+                else if (temp_optarg == "latency" || temp_optarg == "1")
+                    config.core_mode = CORE_MODE::CORE_LATENCY;
+                else if (temp_optarg == "mixed" || temp_optarg == "2")
+                    config.core_mode = CORE_MODE::CORE_MIXED;
+                else {
+                    cerr << "Error: Unsupported core mode." << endl;
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            }
+            case 'b': {
+                if (temp_optarg == "rr" || temp_optarg == "0")
+                    config.dispatch = DISPATCH_POLICY::DISPATCH_ROUND_ROBIN;
+                else if (temp_optarg == "load" || temp_optarg == "1")
+                    config.dispatch = DISPATCH_POLICY::DISPATCH_LEAST_LOADED;
+                else {
+                    cerr << "Error: Unsupported dispatch policy." << endl;
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            }
+            case 'z': {
+                if (temp_optarg == "true" || temp_optarg == "1")
+                    config.zero_copy = true;
+                else if (temp_optarg == "false" || temp_optarg == "0") 
+                    config.zero_copy = false;
+                else {
+                    cerr << "Error: Invalid argument for option: " << static_cast<char>(opt) << endl;
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            }
+            case 'A': {
+                if (temp_optarg == "true" || temp_optarg == "1")
+                    config.async = true;
+                else if (temp_optarg == "false" || temp_optarg == "0")
+                    config.async = false;
+                else {
+                    cerr << "Error: Invalid argument for option: " << static_cast<char>(opt) << endl;
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            }
+            case 'M': {
+                if (temp_optarg == "true" || temp_optarg == "1")
+                    config.model_zero_copy = true;
+                else if (temp_optarg == "false" || temp_optarg == "0")
+                    config.model_zero_copy = false;
+                else {
+                    cerr << "Error: Invalid argument for option: " << static_cast<char>(opt) << endl;
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            }
+            case 'D': {
+                if (temp_optarg == "true" || temp_optarg == "1")
+                    config.dynamic_shape = true;
+                else if (temp_optarg == "false" || temp_optarg == "0")
+                    config.dynamic_shape = false;
+                else {
+                    cerr << "Error: Invalid argument for option: " << static_cast<char>(opt) << endl;
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            }
+            case 'W': {
+                if (!optarg) {
+                    cerr << "Error: Missing argument for option: " << static_cast<char>(opt) << endl;
+                    exit(EXIT_FAILURE);
+                }
+                config.warmup = max(0, stoi(temp_optarg));
+                break;
+            }
+            case 'T': {
+                int cols = 0, rows = 0;
+                if (temp_optarg == "off" || temp_optarg == "0") {
+                    config.tiling = false;
+                }
+                else if (temp_optarg == "auto") {
+                    config.tiling = true;
+                    config.tile_cols = config.tile_rows = 0;
+                }
+                else if (sscanf(temp_optarg.c_str(), "%dx%d", &cols, &rows) == 2 && cols > 0 && rows > 0) {
+                    config.tiling = true;
+                    config.tile_cols = cols;
+                    config.tile_rows = rows;
+                }
+                else {
+                    cerr << "Error: Invalid tile layout, use auto or <cols>x<rows>." << endl;
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            }
+            case 'V': {
+                if (!optarg) {
+                    cerr << "Error: Missing argument for option: " << static_cast<char>(opt) << endl;
+                    exit(EXIT_FAILURE);
+                }
+                config.tile_overlap = min(0.9f, max(0.f, stof(temp_optarg)));
+                break;
+            }
+            case 'H': {
+                if (temp_optarg == "true" || temp_optarg == "1")
+                    config.urgent = true;
+                else if (temp_optarg == "false" || temp_optarg == "0")
+                    config.urgent = false;
+                else {
+                    cerr << "Error: Invalid argument for option: " << static_cast<char>(opt) << endl;
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            }
+            case 'F': {
+                if (temp_optarg == "true" || temp_optarg == "1")
+                    config.tile_full = true;
+                else if (temp_optarg == "false" || temp_optarg == "0")
+                    config.tile_full = false;
+                else {
+                    cerr << "Error: Invalid argument for option: " << static_cast<char>(opt) << endl;
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            }
+            case 'G': {
+                // N 或 N,pixel,area,scene，省略的阈值保持默认
+                int interval = 0, pixel = config.gate_pixel;
+                float area = config.gate_area, scene = config.gate_scene;
+                if (sscanf(temp_optarg.c_str(), "%d,%d,%f,%f", &interval, &pixel, &area, &scene) < 1 || interval < 0) {
+                    cerr << "Error: Invalid motion gate, use N[,pixel,area,scene]." << endl;
+                    exit(EXIT_FAILURE);
+                }
+                config.gate_interval = interval;
+                config.gate_pixel = pixel;
+                config.gate_area = area;
+                config.gate_scene = scene;
+                break;
+            }
+            case 'K': {
+                // N 或 N,motion,conf，省略的阈值保持默认
+                int interval = 0;
+                float motion = config.keyframe_motion, conf = config.keyframe_conf;
+                if (sscanf(temp_optarg.c_str(), "%d,%f,%f", &interval, &motion, &conf) < 1 || interval < 0) {
+                    cerr << "Error: Invalid keyframe interval, use N[,motion,conf]." << endl;
+                    exit(EXIT_FAILURE);
+                }
+                config.keyframe_interval = interval;
+                config.keyframe_motion = motion;
+                config.keyframe_conf = conf;
+                break;
+            }
+            case 'S': {
+                if (temp_optarg == "off" || temp_optarg == "0")
+                    config.track = TRACK_MODE::TRACK_OFF;
+                else if (temp_optarg == "greedy" || temp_optarg == "1")
+                    config.track = TRACK_MODE::TRACK_GREEDY;
+                else if (temp_optarg == "hungarian" || temp_optarg == "2")
+                    config.track = TRACK_MODE::TRACK_HUNGARIAN;
+                else {
+                    cerr << "Error: Unsupported tracker." << endl;
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            }
+            case 'Y': {
+                if (!optarg) {
+                    cerr << "Error: Missing argument for option: " << static_cast<char>(opt) << endl;
+                    exit(EXIT_FAILURE);
+                }
+                config.track_buffer = max(1, stoi(temp_optarg));
+                break;
+            }
+            case 'E': {
+                if (!optarg) {
+                    cerr << "Error: Missing argument for option: " << static_cast<char>(opt) << endl;
+                    exit(EXIT_FAILURE);
+                }
+                if (!isFileExists(temp_optarg)) {
+                    cerr << "Error: File not found: " << temp_optarg << endl;
+                    exit(EXIT_FAILURE);
+                }
+                config.cls_model = temp_optarg;
+                break;
+            }
+            case 'J': {
+                if (!optarg) {
+                    cerr << "Error: Missing argument for option: " << static_cast<char>(opt) << endl;
+                    exit(EXIT_FAILURE);
+                }
+                config.cls_classes = temp_optarg;
+                break;
+            }
+            case 'Q': {
+                if (!optarg) {
+                    cerr << "Error: Missing argument for option: " << static_cast<char>(opt) << endl;
+                    exit(EXIT_FAILURE);
+                }
+                config.cls_max_crops = max(1, stoi(temp_optarg));
+                break;
+            }
+            case 'B': {
+                if (temp_optarg == "rknn" || temp_optarg == "0")
+                    config.backend = BACKEND_TYPE::BACKEND_RKNN;
+                else if (temp_optarg == "cpu" || temp_optarg == "1")
+                    config.backend = BACKEND_TYPE::BACKEND_CPU;
+                else if (temp_optarg == "replay" || temp_optarg == "2")
+                    config.backend = BACKEND_TYPE::BACKEND_REPLAY;
+                else {
+                    cerr << "Error: Unsupported backend." << endl;
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            }
+            case 'U': {
+                if (!optarg) {
+                    cerr << "Error: Missing argument for option: " << static_cast<char>(opt) << endl;
+                    exit(EXIT_FAILURE);
+                }
+                config.cpu_contexts = max(0, stoi(temp_optarg));
+                break;
+            }
+            case 'X': {
+                if (!optarg) {
+                    cerr << "Error: Missing argument for option: " << static_cast<char>(opt) << endl;
+                    exit(EXIT_FAILURE);
+                }
+                if (!isFileExists(temp_optarg)) {
+                    cerr << "Error: File not found: " << temp_optarg << endl;
+                    exit(EXIT_FAILURE);
+                }
+                config.cpu_model = temp_optarg;
+                break;
+            }
+            case 'R': {
+                if (!optarg) {
+                    cerr << "Error: Missing argument for option: " << static_cast<char>(opt) << endl;
+                    exit(EXIT_FAILURE);
+                }
+                config.record_dir = temp_optarg;
+                break;
+            }
+            case 'L': {
+                if (!optarg) {
+                    cerr << "Error: Missing argument for option: " << static_cast<char>(opt) << endl;
+                    exit(EXIT_FAILURE);
+                }
+                config.replay_latency = max(0.0, stod(temp_optarg));
+                break;
+            }
+            case 'P': {
+                if (!optarg) {
+                    cerr << "Error: Missing argument for option: " << static_cast<char>(opt) << endl;
+                    exit(EXIT_FAILURE);
+                }
+                config.profile_frames = max(0, stoi(temp_optarg));
+                break;
+            }
+            case 'O': {
+                if (!optarg) {
+                    cerr << "Error: Missing argument for option: " << static_cast<char>(opt) << endl;
+                    exit(EXIT_FAILURE);
+                }
+                config.profile_out = temp_optarg;
+                break;
+            }
+            case 'C': {
+                if (!optarg) {
+                    cerr << "Error: Missing argument for option: " << static_cast<char>(opt) << endl;
+                    exit(EXIT_FAILURE);
+                }
+                config.compare = temp_optarg;
+                break;
+            }
+            case 'l':
+                config.logits = true;
+                break;
             case 's':
                 config.screen_fps = true;
                 break;
@@ -225,6 +639,39 @@ AppConfig ConfigParser::parse_arguments(int argc, char *argv[]) const {
                 exit(EXIT_FAILURE);
         }
     }
+    if (config.cpu_contexts > 0 && config.cpu_model.empty()) {
+        cerr << "Error: --cpu_contexts needs --cpu_model." << endl;
+        exit(EXIT_FAILURE);
+    }
+    // 分块推理的每一块都要在合并前取回结果，各块本身已分散到多个上下文并行
+    if (config.tiling && config.async) {
+        cout << "Tiled inference runs synchronously, async is ignored." << endl;
+        config.async = false;
+    }
+    // 跳过的帧沿用上一帧的检测结果，需要同步取得
+    if (config.gate_interval > 0 && config.async) {
+        cout << "Motion gate runs synchronously, async is ignored." << endl;
+        config.async = false;
+    }
+    // 中间帧按顺序从上一帧的结果传播
+    if (config.keyframe_interval > 0 && config.async) {
+        cout << "Keyframe detection runs synchronously, async is ignored." << endl;
+        config.async = false;
+    }
+    // 跟踪按帧顺序进行
+    if (config.track != TRACK_MODE::TRACK_OFF && config.async) {
+        cout << "Tracking runs synchronously, async is ignored." << endl;
+        config.async = false;
+    }
+    // 二级分类在合并线程中按帧顺序进行，分类模型只能在 NPU 上运行
+    if (!config.cls_model.empty() && config.backend != BACKEND_TYPE::BACKEND_RKNN) {
+        cerr << "Error: --cls_model needs the rknn backend." << endl;
+        exit(EXIT_FAILURE);
+    }
+    if (!config.cls_model.empty() && config.async) {
+        cout << "Secondary classification runs synchronously, async is ignored." << endl;
+        config.async = false;
+    }
     if (config.verbose)
         this->printConfig(config);
 
@@ -13,6 +13,9 @@
 // limitations under the License.
 
 #include "postprocess.h"
+#include "postprocess_simd.h"
+#include "head_decoder.h"
+#include "nms.h"
 
 #include <math.h>
 #include <stdint.h>
@@ -21,18 +24,19 @@
 #include <string.h>
 #include <sys/time.h>
 
-#include <set>
+#include <algorithm>
 #include <vector>
 #include <string>
 #include <fstream>
 #include <iostream>
-#define LABEL_NALE_TXT_PATH "./model/coco_80_labels_list.txt"
+#include <sstream>
 
 // static char *labels[OBJ_CLASS_NUM];
 
-const int anchor0[6] = {10, 13, 16, 30, 33, 23};
-const int anchor1[6] = {30, 61, 62, 45, 59, 119};
-const int anchor2[6] = {116, 90, 156, 198, 373, 326};
+/* YOLOv5 默认 anchor，依次对应步幅 8、16、32 */
+constexpr int anchor0[6] = {10, 13, 16, 30, 33, 23};
+constexpr int anchor1[6] = {30, 61, 62, 45, 59, 119};
+constexpr int anchor2[6] = {116, 90, 156, 198, 373, 326};
 
 inline static int clamp(float val, int min, int max) { return val > min ? (val < max ? val : max) : min; }
 /*
@@ -132,303 +136,929 @@ int loadLabelName(const char *locationFilename, char *label[])
 	readLines(locationFilename, label, OBJ_CLASS_NUM);
 	return 0;
 }*/
-int loadLabelName(const std::string& locationFilename, std::vector<std::string>& labels) {
+int loadLabelName(const std::string& locationFilename, std::vector<std::string>& labels, int max_lines) {
     // std::cout << "加载标签名称 " << locationFilename << std::endl;
-    return readLines(locationFilename, labels, OBJ_CLASS_NUM);
+    return readLines(locationFilename, labels, max_lines);
+}
+
+static float sigmoid(float x) { return 1.0 / (1.0 + expf(-x)); }
+
+static float unsigmoid(float y) { return -1.0 * logf((1.0 / y) - 1.0); }
+
+inline static int32_t __clip(float val, float min, float max)
+{
+	float f = val <= min ? min : (val >= max ? max : val);
+	return f;
 }
 
 /**
- * @brief 计算两个边界框的交并比（IoU）
- * 
- * @param xmin0 第一个框的左上x坐标
- * @param ymin0 第一个框的左上y坐标
- * @param xmax0 第一个框的右下x坐标
- * @param ymax0 第一个框的右下y坐标
- * @param xmin1 第二个框的左上x坐标
- * @param ymin1 第二个框的左上y坐标
- * @param xmax1 第二个框的右下x坐标
- * @param ymax1 第二个框的右下y坐标
- * @return float IoU值
+ * @Description: 在量化和反量化之间转换浮点数和定点数，这在嵌入式系统中很常见，以减少计算和存储开销
+ * @param {float} f32:
+ * @param {int32_t} zp:
+ * @param {float} scale:
+ * @return {*}
  */
-static float CalculateOverlap(float xmin0, float ymin0, float xmax0, float ymax0, float xmin1, float ymin1, float xmax1,
-							  float ymax1)
+static int8_t qnt_f32_to_affine(float f32, int32_t zp, float scale)
 {
-	float w = fmax(0.f, fmin(xmax0, xmax1) - fmax(xmin0, xmin1) + 1.0);
-	float h = fmax(0.f, fmin(ymax0, ymax1) - fmax(ymin0, ymin1) + 1.0);
-	float i = w * h;
-	float u = (xmax0 - xmin0 + 1.0) * (ymax0 - ymin0 + 1.0) + (xmax1 - xmin1 + 1.0) * (ymax1 - ymin1 + 1.0) - i;
-	return u <= 0.f ? 0.f : (i / u);
+	float dst_val = (f32 / scale) + zp;
+	int8_t res = (int8_t)__clip(dst_val, -128, 127);
+	return res;
 }
 
+static float deqnt_affine_to_f32(int8_t qnt, int32_t zp, float scale) { return ((float)qnt - (float)zp) * scale; }
+
 /**
- * @Description: 非极大值抑制，用于去除重叠的检测框。它保留IoU低于阈值的框，从而确保每个对象只有一个最优的检测框
- * 				可以通过使用 OpenCL 进行优化
+ * @Description: 为一个输出张量构建 256 项查找表，替代逐 cell 的反量化、sigmoid 和坐标变换
+ *               表项的计算表达式与原先逐 cell 计算完全相同，结果逐位一致
+ * @param {qnt_lut_t} *lut: 输出的查找表
+ * @param {int32_t} zp: 量化零点
+ * @param {float} scale: 量化比例
+ * @param {bool} apply_sigmoid: 输出为原始 logits 时需要先做 sigmoid
  * @return {*}
  */
-static int nms(int validCount, std::vector<float> &outputLocations, std::vector<int> classIds, std::vector<int> &order,
-			   int filterId, float threshold)
+void build_qnt_lut(qnt_lut_t *lut, int32_t zp, float scale, bool apply_sigmoid)
 {
-	for (int i = 0; i < validCount; ++i)
+	lut->zp = zp;
+	lut->scale = scale;
+	lut->sigmoid = apply_sigmoid;
+	for (int q = -128; q <= 127; q++)
 	{
-		if (order[i] == -1 || classIds[i] != filterId)
+		float v = deqnt_affine_to_f32((int8_t)q, zp, scale);
+		if (apply_sigmoid)
+			v = sigmoid(v);
+		float v2 = v * 2.0;
+		lut->deq[q + 128] = v;
+		lut->xy[q + 128] = v * 2.0 - 0.5;
+		lut->wh[q + 128] = v2 * v2;
+	}
+	build_dfl_exp_lut(lut->dfl_exp, scale);
+}
+
+/**
+ * @Description: 将置信度阈值转换为 int8 量化域，sigmoid 模式下先映射回 logit 域
+ * @return {*}
+ */
+static int8_t qnt_threshold(float threshold, const qnt_lut_t &lut)
+{
+	if (lut.sigmoid)
+		return qnt_f32_to_affine(unsigmoid(threshold), lut.zp, lut.scale);
+	return qnt_f32_to_affine(threshold, lut.zp, lut.scale);
+}
+
+/************************************** 分支几何参数 *******************************************/
+/* 运行时的分支几何参数，用于没有特化的模型尺寸 */
+struct DynamicGeometry
+{
+	int gh, gw, st, nc, reg;
+	const int *anc; // 本分支 3 组 anchor (w, h)，anchor-free 时为空
+
+	int grid_h() const { return gh; }
+	int grid_w() const { return gw; }
+	int stride() const { return st; }
+	int num_class() const { return nc; }
+	int reg_max() const { return reg; }
+	int anchor(int k) const { return anc[k]; }
+};
+
+/* 编译期的分支几何参数：网格、步幅、类别数和 anchor 均为常量，
+ * 解码循环中的除法、取模和平面偏移在编译时折叠为常数 */
+template <int GRID_H, int GRID_W, int STRIDE, int NUM_CLASS, int REG_MAX, const int *ANCHOR>
+struct StaticGeometry
+{
+	static constexpr int grid_h() { return GRID_H; }
+	static constexpr int grid_w() { return GRID_W; }
+	static constexpr int stride() { return STRIDE; }
+	static constexpr int num_class() { return NUM_CLASS; }
+	static constexpr int reg_max() { return REG_MAX; }
+	static constexpr int anchor(int k) { return ANCHOR[k]; }
+};
+
+/**
+ * @Description: 解码一个步幅的输出。分两遍进行：
+ *               第一遍对三个 anchor 的置信度平面做批量阈值比较，得到紧凑的存活 (anchor, cell) 列表；
+ *               第二遍只对存活的 cell 做框解码和类别 argmax，计算量随检测数量而不是网格大小增长
+ * @param {Geometry} &geom: 分支几何参数（DynamicGeometry 或 StaticGeometry），每个 anchor 占 5 + 类别数 个通道
+ * @param {PostprocessWorkspace} *ws: 工作区，结果从第 offset 个候选开始写入
+ * @return {int}: 有效框数量
+ */
+template <typename Geometry>
+static int process(int8_t *input, const Geometry &geom, PostprocessWorkspace *ws, int offset, float threshold,
+				   const qnt_lut_t &lut)
+{
+	const int grid_h = geom.grid_h();
+	const int grid_w = geom.grid_w();
+	const int stride = geom.stride();
+	const int num_class = geom.num_class();
+	int validCount = 0;
+	int32_t *survivors = ws->survivors.data();
+	float *boxes = ws->boxes.data() + offset * 4;
+	float *objProbs = ws->probs.data() + offset;
+	int *classId = ws->class_ids.data() + offset;
+	const int grid_len = grid_h * grid_w;
+	const int prop_box_size = 5 + num_class;
+	int8_t thres_i8 = qnt_threshold(threshold, lut);
+
+	// 第一遍：置信度预筛选，下标编码为 a * grid_len + cell，天然按 (a, i, j) 升序
+	int n_survivor = 0;
+	for (int a = 0; a < 3; a++)
+	{
+		n_survivor += objectness_filter_i8(input + (prop_box_size * a + 4) * grid_len, grid_len, thres_i8,
+										   a * grid_len, survivors + n_survivor);
+	}
+
+	// 第二遍：只解码存活的 cell。类别 argmax 以 ARGMAX_BLOCK 为单位计算并缓存，
+	// 同一 block 内的多个存活 cell 共用一次向量化扫描
+	int8_t block_prob[ARGMAX_BLOCK];
+	uint8_t block_id[ARGMAX_BLOCK];
+	int cached_block = -1;
+	for (int s = 0; s < n_survivor; s++)
+	{
+		int a = survivors[s] / grid_len;
+		int cell = survivors[s] % grid_len;
+		// 每个 anchor 平面从 block 边界开始，保证 block 不跨 anchor
+		int block_base = (cell / ARGMAX_BLOCK) * ARGMAX_BLOCK;
+		int block = a * ((grid_len + ARGMAX_BLOCK - 1) / ARGMAX_BLOCK) + cell / ARGMAX_BLOCK;
+		if (block != cached_block)
 		{
-			continue;
+			int count = grid_len - block_base < ARGMAX_BLOCK ? grid_len - block_base : ARGMAX_BLOCK;
+			class_argmax_i8(input + (prop_box_size * a + 5) * grid_len + block_base, num_class, grid_len, count,
+							block_prob, block_id);
+			cached_block = block;
 		}
-		int n = order[i];
-		// 对于每个检测框，计算其与同类别其他检测框的IoU
-		for (int j = i + 1; j < validCount; ++j)
+
+		int i = cell / grid_w;
+		int j = cell % grid_w;
+		int8_t *in_ptr = input + (prop_box_size * a) * grid_len + cell;
+		int8_t box_confidence = in_ptr[4 * grid_len];
+		int8_t maxClassProbs = block_prob[cell - block_base];
+		int maxClassId = block_id[cell - block_base];
+		if (maxClassProbs <= thres_i8)
 		{
-			int m = order[j];
-			if (m == -1 || classIds[i] != filterId)
-			{
-				continue;
-			}
-			float xmin0 = outputLocations[n * 4 + 0];
-			float ymin0 = outputLocations[n * 4 + 1];
-			float xmax0 = outputLocations[n * 4 + 0] + outputLocations[n * 4 + 2];
-			float ymax0 = outputLocations[n * 4 + 1] + outputLocations[n * 4 + 3];
+			continue;
+		}
 
-			float xmin1 = outputLocations[m * 4 + 0];
-			float ymin1 = outputLocations[m * 4 + 1];
-			float xmax1 = outputLocations[m * 4 + 0] + outputLocations[m * 4 + 2];
-			float ymax1 = outputLocations[m * 4 + 1] + outputLocations[m * 4 + 3];
+		// 查表代替反量化和坐标变换
+		float box_x = lut.xy[in_ptr[0] + 128];
+		float box_y = lut.xy[in_ptr[grid_len] + 128];
+		float box_w = lut.wh[in_ptr[2 * grid_len] + 128];
+		float box_h = lut.wh[in_ptr[3 * grid_len] + 128];
+		box_x = (box_x + j) * (float)stride;
+		box_y = (box_y + i) * (float)stride;
+		box_w = box_w * (float)geom.anchor(a * 2);
+		box_h = box_h * (float)geom.anchor(a * 2 + 1);
+		box_x -= (box_w / 2.0);
+		box_y -= (box_h / 2.0);
 
-			float iou = CalculateOverlap(xmin0, ymin0, xmax0, ymax0, xmin1, ymin1, xmax1, ymax1);
+		objProbs[validCount] = lut.deq[maxClassProbs + 128] * lut.deq[box_confidence + 128];
+		classId[validCount] = maxClassId;
+		boxes[validCount * 4 + 0] = box_x;
+		boxes[validCount * 4 + 1] = box_y;
+		boxes[validCount * 4 + 2] = box_w;
+		boxes[validCount * 4 + 3] = box_h;
+		validCount++;
+	}
+	return validCount;
+}
 
-			// 如果IoU超过阈值，则抑制（标记为无效）该检测框
-			if (iou > threshold)
-			{
-				order[j] = -1;
-			}
-		}
+/**
+ * @Description: 求 score_sum 的量化阈值：类别最大分数通过阈值的 cell，其分数和一定不小于该阈值
+ *               分数和由模型量化输出，额外留 1 个量化步长的余量，保证不会误删
+ * @param {int8_t} score_thres: 类别分支的量化阈值，通过条件为 score > score_thres
+ * @return {int8_t}: 通过条件为 score_sum >= 返回值
+ */
+static int8_t score_sum_threshold(int8_t score_thres, const qnt_lut_t &score_lut, const qnt_lut_t &sum_lut)
+{
+	if (score_thres == 127)
+		return 127;
+	// 能通过类别阈值的最小分数
+	float min_score = score_lut.deq[score_thres + 1 + 128];
+	for (int q = -128; q <= 127; q++)
+	{
+		if (sum_lut.deq[q + 128] + sum_lut.scale >= min_score)
+			return (int8_t)q;
 	}
-	return 0;
+	return 127;
 }
 
 /**
- * @Description: 对检测结果按置信度进行降序排序。这里实现的是快速排序的变体，用于逆序排列
- * @param {vector<float>} &input:
- * @param {int} left:
- * @param {int} right:
- * @param {vector<int>} &indices:
- * @return {*}
+ * @Description: 由 4 条边的距离（左、上、右、下，以步幅为单位）得到 (x, y, w, h)
+ */
+static inline void dfl_dist_to_box(const float *dist, int cell, int grid_w, int stride, float *box)
+{
+	int i = cell / grid_w;
+	int j = cell % grid_w;
+	float x1 = (j + 0.5f - dist[0]) * (float)stride;
+	float y1 = (i + 0.5f - dist[1]) * (float)stride;
+	float x2 = (j + 0.5f + dist[2]) * (float)stride;
+	float y2 = (i + 0.5f + dist[3]) * (float)stride;
+	box[0] = x1;
+	box[1] = y1;
+	box[2] = x2 - x1;
+	box[3] = y2 - y1;
+}
+
+/**
+ * @Description: 解码一个 cell 的 DFL 框并写入候选列表（NCHW 布局）
  */
-static int quick_sort_indice_inverse(std::vector<float> &input, int left, int right, std::vector<int> &indices)
+static inline void emit_dfl_box(const int8_t *box_input, int cell, int grid_len, int grid_w, int stride, int reg_max,
+								const qnt_lut_t &box_lut, float *box)
 {
-	float key;
-	int key_index;
-	int low = left;
-	int high = right;
-	if (left < right)
+	// 4 条边依次为 左、上、右、下 到 cell 中心的距离
+	float dist[4];
+	dfl_decode_i8(box_input + cell, grid_len, reg_max, box_lut.dfl_exp, dist);
+	dfl_dist_to_box(dist, cell, grid_w, stride, box);
+}
+
+/**
+ * @Description: 解码 YOLOv8 一个步幅的输出，只对超过阈值的 cell 解码 DFL 框（查表 exp 的向量化 softmax 期望，见 dfl_decode_i8）
+ *               有 score_sum 输出时先对其做向量化阈值比较，只对存活的 cell 做类别 argmax，不再读取其余 cell 的类别通道；
+ *               没有时类别分支按 ARGMAX_BLOCK 个 cell 一组做向量化 argmax
+ * @param {int8_t} *box_input: DFL 框分支，[4 * reg_max, grid_h, grid_w]
+ * @param {int8_t} *score_input: 类别分支，[num_class, grid_h, grid_w]
+ * @param {int8_t} *sum_input: score_sum 分支，[1, grid_h, grid_w]，为空时不使用
+ * @param {Geometry} &geom: 分支几何参数（DynamicGeometry 或 StaticGeometry）
+ * @param {PostprocessWorkspace} *ws: 工作区，结果从第 offset 个候选开始写入
+ * @return {int}: 有效框数量
+ */
+template <typename Geometry>
+static int process_dfl(int8_t *box_input, int8_t *score_input, int8_t *sum_input, const Geometry &geom,
+					   PostprocessWorkspace *ws, int offset, float threshold, const qnt_lut_t &box_lut,
+					   const qnt_lut_t &score_lut, const qnt_lut_t *sum_lut)
+{
+	const int grid_h = geom.grid_h();
+	const int grid_w = geom.grid_w();
+	const int stride = geom.stride();
+	const int num_class = geom.num_class();
+	const int reg_max = geom.reg_max();
+	int validCount = 0;
+	float *boxes = ws->boxes.data() + offset * 4;
+	float *objProbs = ws->probs.data() + offset;
+	int *classId = ws->class_ids.data() + offset;
+	const int grid_len = grid_h * grid_w;
+	int8_t thres_i8 = qnt_threshold(threshold, score_lut);
+
+	int8_t block_prob[ARGMAX_BLOCK];
+	uint8_t block_id[ARGMAX_BLOCK];
+	if (sum_input != nullptr)
 	{
-		key_index = indices[left];
-		key = input[left];
-		while (low < high)
+		// 第一遍：score_sum 预筛选
+		int32_t *survivors = ws->survivors.data();
+		int8_t sum_thres = score_sum_threshold(thres_i8, score_lut, *sum_lut);
+		int n_survivor = objectness_filter_i8(sum_input, grid_len, sum_thres, 0, survivors);
+
+		// 第二遍：存活的 cell 做类别 argmax，同一 block 内的多个存活 cell 共用一次向量化扫描
+		int cached_block = -1;
+		for (int s = 0; s < n_survivor; s++)
 		{
-			while (low < high && input[high] <= key)
-			{
-				high--;
-			}
-			input[low] = input[high];
-			indices[low] = indices[high];
-			while (low < high && input[low] >= key)
+			int cell = survivors[s];
+			int block_base = (cell / ARGMAX_BLOCK) * ARGMAX_BLOCK;
+			if (block_base != cached_block)
 			{
-				low++;
+				int count = grid_len - block_base < ARGMAX_BLOCK ? grid_len - block_base : ARGMAX_BLOCK;
+				class_argmax_i8(score_input + block_base, num_class, grid_len, count, block_prob, block_id);
+				cached_block = block_base;
 			}
-			input[high] = input[low];
-			indices[high] = indices[low];
+			int c = cell - block_base;
+			if (block_prob[c] <= thres_i8)
+				continue;
+
+			emit_dfl_box(box_input, cell, grid_len, grid_w, stride, reg_max, box_lut, boxes + validCount * 4);
+			objProbs[validCount] = score_lut.deq[block_prob[c] + 128];
+			classId[validCount] = block_id[c];
+			validCount++;
 		}
-		input[low] = key;
-		indices[low] = key_index;
-		quick_sort_indice_inverse(input, left, low - 1, indices);
-		quick_sort_indice_inverse(input, low + 1, right, indices);
+		return validCount;
 	}
-	return low;
-}
 
-static float sigmoid(float x) { return 1.0 / (1.0 + expf(-x)); }
+	for (int block_base = 0; block_base < grid_len; block_base += ARGMAX_BLOCK)
+	{
+		int count = grid_len - block_base < ARGMAX_BLOCK ? grid_len - block_base : ARGMAX_BLOCK;
+		class_argmax_i8(score_input + block_base, num_class, grid_len, count, block_prob, block_id);
+		for (int c = 0; c < count; c++)
+		{
+			if (block_prob[c] <= thres_i8)
+				continue;
 
-static float unsigmoid(float y) { return -1.0 * logf((1.0 / y) - 1.0); }
+			emit_dfl_box(box_input, block_base + c, grid_len, grid_w, stride, reg_max, box_lut,
+						 boxes + validCount * 4);
+			objProbs[validCount] = score_lut.deq[block_prob[c] + 128];
+			classId[validCount] = block_id[c];
+			validCount++;
+		}
+	}
+	return validCount;
+}
 
-inline static int32_t __clip(float val, float min, float max)
+/************************************** 原生布局解码 *******************************************/
+/*
+ * rknn_outputs_get 会把 NPU 的原生输出（int8 为 NC1HWC2）转换成 NCHW 并拷贝一份，
+ * 零拷贝输出直接读取原生布局：第 ch 个通道、第 cell 个 cell 位于 ((ch / c2) * grid_len + cell) * c2 + ch % c2，
+ * 同一 cell 的 c2 个通道相邻，类别 argmax 按通道方向连续读取（见 class_argmax_c2_i8）
+ * 候选框的顺序和数值与 NCHW 路径完全一致
+ */
+
+/**
+ * @Description: 原生布局中第 ch 个通道、第 cell 个 cell 的地址
+ */
+static inline const int8_t *native_at(const int8_t *input, int ch, int cell, int grid_len, int c2)
 {
-	float f = val <= min ? min : (val >= max ? max : val);
-	return f;
+	return input + ((ch / c2) * grid_len + cell) * c2 + ch % c2;
 }
 
 /**
- * @Description: 在量化和反量化之间转换浮点数和定点数，这在嵌入式系统中很常见，以减少计算和存储开销
- * @param {float} f32:
- * @param {int32_t} zp:
- * @param {float} scale:
- * @return {*}
+ * @Description: 原生布局的单通道阈值筛选，相邻 cell 间隔 c2 字节，下标按升序写入
+ * @return {int}: 存活的 cell 数量
  */
-static int8_t qnt_f32_to_affine(float f32, int32_t zp, float scale)
+static int native_filter(const int8_t *input, int ch, int grid_len, int c2, int8_t thres, int32_t base,
+						 int32_t *out_idx)
 {
-	float dst_val = (f32 / scale) + zp;
-	int8_t res = (int8_t)__clip(dst_val, -128, 127);
-	return res;
+	// NHWC/NC1HWC2 中单个通道是跨步访问，c2 = 1 时退化为连续平面
+	if (c2 == 1)
+		return objectness_filter_i8(input + ch * grid_len, grid_len, thres, base, out_idx);
+	const int8_t *p = native_at(input, ch, 0, grid_len, c2);
+	int n = 0;
+	for (int cell = 0; cell < grid_len; cell++)
+	{
+		if (p[cell * c2] >= thres)
+			out_idx[n++] = base + cell;
+	}
+	return n;
 }
 
-static float deqnt_affine_to_f32(int8_t qnt, int32_t zp, float scale) { return ((float)qnt - (float)zp) * scale; }
+/**
+ * @Description: 把一个 cell 从第 first 个通道开始的 count 个通道收集到连续缓冲区，按通道组整段拷贝
+ */
+static inline void native_gather(const int8_t *input, int first, int count, int cell, int grid_len, int c2,
+								 int8_t *dst)
+{
+	int k = 0;
+	while (k < count)
+	{
+		int ch = first + k;
+		int off = ch % c2;
+		int run = c2 - off < count - k ? c2 - off : count - k;
+		memcpy(dst + k, native_at(input, ch, cell, grid_len, c2), run);
+		k += run;
+	}
+}
 
-static int process(int8_t *input, int *anchor, int grid_h, int grid_w, int height, int width, int stride,
-				   std::vector<float> &boxes, std::vector<float> &objProbs, std::vector<int> &classId, float threshold,
-				   int32_t zp, float scale)
+/**
+ * @Description: process 的原生布局版本（YOLOv5）
+ * @param {int} c2: 通道分组大小
+ * @return {int}: 有效框数量
+ */
+static int process_native(int8_t *input, const DynamicGeometry &geom, int c2, PostprocessWorkspace *ws, int offset,
+						  float threshold, const qnt_lut_t &lut)
 {
+	const int grid_w = geom.grid_w();
+	const int stride = geom.stride();
+	const int num_class = geom.num_class();
+	const int grid_len = geom.grid_h() * grid_w;
+	const int prop_box_size = 5 + num_class;
+	const int group_stride = grid_len * c2;
 	int validCount = 0;
-	int grid_len = grid_h * grid_w;
-	int8_t thres_i8 = qnt_f32_to_affine(threshold, zp, scale);
+	int32_t *survivors = ws->survivors.data();
+	float *boxes = ws->boxes.data() + offset * 4;
+	float *objProbs = ws->probs.data() + offset;
+	int *classId = ws->class_ids.data() + offset;
+	int8_t thres_i8 = qnt_threshold(threshold, lut);
+
+	// 第一遍：置信度预筛选，顺序与 NCHW 路径相同，按 (a, i, j) 升序
+	int n_survivor = 0;
 	for (int a = 0; a < 3; a++)
 	{
-		for (int i = 0; i < grid_h; i++)
+		n_survivor += native_filter(input, prop_box_size * a + 4, grid_len, c2, thres_i8, a * grid_len,
+									survivors + n_survivor);
+	}
+
+	// 第二遍：存活 cell 的类别通道连续存放，逐 cell 做 argmax
+	for (int s = 0; s < n_survivor; s++)
+	{
+		int a = survivors[s] / grid_len;
+		int cell = survivors[s] % grid_len;
+		int ch0 = prop_box_size * a;
+		int maxClassId;
+		int8_t maxClassProbs = class_argmax_c2_i8(input + cell * c2, ch0 + 5, num_class, c2, group_stride, thres_i8,
+												  &maxClassId);
+		if (maxClassProbs <= thres_i8)
+			continue;
+
+		// 5 个框通道同样按组连续，一次收集
+		int8_t v[5];
+		native_gather(input, ch0, 5, cell, grid_len, c2, v);
+		int i = cell / grid_w;
+		int j = cell % grid_w;
+		float box_x = (lut.xy[v[0] + 128] + j) * (float)stride;
+		float box_y = (lut.xy[v[1] + 128] + i) * (float)stride;
+		float box_w = lut.wh[v[2] + 128] * (float)geom.anchor(a * 2);
+		float box_h = lut.wh[v[3] + 128] * (float)geom.anchor(a * 2 + 1);
+		box_x -= (box_w / 2.0);
+		box_y -= (box_h / 2.0);
+
+		objProbs[validCount] = lut.deq[maxClassProbs + 128] * lut.deq[v[4] + 128];
+		classId[validCount] = maxClassId;
+		boxes[validCount * 4 + 0] = box_x;
+		boxes[validCount * 4 + 1] = box_y;
+		boxes[validCount * 4 + 2] = box_w;
+		boxes[validCount * 4 + 3] = box_h;
+		validCount++;
+	}
+	return validCount;
+}
+
+/**
+ * @Description: process_dfl 的原生布局版本（YOLOv8 / YOLO11），三个分支各自的通道分组大小可以不同
+ * @param {int} *c2: 框、类别、score_sum 分支的通道分组大小
+ * @return {int}: 有效框数量
+ */
+static int process_dfl_native(int8_t *box_input, int8_t *score_input, int8_t *sum_input, const DynamicGeometry &geom,
+							  const int *c2, PostprocessWorkspace *ws, int offset, float threshold,
+							  const qnt_lut_t &box_lut, const qnt_lut_t &score_lut, const qnt_lut_t *sum_lut)
+{
+	const int grid_w = geom.grid_w();
+	const int stride = geom.stride();
+	const int num_class = geom.num_class();
+	const int reg_max = geom.reg_max();
+	const int grid_len = geom.grid_h() * grid_w;
+	int validCount = 0;
+	int32_t *survivors = ws->survivors.data();
+	float *boxes = ws->boxes.data() + offset * 4;
+	float *objProbs = ws->probs.data() + offset;
+	int *classId = ws->class_ids.data() + offset;
+	int8_t thres_i8 = qnt_threshold(threshold, score_lut);
+
+	// 有 score_sum 时先筛选，否则扫描全部 cell
+	int n_cell = grid_len;
+	if (sum_input != nullptr)
+	{
+		int8_t sum_thres = score_sum_threshold(thres_i8, score_lut, *sum_lut);
+		n_cell = native_filter(sum_input, 0, grid_len, c2[2], sum_thres, 0, survivors);
+	}
+
+	int8_t bins[4 * DFL_MAX_REG];
+	for (int s = 0; s < n_cell; s++)
+	{
+		int cell = sum_input != nullptr ? survivors[s] : s;
+		int id;
+		int8_t prob = class_argmax_c2_i8(score_input + cell * c2[1], 0, num_class, c2[1], grid_len * c2[1], thres_i8,
+										 &id);
+		if (prob <= thres_i8)
+			continue;
+
+		// DFL 的 bin 收集为连续存放，reg_max = 16 且 C2 = 16 时每条边正好是一整组
+		float dist[4];
+		native_gather(box_input, 0, 4 * reg_max, cell, grid_len, c2[0], bins);
+		dfl_decode_i8(bins, 1, reg_max, box_lut.dfl_exp, dist);
+		dfl_dist_to_box(dist, cell, grid_w, stride, boxes + validCount * 4);
+		objProbs[validCount] = score_lut.deq[prob + 128];
+		classId[validCount] = id;
+		validCount++;
+	}
+	return validCount;
+}
+
+/************************************** 特化解码内核 *******************************************/
+/**
+ * @Description: 固定输入尺寸和类别数的 YOLOv5 解码，3 个分支依次为步幅 8、16、32，使用默认 anchor
+ */
+template <int IN_H, int IN_W, int NUM_CLASS>
+static int decode_yolov5_fixed(int8_t **outputs, const qnt_lut_t *luts, float conf_threshold, PostprocessWorkspace *ws)
+{
+	int n = 0;
+	n += process(outputs[0], StaticGeometry<IN_H / 8, IN_W / 8, 8, NUM_CLASS, 0, anchor0>(), ws, n, conf_threshold,
+				 luts[0]);
+	n += process(outputs[1], StaticGeometry<IN_H / 16, IN_W / 16, 16, NUM_CLASS, 0, anchor1>(), ws, n,
+				 conf_threshold, luts[1]);
+	n += process(outputs[2], StaticGeometry<IN_H / 32, IN_W / 32, 32, NUM_CLASS, 0, anchor2>(), ws, n,
+				 conf_threshold, luts[2]);
+	return n;
+}
+
+/**
+ * @Description: YOLOv8 一个步幅分支的特化解码，PER 为每个分支的输出数（3 表示带 score_sum）
+ */
+template <int IN_H, int IN_W, int NUM_CLASS, int REG_MAX, int PER, int STRIDE, int BRANCH>
+static inline int decode_yolov8_branch(int8_t **outputs, const qnt_lut_t *luts, float conf_threshold,
+									   PostprocessWorkspace *ws, int offset)
+{
+	const int box_idx = BRANCH * PER;
+	// score_sum 是 sigmoid 后分数的和，类别分支为原始 logits 时不能用来判断
+	bool use_sum = PER == 3 && !luts[box_idx + 1].sigmoid;
+	return process_dfl(outputs[box_idx], outputs[box_idx + 1], use_sum ? outputs[box_idx + PER - 1] : nullptr,
+					   StaticGeometry<IN_H / STRIDE, IN_W / STRIDE, STRIDE, NUM_CLASS, REG_MAX, nullptr>(), ws,
+					   offset, conf_threshold, luts[box_idx], luts[box_idx + 1],
+					   use_sum ? &luts[box_idx + PER - 1] : nullptr);
+}
+
+template <int IN_H, int IN_W, int NUM_CLASS, int REG_MAX, int PER>
+static int decode_yolov8_fixed(int8_t **outputs, const qnt_lut_t *luts, float conf_threshold, PostprocessWorkspace *ws)
+{
+	int n = 0;
+	n += decode_yolov8_branch<IN_H, IN_W, NUM_CLASS, REG_MAX, PER, 8, 0>(outputs, luts, conf_threshold, ws, n);
+	n += decode_yolov8_branch<IN_H, IN_W, NUM_CLASS, REG_MAX, PER, 16, 1>(outputs, luts, conf_threshold, ws, n);
+	n += decode_yolov8_branch<IN_H, IN_W, NUM_CLASS, REG_MAX, PER, 32, 2>(outputs, luts, conf_threshold, ws, n);
+	return n;
+}
+
+/* 已特化的模型尺寸（输入高 x 输入宽，COCO 80 类），其余尺寸使用运行时参数的通用实现 */
+static const struct
+{
+	int in_h, in_w, num_class;
+	head_kernel_t kernel;
+} yolov5_kernels[] = {
+	{640, 640, 80, decode_yolov5_fixed<640, 640, 80>},
+	{384, 640, 80, decode_yolov5_fixed<384, 640, 80>},
+	{640, 384, 80, decode_yolov5_fixed<640, 384, 80>},
+	{320, 320, 80, decode_yolov5_fixed<320, 320, 80>},
+};
+
+static const struct
+{
+	int in_h, in_w, num_class, reg_max, per;
+	head_kernel_t kernel;
+} yolov8_kernels[] = {
+	{640, 640, 80, 16, 2, decode_yolov8_fixed<640, 640, 80, 16, 2>},
+	{640, 640, 80, 16, 3, decode_yolov8_fixed<640, 640, 80, 16, 3>},
+	{384, 640, 80, 16, 2, decode_yolov8_fixed<384, 640, 80, 16, 2>},
+	{384, 640, 80, 16, 3, decode_yolov8_fixed<384, 640, 80, 16, 3>},
+	{640, 384, 80, 16, 2, decode_yolov8_fixed<640, 384, 80, 16, 2>},
+	{640, 384, 80, 16, 3, decode_yolov8_fixed<640, 384, 80, 16, 3>},
+	{320, 320, 80, 16, 2, decode_yolov8_fixed<320, 320, 80, 16, 2>},
+	{320, 320, 80, 16, 3, decode_yolov8_fixed<320, 320, 80, 16, 3>},
+};
+
+/************************************** 检测头解码器 *******************************************/
+/**
+ * @Description: 分支是否为标准的步幅 8、16、32 且网格与输入尺寸一致，特化内核只处理这种布局
+ */
+static bool standard_branches(const std::vector<head_branch_t> &branches, int model_in_h, int model_in_w)
+{
+	if (branches.size() != 3)
+		return false;
+	for (int i = 0; i < 3; i++)
+	{
+		int stride = 8 << i;
+		if (branches[i].stride != stride || branches[i].grid_h * stride != model_in_h ||
+			branches[i].grid_w * stride != model_in_w)
+			return false;
+	}
+	return true;
+}
+
+void HeadDecoder::set_layout(const std::vector<head_tensor_t> &tensors)
+{
+	channel_groups.clear();
+	native = false;
+	for (const auto &t : tensors)
+	{
+		channel_groups.push_back(t.c2 > 0 ? t.c2 : 1);
+		if (t.c2 > 1)
+			native = true;
+	}
+	// 特化内核按 NCHW 布局展开，原生布局使用通用实现
+	if (native)
+		fixed_kernel = nullptr;
+}
+
+float HeadDecoder::nms_cell_size() const
+{
+	int stride = 0;
+	for (const auto &b : branches)
+		stride = std::max(stride, b.stride);
+	return (float)stride;
+}
+
+/**
+ * @Description: 由输出网格推算步幅
+ */
+static head_branch_t make_branch(const head_tensor_t &t, int model_in_h)
+{
+	head_branch_t b;
+	b.grid_h = t.h;
+	b.grid_w = t.w;
+	b.stride = t.h > 0 ? model_in_h / t.h : 0;
+	return b;
+}
+
+Yolov5Decoder::Yolov5Decoder(const std::vector<head_tensor_t> &tensors, int model_in_h, int model_in_w,
+							 const std::vector<int> &anchors, bool logits)
+{
+	this->model_in_h = model_in_h;
+	this->model_in_w = model_in_w;
+	num_class = tensors[0].c / 3 - 5;
+	luts.resize(tensors.size());
+	for (size_t i = 0; i < tensors.size(); i++)
+	{
+		branches.push_back(make_branch(tensors[i], model_in_h));
+		build_qnt_lut(&luts[i], tensors[i].zp, tensors[i].scale, logits);
+		// 每个 cell 的每个 anchor 最多产生一个候选框
+		candidates += 3 * tensors[i].h * tensors[i].w;
+		survivors = std::max(survivors, 3 * tensors[i].h * tensors[i].w);
+	}
+	if (anchors.size() >= 6 * tensors.size())
+		this->anchors = anchors;
+	else
+	{
+		const int *defaults[3] = {anchor0, anchor1, anchor2};
+		for (size_t i = 0; i < tensors.size(); i++)
+			this->anchors.insert(this->anchors.end(), defaults[i % 3], defaults[i % 3] + 6);
+	}
+
+	// 常用尺寸且使用默认 anchor 时选择编译期特化的内核
+	std::vector<int> default_anchors(anchor0, anchor0 + 6);
+	default_anchors.insert(default_anchors.end(), anchor1, anchor1 + 6);
+	default_anchors.insert(default_anchors.end(), anchor2, anchor2 + 6);
+	if (standard_branches(branches, model_in_h, model_in_w) && this->anchors == default_anchors)
+	{
+		for (const auto &k : yolov5_kernels)
 		{
-			for (int j = 0; j < grid_w; j++)
-			{
-				int8_t box_confidence = input[(PROP_BOX_SIZE * a + 4) * grid_len + i * grid_w + j];
-				if (box_confidence >= thres_i8)
-				{
-					int offset = (PROP_BOX_SIZE * a) * grid_len + i * grid_w + j;
-					int8_t *in_ptr = input + offset;
-					float box_x = (deqnt_affine_to_f32(*in_ptr, zp, scale)) * 2.0 - 0.5;
-					float box_y = (deqnt_affine_to_f32(in_ptr[grid_len], zp, scale)) * 2.0 - 0.5;
-					float box_w = (deqnt_affine_to_f32(in_ptr[2 * grid_len], zp, scale)) * 2.0;
-					float box_h = (deqnt_affine_to_f32(in_ptr[3 * grid_len], zp, scale)) * 2.0;
-					box_x = (box_x + j) * (float)stride;
-					box_y = (box_y + i) * (float)stride;
-					box_w = box_w * box_w * (float)anchor[a * 2];
-					box_h = box_h * box_h * (float)anchor[a * 2 + 1];
-					box_x -= (box_w / 2.0);
-					box_y -= (box_h / 2.0);
-
-					int8_t maxClassProbs = in_ptr[5 * grid_len];
-					int maxClassId = 0;
-					for (int k = 1; k < OBJ_CLASS_NUM; ++k)
-					{
-						int8_t prob = in_ptr[(5 + k) * grid_len];
-						if (prob > maxClassProbs)
-						{
-							maxClassId = k;
-							maxClassProbs = prob;
-						}
-					}
-					if (maxClassProbs > thres_i8)
-					{
-						objProbs.push_back((deqnt_affine_to_f32(maxClassProbs, zp, scale)) * (deqnt_affine_to_f32(box_confidence, zp, scale)));
-						classId.push_back(maxClassId);
-						validCount++;
-						boxes.push_back(box_x);
-						boxes.push_back(box_y);
-						boxes.push_back(box_w);
-						boxes.push_back(box_h);
-					}
-				}
-			}
+			if (k.in_h == model_in_h && k.in_w == model_in_w && k.num_class == num_class)
+				fixed_kernel = k.kernel;
 		}
 	}
+	set_layout(tensors);
+}
+
+int Yolov5Decoder::decode(int8_t **outputs, float conf_threshold, PostprocessWorkspace *ws)
+{
+	if (fixed_kernel != nullptr)
+		return fixed_kernel(outputs, luts.data(), conf_threshold, ws);
+
+	// YOLO模型通常有多个输出层，每个输出层负责不同尺度的检测，这里依次处理步幅为8、16和32的输出层
+	int validCount = 0;
+	for (size_t i = 0; i < branches.size(); i++)
+	{
+		const head_branch_t &b = branches[i];
+		DynamicGeometry geom = {b.grid_h, b.grid_w, b.stride, num_class, 0, anchors.data() + i * 6};
+		if (native)
+			validCount += process_native(outputs[i], geom, channel_groups[i], ws, validCount, conf_threshold, luts[i]);
+		else
+			validCount += process(outputs[i], geom, ws, validCount, conf_threshold, luts[i]);
+	}
 	return validCount;
 }
 
+Yolov8Decoder::Yolov8Decoder(const std::vector<head_tensor_t> &tensors, int model_in_h, int model_in_w, bool logits)
+{
+	this->model_in_h = model_in_h;
+	this->model_in_w = model_in_w;
+	tensors_per_branch = tensors.size() == 9 ? 3 : 2;
+	reg_max = tensors[0].c / 4;
+	num_class = tensors[1].c;
+	luts.resize(tensors.size());
+	for (size_t i = 0; i < tensors.size(); i++)
+	{
+		// 只有类别分支需要 sigmoid，DFL 分支和 score_sum 必须使用原始反量化值
+		bool is_score = i % tensors_per_branch == 1;
+		build_qnt_lut(&luts[i], tensors[i].zp, tensors[i].scale, logits && is_score);
+	}
+	for (size_t i = 0; i < tensors.size(); i += tensors_per_branch)
+	{
+		branches.push_back(make_branch(tensors[i], model_in_h));
+		candidates += tensors[i].h * tensors[i].w;
+		survivors = std::max(survivors, tensors[i].h * tensors[i].w);
+	}
+
+	// 常用尺寸选择编译期特化的内核
+	if (standard_branches(branches, model_in_h, model_in_w))
+	{
+		for (const auto &k : yolov8_kernels)
+		{
+			if (k.in_h == model_in_h && k.in_w == model_in_w && k.num_class == num_class && k.reg_max == reg_max &&
+				k.per == tensors_per_branch)
+				fixed_kernel = k.kernel;
+		}
+	}
+	set_layout(tensors);
+}
+
+int Yolov8Decoder::decode(int8_t **outputs, float conf_threshold, PostprocessWorkspace *ws)
+{
+	if (fixed_kernel != nullptr)
+		return fixed_kernel(outputs, luts.data(), conf_threshold, ws);
+
+	int validCount = 0;
+	for (size_t b = 0; b < branches.size(); b++)
+	{
+		int box_idx = b * tensors_per_branch;
+		const head_branch_t &br = branches[b];
+		// score_sum 是 sigmoid 后分数的和，类别分支为原始 logits 时不能用来判断
+		bool use_sum = tensors_per_branch == 3 && !luts[box_idx + 1].sigmoid;
+		int8_t *sum_input = use_sum ? outputs[box_idx + 2] : nullptr;
+		const qnt_lut_t *sum_lut = use_sum ? &luts[box_idx + 2] : nullptr;
+		DynamicGeometry geom = {br.grid_h, br.grid_w, br.stride, num_class, reg_max, nullptr};
+		if (native)
+		{
+			// 分支内依次为 框、类别、score_sum（没有时不读取）
+			int c2[3] = {channel_groups[box_idx], channel_groups[box_idx + 1],
+						 tensors_per_branch == 3 ? channel_groups[box_idx + 2] : 1};
+			validCount += process_dfl_native(outputs[box_idx], outputs[box_idx + 1], sum_input, geom, c2, ws,
+											 validCount, conf_threshold, luts[box_idx], luts[box_idx + 1], sum_lut);
+			continue;
+		}
+		validCount += process_dfl(outputs[box_idx], outputs[box_idx + 1], sum_input, geom, ws, validCount,
+								  conf_threshold, luts[box_idx], luts[box_idx + 1], sum_lut);
+	}
+	return validCount;
+}
+
+std::vector<std::string> split_string(const std::string &str, char delim)
+{
+	std::vector<std::string> items;
+	std::stringstream ss(str);
+	std::string item;
+	while (std::getline(ss, item, delim))
+	{
+		size_t first = item.find_first_not_of(" \t\r\n");
+		size_t last = item.find_last_not_of(" \t\r\n");
+		if (first == std::string::npos)
+			continue;
+		items.push_back(item.substr(first, last - first + 1));
+	}
+	return items;
+}
+
+std::string custom_value(const char *custom_string, const std::string &key)
+{
+	if (custom_string == nullptr)
+		return "";
+	for (const auto &kv : split_string(custom_string, ';'))
+	{
+		size_t eq = kv.find('=');
+		if (eq != std::string::npos && kv.substr(0, eq) == key)
+			return kv.substr(eq + 1);
+	}
+	return "";
+}
+
 /**
- * @Description: 接收模型的原始输出（量化后的数据），对其进行解码，并应用NMS和其他过滤逻辑，最终生成可读的检测结果
- * @return {*}
+ * @Description: 按输出张量的数量和形状判断检测头类型
+ * @return {int}: HEAD_TYPE，无法识别时返回 -1
  */
-int post_process(int8_t *input0, int8_t *input1, int8_t *input2, int model_in_h, int model_in_w, float conf_threshold,
-				 float nms_threshold, BOX_RECT pads, float scale_w, float scale_h, std::vector<int32_t> &qnt_zps,
-				 std::vector<float> &qnt_scales, detect_result_group_t *group)
-{
-	static int init = -1;
-	static std::vector<std::string> labels;
-	if (init == -1)
-	{
-		int ret = 0;
-		ret = loadLabelName(LABEL_NALE_TXT_PATH, labels);
-		std::cout << "Labels size: " << labels.size() << std::endl;
-		if (ret < 0) {
-			return -1;
+static int guess_head_type(const std::vector<head_tensor_t> &tensors)
+{
+	size_t n = tensors.size();
+	// YOLOv5：3 个输出，通道数相同，均为 3 * (5 + 类别数)
+	if (n == 3)
+	{
+		bool ok = true;
+		for (const auto &t : tensors)
+			ok = ok && t.c == tensors[0].c && t.c % 3 == 0 && t.c / 3 > 5;
+		if (ok)
+			return HEAD_TYPE::HEAD_YOLOV5;
+	}
+	// YOLOv8 / YOLO11：每个步幅 (框, 类别) 或 (框, 类别, score_sum)，同一步幅的网格相同
+	if (n == 6 || n == 9)
+	{
+		int per = n / 3;
+		bool ok = true;
+		for (size_t i = 0; i < n; i += per)
+		{
+			ok = ok && tensors[i].c % 4 == 0 && tensors[i].c / 4 <= DFL_MAX_REG && tensors[i].c == tensors[0].c &&
+				 tensors[i + 1].c == tensors[1].c;
+			for (int k = 1; k < per; k++)
+				ok = ok && tensors[i + k].h == tensors[i].h && tensors[i + k].w == tensors[i].w;
+			if (per == 3)
+				ok = ok && tensors[i + 2].c == 1;
 		}
+		if (ok)
+			return HEAD_TYPE::HEAD_YOLOV8;
+	}
+	return -1;
+}
 
-		init = 0;
+std::unique_ptr<HeadDecoder> create_head_decoder(const std::vector<head_tensor_t> &tensors, int model_in_h,
+												 int model_in_w, const char *custom_string, bool logits, bool verbose)
+{
+	int type = guess_head_type(tensors);
+	std::string head = custom_value(custom_string, "head");
+	if (!head.empty())
+	{
+		int wanted = -1;
+		if (head == "yolov5")
+			wanted = HEAD_TYPE::HEAD_YOLOV5;
+		else if (head == "yolov8" || head == "yolo11" || head == "yolov11")
+			wanted = HEAD_TYPE::HEAD_YOLOV8;
+		// 指定了 head 时仍需检查形状，避免按错误的布局读取输出
+		if (wanted != type)
+		{
+			std::cerr << "Head '" << head << "' in custom string does not match the output tensors" << std::endl;
+			return nullptr;
+		}
 	}
-	memset(group, 0, sizeof(detect_result_group_t));
 
-	std::vector<float> filterBoxes;
-	std::vector<float> objProbs;
-	std::vector<int> classId;
-
-	// 处理不同步幅的输出
-	// YOLO模型通常有多个输出层，每个输出层负责不同尺度的检测。这里分别处理步幅为8、16和32的输出层。
-	// stride 8
-	int stride0 = 8;
-	int grid_h0 = model_in_h / stride0;
-	int grid_w0 = model_in_w / stride0;
-	int validCount0 = 0;
-	validCount0 = process(input0, (int *)anchor0, grid_h0, grid_w0, model_in_h, model_in_w, stride0, filterBoxes, objProbs,
-						  classId, conf_threshold, qnt_zps[0], qnt_scales[0]);
-
-	// stride 16
-	int stride1 = 16;
-	int grid_h1 = model_in_h / stride1;
-	int grid_w1 = model_in_w / stride1;
-	int validCount1 = 0;
-	validCount1 = process(input1, (int *)anchor1, grid_h1, grid_w1, model_in_h, model_in_w, stride1, filterBoxes, objProbs,
-						  classId, conf_threshold, qnt_zps[1], qnt_scales[1]);
-
-	// stride 32
-	int stride2 = 32;
-	int grid_h2 = model_in_h / stride2;
-	int grid_w2 = model_in_w / stride2;
-	int validCount2 = 0;
-	validCount2 = process(input2, (int *)anchor2, grid_h2, grid_w2, model_in_h, model_in_w, stride2, filterBoxes, objProbs,
-						  classId, conf_threshold, qnt_zps[2], qnt_scales[2]);
-
-	int validCount = validCount0 + validCount1 + validCount2;
-	// no object detect
-	if (validCount <= 0)
+	std::unique_ptr<HeadDecoder> decoder;
+	if (type == HEAD_TYPE::HEAD_YOLOV5)
 	{
-		return 0;
+		std::vector<int> anchors;
+		for (const auto &v : split_string(custom_value(custom_string, "anchors"), ','))
+			anchors.push_back(atoi(v.c_str()));
+		decoder.reset(new Yolov5Decoder(tensors, model_in_h, model_in_w, anchors, logits));
+	}
+	else if (type == HEAD_TYPE::HEAD_YOLOV8)
+		decoder.reset(new Yolov8Decoder(tensors, model_in_h, model_in_w, logits));
+	else
+	{
+		std::cerr << "Unsupported detection head: " << tensors.size() << " outputs" << std::endl;
+		return nullptr;
 	}
 
-	std::vector<int> indexArray;
-	for (int i = 0; i < validCount; ++i)
+	// 类别 id 以 uint8 存放
+	if (decoder->num_classes() <= 0 || decoder->num_classes() > 256)
 	{
-		indexArray.push_back(i);
+		std::cerr << "Unsupported class number: " << decoder->num_classes() << std::endl;
+		return nullptr;
 	}
 
-	// 按置信度降序排列检测结果
-	quick_sort_indice_inverse(objProbs, 0, validCount - 1, indexArray);
+	// 标签优先取模型自带的，没有时读取标签文件，数量不足的用类别 id 代替
+	decoder->labels = split_string(custom_value(custom_string, "labels"), ',');
+	if (decoder->labels.empty())
+		loadLabelName(LABEL_NALE_TXT_PATH, decoder->labels, decoder->num_classes());
+	if (verbose && (int)decoder->labels.size() != decoder->num_classes())
+		std::cerr << "Warning: " << decoder->labels.size() << " labels for " << decoder->num_classes() << " classes"
+				  << std::endl;
+	decoder->labels.resize(decoder->num_classes());
+	for (int i = 0; i < decoder->num_classes(); i++)
+	{
+		if (decoder->labels[i].empty())
+			decoder->labels[i] = std::to_string(i);
+	}
+
+	if (verbose)
+		std::cout << "head decoder: " << decoder->name() << ", classes: " << decoder->num_classes()
+				  << ", branches: " << decoder->get_branches().size()
+				  << ", kernel: " << (decoder->specialized() ? "specialized" : "generic")
+				  << ", layout: " << (decoder->native_layout() ? "native" : "nchw") << std::endl;
+	return decoder;
+}
+
+void PostprocessWorkspace::init(int max_candidates, int max_survivors)
+{
+	if (max_candidates > capacity)
+		capacity = max_candidates;
+	boxes.reserve(capacity * 4);
+	probs.reserve(capacity);
+	class_ids.reserve(capacity);
+	survivors.reserve(max_survivors);
+	nms.reserve(capacity, OBJ_NUMB_MAX_SIZE);
+}
 
-	std::set<int> class_set(std::begin(classId), std::end(classId));
+/**
+ * @Description: 接收模型的原始输出（量化后的数据），对其进行解码，并应用NMS和其他过滤逻辑，最终生成可读的检测结果
+ * @return {*}
+ */
+int post_process(HeadDecoder *decoder, int8_t **outputs, float conf_threshold, float nms_threshold, BOX_RECT pads,
+				 float scale_w, float scale_h, int nms_mode, PostprocessWorkspace *ws, detect_result_group_t *group)
+{
+	memset(group, 0, sizeof(detect_result_group_t));
+	int model_in_h = decoder->input_height();
+	int model_in_w = decoder->input_width();
 
-	// 对每个类别应用NMS，去除重叠的检测框
-	for (auto c : class_set)
+	// 候选框、存活下标和 NMS 缓冲区全部来自工作区，稳定运行时每帧不再申请内存
+	// 工作区容量不足（如输入尺寸变化）时重新分配
+	if (ws->capacity < decoder->max_candidates())
+		ws->init(decoder->max_candidates(), decoder->max_survivors());
+
+	int validCount = decoder->decode(outputs, conf_threshold, ws);
+	// no object detect
+	if (validCount <= 0)
 	{
-		nms(validCount, filterBoxes, classId, indexArray, c, nms_threshold);
+		return 0;
 	}
 
+	// 部分 top-K + 按类别分桶的 NMS，保留的框已按置信度降序排列
+	// 候选很多时使用空间哈希版本，网格边长取最大步幅
+	const float *filterBoxes = ws->boxes.data();
+	const float *objProbs = ws->probs.data();
+	const int *classId = ws->class_ids.data();
+	const int *keep = ws->keep;
+	int keepCount = nms_run(nms_mode, validCount, filterBoxes, objProbs, classId, nms_threshold, OBJ_NUMB_MAX_SIZE,
+							ws->keep, decoder->nms_cell_size(), ws->nms);
+	const std::vector<std::string> &labels = decoder->labels;
+
 	int last_count = 0;
 	group->count = 0;
 	/* box valid detect target */
-	for (int i = 0; i < validCount; ++i)
+	for (int i = 0; i < keepCount; ++i)
 	{
-		if (indexArray[i] == -1 || last_count >= OBJ_NUMB_MAX_SIZE)
-		{
-			continue;
-		}
-		int n = indexArray[i];
+		int n = keep[i];
 
 		float x1 = filterBoxes[n * 4 + 0] - pads.left;
 		float y1 = filterBoxes[n * 4 + 1] - pads.top;
 		float x2 = x1 + filterBoxes[n * 4 + 2];
 		float y2 = y1 + filterBoxes[n * 4 + 3];
 		int id = classId[n];
-		float obj_conf = objProbs[i];
+		float obj_conf = objProbs[n];
 
 		group->results[last_count].box.left = (int)(clamp(x1, 0, model_in_w) / scale_w);
 		group->results[last_count].box.top = (int)(clamp(y1, 0, model_in_h) / scale_h);
 		group->results[last_count].box.right = (int)(clamp(x2, 0, model_in_w) / scale_w);
 		group->results[last_count].box.bottom = (int)(clamp(y2, 0, model_in_h) / scale_h);
 		group->results[last_count].prop = obj_conf;
+		group->results[last_count].propagated = false;
+		group->results[last_count].track_id = -1;
+		group->results[last_count].attr[0] = '\0';
+		group->results[last_count].attr_prop = 0.f;
 		// char *label = labels[id];
 		// strncpy(group->results[last_count].name, labels[id].c_str(), OBJ_NAME_MAX_SIZE);
 		// group->results[last_count].name[OBJ_NAME_MAX_SIZE - 1] = '\0';
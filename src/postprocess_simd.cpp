@@ -0,0 +1,385 @@
+/*
+ * @Author: Li RF
+ * @Date: 2025-04-02 10:12:45
+ * @LastEditors: Li RF
+ * @LastEditTime: 2025-04-02 10:12:45
+ * @Description: 后处理向量化内核
+ *               输出张量为 NCHW 布局，同一类别平面内相邻 cell 连续存放，
+ *               因此按 cell 方向向量化：一次比较 16/32 个 cell 的同一个类别；
+ *               原生布局（NC1HWC2）中同一 cell 的 C2 个通道连续存放，按通道方向向量化
+ * Email: 1125962926@qq.com
+ * Copyright (c) 2025 Li RF, All Rights Reserved.
+ */
+#include "postprocess_simd.h"
+
+#include <math.h>
+#include <stdint.h>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define PP_SIMD_NEON 1
+#elif defined(__AVX2__)
+#include <immintrin.h>
+#define PP_SIMD_AVX2 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define PP_SIMD_SSE2 1
+#endif
+
+/**
+ * @Description: 标量参考实现，逻辑与原 process() 中的类别循环一致
+ * @return {*}
+ */
+void class_argmax_i8_ref(const int8_t *cls_ptr, int num_class, int plane_stride, int count,
+                         int8_t *max_prob, uint8_t *max_id)
+{
+    for (int c = 0; c < count; c++)
+    {
+        int8_t best = cls_ptr[c];
+        int best_id = 0;
+        for (int k = 1; k < num_class; ++k)
+        {
+            int8_t prob = cls_ptr[k * plane_stride + c];
+            if (prob > best)
+            {
+                best_id = k;
+                best = prob;
+            }
+        }
+        max_prob[c] = best;
+        max_id[c] = (uint8_t)best_id;
+    }
+}
+
+void class_argmax_i8(const int8_t *cls_ptr, int num_class, int plane_stride, int count,
+                     int8_t *max_prob, uint8_t *max_id)
+{
+    int c = 0;
+#if defined(PP_SIMD_NEON)
+    // 两组 16 路交错执行，隐藏比较-选择的依赖延迟
+    for (; c + 32 <= count; c += 32)
+    {
+        const int8_t *p = cls_ptr + c;
+        int8x16_t best0 = vld1q_s8(p);
+        int8x16_t best1 = vld1q_s8(p + 16);
+        uint8x16_t id0 = vdupq_n_u8(0);
+        uint8x16_t id1 = vdupq_n_u8(0);
+        for (int k = 1; k < num_class; ++k)
+        {
+            const int8_t *pk = p + k * plane_stride;
+            int8x16_t v0 = vld1q_s8(pk);
+            int8x16_t v1 = vld1q_s8(pk + 16);
+            // 严格大于才更新，保证相同概率时保留较小的类别下标
+            uint8x16_t gt0 = vcgtq_s8(v0, best0);
+            uint8x16_t gt1 = vcgtq_s8(v1, best1);
+            uint8x16_t kv = vdupq_n_u8((uint8_t)k);
+            best0 = vmaxq_s8(v0, best0);
+            best1 = vmaxq_s8(v1, best1);
+            id0 = vbslq_u8(gt0, kv, id0);
+            id1 = vbslq_u8(gt1, kv, id1);
+        }
+        vst1q_s8(max_prob + c, best0);
+        vst1q_s8(max_prob + c + 16, best1);
+        vst1q_u8(max_id + c, id0);
+        vst1q_u8(max_id + c + 16, id1);
+    }
+    for (; c + 16 <= count; c += 16)
+    {
+        const int8_t *p = cls_ptr + c;
+        int8x16_t best = vld1q_s8(p);
+        uint8x16_t id = vdupq_n_u8(0);
+        for (int k = 1; k < num_class; ++k)
+        {
+            int8x16_t v = vld1q_s8(p + k * plane_stride);
+            uint8x16_t gt = vcgtq_s8(v, best);
+            best = vmaxq_s8(v, best);
+            id = vbslq_u8(gt, vdupq_n_u8((uint8_t)k), id);
+        }
+        vst1q_s8(max_prob + c, best);
+        vst1q_u8(max_id + c, id);
+    }
+#elif defined(PP_SIMD_AVX2)
+    for (; c + 32 <= count; c += 32)
+    {
+        const int8_t *p = cls_ptr + c;
+        __m256i best = _mm256_loadu_si256((const __m256i *)p);
+        __m256i id = _mm256_setzero_si256();
+        for (int k = 1; k < num_class; ++k)
+        {
+            __m256i v = _mm256_loadu_si256((const __m256i *)(p + k * plane_stride));
+            __m256i gt = _mm256_cmpgt_epi8(v, best);
+            best = _mm256_max_epi8(v, best);
+            id = _mm256_blendv_epi8(id, _mm256_set1_epi8((char)k), gt);
+        }
+        _mm256_storeu_si256((__m256i *)(max_prob + c), best);
+        _mm256_storeu_si256((__m256i *)(max_id + c), id);
+    }
+#elif defined(PP_SIMD_SSE2)
+    // SSE2 没有有符号 8 位 max 和 blendv，用比较掩码做按位选择
+    for (; c + 16 <= count; c += 16)
+    {
+        const int8_t *p = cls_ptr + c;
+        __m128i best = _mm_loadu_si128((const __m128i *)p);
+        __m128i id = _mm_setzero_si128();
+        for (int k = 1; k < num_class; ++k)
+        {
+            __m128i v = _mm_loadu_si128((const __m128i *)(p + k * plane_stride));
+            __m128i gt = _mm_cmpgt_epi8(v, best);
+            best = _mm_or_si128(_mm_and_si128(gt, v), _mm_andnot_si128(gt, best));
+            id = _mm_or_si128(_mm_and_si128(gt, _mm_set1_epi8((char)k)), _mm_andnot_si128(gt, id));
+        }
+        _mm_storeu_si128((__m128i *)(max_prob + c), best);
+        _mm_storeu_si128((__m128i *)(max_id + c), id);
+    }
+#endif
+    // 剩余不足一个向量宽度的 cell
+    if (c < count)
+        class_argmax_i8_ref(cls_ptr + c, num_class, plane_stride, count - c, max_prob + c, max_id + c);
+}
+
+int objectness_filter_i8_ref(const int8_t *plane, int len, int8_t thres, int32_t base, int32_t *out_idx)
+{
+    int n = 0;
+    for (int i = 0; i < len; i++)
+    {
+        if (plane[i] >= thres)
+            out_idx[n++] = base + i;
+    }
+    return n;
+}
+
+/**
+ * @Description: 将位掩码中置位的下标依次写出（低位在前，保证升序）
+ * @return {int}: 写出的数量
+ */
+static inline int emit_mask_bits(uint64_t mask, int32_t first, int32_t *out_idx)
+{
+    int n = 0;
+    while (mask)
+    {
+        out_idx[n++] = first + __builtin_ctzll(mask);
+        mask &= mask - 1;
+    }
+    return n;
+}
+
+int objectness_filter_i8(const int8_t *plane, int len, int8_t thres, int32_t base, int32_t *out_idx)
+{
+    int n = 0;
+    int i = 0;
+#if defined(PP_SIMD_NEON)
+    int8x16_t t = vdupq_n_s8(thres);
+    for (; i + 16 <= len; i += 16)
+    {
+        uint8x16_t ge = vcgeq_s8(vld1q_s8(plane + i), t);
+        // 将 16 字节掩码窄化为 64 位（每个 cell 占 4 位），空块直接跳过
+        uint64_t nibbles = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(ge), 4)), 0);
+        if (nibbles == 0)
+            continue;
+        nibbles &= 0x1111111111111111ULL;
+        while (nibbles)
+        {
+            out_idx[n++] = base + i + (__builtin_ctzll(nibbles) >> 2);
+            nibbles &= nibbles - 1;
+        }
+    }
+#elif defined(PP_SIMD_AVX2)
+    // a >= t 等价于 !(t > a)
+    __m256i t = _mm256_set1_epi8((char)thres);
+    for (; i + 32 <= len; i += 32)
+    {
+        __m256i lt = _mm256_cmpgt_epi8(t, _mm256_loadu_si256((const __m256i *)(plane + i)));
+        uint32_t mask = ~(uint32_t)_mm256_movemask_epi8(lt);
+        if (mask)
+            n += emit_mask_bits(mask, base + i, out_idx + n);
+    }
+#elif defined(PP_SIMD_SSE2)
+    __m128i t = _mm_set1_epi8((char)thres);
+    for (; i + 16 <= len; i += 16)
+    {
+        __m128i lt = _mm_cmpgt_epi8(t, _mm_loadu_si128((const __m128i *)(plane + i)));
+        uint32_t mask = ~(uint32_t)_mm_movemask_epi8(lt) & 0xFFFFu;
+        if (mask)
+            n += emit_mask_bits(mask, base + i, out_idx + n);
+    }
+#endif
+    if (i < len)
+        n += objectness_filter_i8_ref(plane + i, len - i, thres, base + i, out_idx + n);
+    return n;
+}
+
+/************************************** 原生布局 *******************************************/
+/**
+ * @Description: 最大值不超过阈值时返回 -1，否则返回第一个等于最大值的类别下标
+ */
+static inline int class_locate_c2_i8(const int8_t *cell_ptr, int first, int num_class, int c2, int group_stride,
+                                     int8_t best, int8_t thres)
+{
+    if (best <= thres)
+        return -1;
+    int g = first / c2, off = first % c2;
+    for (int k = 0; k < num_class; g++, off = 0)
+    {
+        const int8_t *p = cell_ptr + g * group_stride;
+        for (; off < c2 && k < num_class; off++, k++)
+        {
+            if (p[off] == best)
+                return k;
+        }
+    }
+    return -1;
+}
+
+int8_t class_argmax_c2_i8_ref(const int8_t *cell_ptr, int first, int num_class, int c2, int group_stride,
+                              int8_t thres, int *max_id)
+{
+    int8_t best = INT8_MIN;
+    for (int k = 0; k < num_class; k++)
+    {
+        int ch = first + k;
+        int8_t prob = cell_ptr[(ch / c2) * group_stride + ch % c2];
+        best = prob > best ? prob : best;
+    }
+    *max_id = class_locate_c2_i8(cell_ptr, first, num_class, c2, group_stride, best, thres);
+    return best;
+}
+
+int8_t class_argmax_c2_i8(const int8_t *cell_ptr, int first, int num_class, int c2, int group_stride, int8_t thres,
+                          int *max_id)
+{
+    int8_t best = INT8_MIN;
+#if defined(PP_SIMD_NEON) && defined(__aarch64__)
+    int8x16_t vbest = vdupq_n_s8(INT8_MIN);
+#elif defined(PP_SIMD_AVX2) || defined(PP_SIMD_SSE2)
+    // SSE2 没有有符号 8 位 max：异或 0x80 转为无符号比较
+    const __m128i bias = _mm_set1_epi8((char)0x80);
+    __m128i vbest = _mm_setzero_si128();
+#endif
+    // 按通道组分段，每段内的类别连续存放；先逐元素求最大值，最后只做一次水平归约
+    int g = first / c2, off = first % c2;
+    for (int k = 0; k < num_class; g++, off = 0)
+    {
+        int run = c2 - off < num_class - k ? c2 - off : num_class - k;
+        const int8_t *p = cell_ptr + g * group_stride + off;
+        int r = 0;
+#if defined(PP_SIMD_NEON) && defined(__aarch64__)
+        // RK3588 的 int8 输出 C2 = 16，整组正好一个向量
+        for (; r + 16 <= run; r += 16)
+            vbest = vmaxq_s8(vbest, vld1q_s8(p + r));
+#elif defined(PP_SIMD_AVX2) || defined(PP_SIMD_SSE2)
+        for (; r + 16 <= run; r += 16)
+            vbest = _mm_max_epu8(vbest, _mm_xor_si128(_mm_loadu_si128((const __m128i *)(p + r)), bias));
+#endif
+        for (; r < run; r++)
+            best = p[r] > best ? p[r] : best;
+        k += run;
+    }
+#if defined(PP_SIMD_NEON) && defined(__aarch64__)
+    int8_t vmax = vmaxvq_s8(vbest);
+    best = vmax > best ? vmax : best;
+#elif defined(PP_SIMD_AVX2) || defined(PP_SIMD_SSE2)
+    vbest = _mm_max_epu8(vbest, _mm_srli_si128(vbest, 8));
+    vbest = _mm_max_epu8(vbest, _mm_srli_si128(vbest, 4));
+    vbest = _mm_max_epu8(vbest, _mm_srli_si128(vbest, 2));
+    vbest = _mm_max_epu8(vbest, _mm_srli_si128(vbest, 1));
+    int8_t vmax = (int8_t)((uint8_t)_mm_cvtsi128_si32(vbest) ^ 0x80);
+    best = vmax > best ? vmax : best;
+#endif
+    // 绝大多数 cell 是背景，只有超过阈值时才回头定位下标
+    *max_id = class_locate_c2_i8(cell_ptr, first, num_class, c2, group_stride, best, thres);
+    return best;
+}
+
+/************************************** DFL *******************************************/
+void build_dfl_exp_lut(float *lut, float scale)
+{
+    for (int d = 0; d < 256; d++)
+        lut[d] = expf(-(float)d * scale);
+}
+
+/**
+ * @Description: 单条边的 softmax 期望，bin 连续存放
+ */
+static inline float dfl_edge_i8_ref(const int8_t *p, int reg_max, const float *exp_lut)
+{
+    int8_t qmax = p[0];
+    for (int k = 1; k < reg_max; k++)
+        qmax = p[k] > qmax ? p[k] : qmax;
+    float sum = 0.f, acc = 0.f;
+    for (int k = 0; k < reg_max; k++)
+    {
+        float e = exp_lut[qmax - p[k]];
+        sum += e;
+        acc += e * (float)k;
+    }
+    return acc / sum;
+}
+
+/**
+ * @Description: 将跨平面存放的 bin 收集到连续缓冲区，已连续时直接返回原地址
+ */
+template <typename T>
+static inline const T *dfl_gather(const T *bins, int plane_stride, int reg_max, T *buf)
+{
+    if (plane_stride == 1)
+        return bins;
+    for (int k = 0; k < 4 * reg_max; k++)
+        buf[k] = bins[k * plane_stride];
+    return buf;
+}
+
+void dfl_decode_i8_ref(const int8_t *bins, int plane_stride, int reg_max, const float *exp_lut, float *dist)
+{
+    int8_t buf[4 * DFL_MAX_REG];
+    const int8_t *p = dfl_gather(bins, plane_stride, reg_max, buf);
+    for (int e = 0; e < 4; e++)
+        dist[e] = dfl_edge_i8_ref(p + e * reg_max, reg_max, exp_lut);
+}
+
+void dfl_decode_i8(const int8_t *bins, int plane_stride, int reg_max, const float *exp_lut, float *dist)
+{
+#if defined(PP_SIMD_NEON) && defined(__aarch64__)
+    if (reg_max == 16)
+    {
+        int8_t buf[4 * 16];
+        const int8_t *p = dfl_gather(bins, plane_stride, 16, buf);
+        const float32x4_t w0 = {0.f, 1.f, 2.f, 3.f};
+        const float32x4_t w4 = vdupq_n_f32(4.f);
+        for (int e = 0; e < 4; e++)
+        {
+            int8x16_t v = vld1q_s8(p + e * 16);
+            // 与最大值的差在 [0, 255]，8 位减法回绕后按无符号解释即为正确的查表下标
+            uint8x16_t d = vreinterpretq_u8_s8(vsubq_s8(vdupq_n_s8(vmaxvq_s8(v)), v));
+            uint8_t idx[16];
+            vst1q_u8(idx, d);
+            // 查表后 4 路并行累加 sum 与 k * e
+            float32x4_t sum = vdupq_n_f32(0.f);
+            float32x4_t acc = vdupq_n_f32(0.f);
+            float32x4_t w = w0;
+            for (int k = 0; k < 16; k += 4)
+            {
+                float32x4_t ev = {exp_lut[idx[k]], exp_lut[idx[k + 1]], exp_lut[idx[k + 2]], exp_lut[idx[k + 3]]};
+                sum = vaddq_f32(sum, ev);
+                acc = vfmaq_f32(acc, ev, w);
+                w = vaddq_f32(w, w4);
+            }
+            dist[e] = vaddvq_f32(acc) / vaddvq_f32(sum);
+        }
+        return;
+    }
+#endif
+    dfl_decode_i8_ref(bins, plane_stride, reg_max, exp_lut, dist);
+}
+
+const char *postprocess_simd_isa()
+{
+#if defined(PP_SIMD_NEON)
+    return "neon";
+#elif defined(PP_SIMD_AVX2)
+    return "avx2";
+#elif defined(PP_SIMD_SSE2)
+    return "sse2";
+#else
+    return "scalar";
+#endif
+}
@@ -10,6 +10,7 @@
 
 #include <stdio.h>
 #include "postprocess.h"
+#include "input_buffer.h"
 #include "im2d.h"
 #include "rga.h"
 #include "RgaUtils.h"
@@ -150,6 +151,125 @@ int RGA_resize(const cv::Mat &image, cv::Mat &resized_image)
     return 0;
 }
 
+/**
+ * @Description: RGA 前处理：BGR 源图缩放并转为 RGB，直接写入模型输入缓冲区的内容区域
+ *               缩放和换通道在一次 RGA 任务中完成；填充区域由 update_letterbox 预先写好，这里不再处理
+ *               缓冲区有 dma-buf fd 时通过 fd 访问，避免 RGA 对虚拟地址的额外映射
+ * @param {Mat} &image: BGR 源图
+ * @param {InputBuffer} &input: 模型输入缓冲区，需要先调用 update_letterbox
+ * @return {*} 返回 0 表示成功
+ */
+int RGA_letterbox_into(const cv::Mat &image, InputBuffer &input)
+{
+    if (image.type() != CV_8UC3 || input.get_channel() != 3)
+    {
+        printf("source image type is %d!\n", image.type());
+        return -1;
+    }
+    rga_buffer_t src_img;
+    rga_buffer_t dst_img;
+    rga_buffer_t pat_img;
+    memset(&src_img, 0, sizeof(src_img));
+    memset(&dst_img, 0, sizeof(dst_img));
+    memset(&pat_img, 0, sizeof(pat_img));
+
+    // 源图可以是整帧的 ROI（分块推理）：按整帧的内存和行步长导入，只处理 ROI 区域
+    cv::Size whole;
+    cv::Point ofs;
+    image.locateROI(whole, ofs);
+    src_img = wrapbuffer_virtualaddr((void *)image.datastart, whole.width, whole.height, RK_FORMAT_BGR_888,
+                                     (int)(image.step / image.elemSize()), whole.height);
+    // 目标为整个输入缓冲区，行步长取 NPU 要求的 w_stride
+    if (input.fd() >= 0)
+        dst_img = wrapbuffer_fd(input.fd(), input.get_width(), input.get_height(), RK_FORMAT_RGB_888,
+                                input.get_w_stride(), input.get_height());
+    else
+        dst_img = wrapbuffer_virtualaddr((void *)input.data(), input.get_width(), input.get_height(),
+                                         RK_FORMAT_RGB_888, input.get_w_stride(), input.get_height());
+
+    // 源图（ROI）-> 内容区域，源/目标格式不同，RGA 同时完成 BGR -> RGB
+    const cv::Rect &content = input.get_content();
+    im_rect srect = {ofs.x, ofs.y, image.cols, image.rows};
+    im_rect drect = {content.x, content.y, content.width, content.height};
+    im_rect prect;
+    memset(&prect, 0, sizeof(prect));
+
+    IM_STATUS STATUS = improcess(src_img, dst_img, pat_img, srect, drect, prect, IM_SYNC);
+    if (IM_STATUS_SUCCESS != STATUS) {
+        fprintf(stderr, "rga letterbox error! %s", imStrError(STATUS));
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @Description: RGA 批量裁剪：源图上的多个框各自缩放到输入尺寸并转为 RGB，依次写入批输入缓冲区的各个位置
+ *               批输入按 NHWC 排列，即 slot_h 行一张图上下堆叠；全部裁剪放在一个 RGA job 中一次提交
+ * @param {Mat} &image: BGR 源图
+ * @param {vector<cv::Rect>} &rects: 裁剪框（源图坐标，已裁到图像范围内）
+ * @param {InputBuffer} &input: 批输入缓冲区，高度为 slot_h * batch
+ * @param {int} slot_h: 每张图的高度
+ * @return {*} 返回 0 表示成功，失败时 job 已取消，由调用方改用 OpenCV
+ */
+int RGA_crop_resize_batch(const cv::Mat &image, const std::vector<cv::Rect> &rects, InputBuffer &input, int slot_h)
+{
+    if (image.type() != CV_8UC3)
+    {
+        fprintf(stderr, "source image type is %d!\n", image.type());
+        return -1;
+    }
+    if (input.get_channel() != 3)
+    {
+        fprintf(stderr, "crop batch input has %d channels, expected 3\n", input.get_channel());
+        return -1;
+    }
+    if ((int)rects.size() * slot_h > input.get_height())
+    {
+        fprintf(stderr, "%zu crops of height %d do not fit in the %d-row batch input\n", rects.size(), slot_h,
+                input.get_height());
+        return -1;
+    }
+    rga_buffer_t src_img;
+    rga_buffer_t dst_img;
+    rga_buffer_t pat_img;
+    memset(&src_img, 0, sizeof(src_img));
+    memset(&dst_img, 0, sizeof(dst_img));
+    memset(&pat_img, 0, sizeof(pat_img));
+    src_img = wrapbuffer_virtualaddr((void *)image.data, image.cols, image.rows, RK_FORMAT_BGR_888,
+                                     (int)(image.step / image.elemSize()), image.rows);
+    if (input.fd() >= 0)
+        dst_img = wrapbuffer_fd(input.fd(), input.get_width(), input.get_height(), RK_FORMAT_RGB_888,
+                                input.get_w_stride(), input.get_height());
+    else
+        dst_img = wrapbuffer_virtualaddr((void *)input.data(), input.get_width(), input.get_height(),
+                                         RK_FORMAT_RGB_888, input.get_w_stride(), input.get_height());
+    im_rect prect;
+    memset(&prect, 0, sizeof(prect));
+
+    im_job_handle_t job = imbeginJob();
+    if (job <= 0) {
+        fprintf(stderr, "rga imbeginJob failed\n");
+        return -1;
+    }
+    for (size_t i = 0; i < rects.size(); i++)
+    {
+        im_rect srect = {rects[i].x, rects[i].y, rects[i].width, rects[i].height};
+        im_rect drect = {0, (int)i * slot_h, input.get_width(), slot_h};
+        IM_STATUS STATUS = improcessTask(job, src_img, dst_img, pat_img, srect, drect, prect, NULL, 0);
+        if (IM_STATUS_SUCCESS != STATUS) {
+            fprintf(stderr, "rga crop task error! %s\n", imStrError(STATUS));
+            imcancelJob(job);
+            return -1;
+        }
+    }
+    IM_STATUS STATUS = imendJob(job, IM_SYNC);
+    if (IM_STATUS_SUCCESS != STATUS) {
+        fprintf(stderr, "rga crop job error! %s\n", imStrError(STATUS));
+        return -1;
+    }
+    return 0;
+}
+
 /**
  * @Description: 将图像导入 RGA 内部统一管理内存，而不是用户自己管理
  * @param {Mat} &image: 
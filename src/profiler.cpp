@@ -0,0 +1,389 @@
+/*
+ * @Author: Li RF
+ * @Date: 2025-04-16 10:05:44
+ * @LastEditors: Li RF
+ * @LastEditTime: 2025-04-16 10:05:44
+ * @Description: NPU 逐层性能分析：解析、CSV / JSON 输出与对比，不依赖 NPU
+ * Email: 1125962926@qq.com
+ * Copyright (c) 2025 Li RF, All Rights Reserved.
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+
+#include "profiler.h"
+
+double PerfReport::total_us() const
+{
+    double total = 0;
+    for (const auto &l : layers)
+        total += l.time_us;
+    return total;
+}
+
+/**
+ * @Description: 按空白切分
+ */
+static std::vector<std::string> split_ws(const std::string &line)
+{
+    std::vector<std::string> tokens;
+    std::istringstream iss(line);
+    std::string t;
+    while (iss >> t)
+        tokens.push_back(t);
+    return tokens;
+}
+
+/**
+ * @Description: 旧版运行时的表头含有空格（"Op Type"、"Data Type" 等），合并为一个词，与数据行的列对齐
+ */
+static std::string normalize_header(std::string line)
+{
+    const char *words[] = {"Op Type", "Data Type", "Input Shape", "Output Shape", "Full Name", "DDR Cycles",
+                           "NPU Cycles", "Total Cycles", "Max Cycles", "Task Number", "Task Size", "Lut Number",
+                           "Regcmd Size"};
+    for (const char *w : words)
+    {
+        const char *space = strchr(w, ' ');
+        size_t pos;
+        while ((pos = line.find(w)) != std::string::npos)
+            line.erase(pos + (space - w), 1);
+    }
+    return line;
+}
+
+static bool is_integer(const std::string &s)
+{
+    return !s.empty() && std::all_of(s.begin(), s.end(), [](char c) { return c >= '0' && c <= '9'; });
+}
+
+int parse_perf_detail(const char *text, std::vector<LayerPerf> &layers)
+{
+    layers.clear();
+    if (text == nullptr)
+        return -1;
+    std::istringstream iss(text);
+    std::string line;
+    int col_op = -1, col_target = -1, col_time = -1, col_name = -1;
+    while (std::getline(iss, line))
+    {
+        if (col_time < 0) {
+            // 表头：以 ID 开头并含有 Time(us) 列
+            std::vector<std::string> header = split_ws(normalize_header(line));
+            if (header.empty() || header[0] != "ID")
+                continue;
+            for (size_t i = 0; i < header.size(); i++)
+            {
+                if (header[i] == "OpType")
+                    col_op = i;
+                else if (header[i] == "Target")
+                    col_target = i;
+                else if (header[i] == "Time(us)")
+                    col_time = i;
+                else if (header[i] == "FullName")
+                    col_name = i;
+            }
+            if (col_time < 0 || col_op < 0)
+                col_time = -1;
+            continue;
+        }
+
+        std::vector<std::string> tokens = split_ws(line);
+        if (tokens.empty() || !is_integer(tokens[0])) {
+            // 数据行之后的汇总行（Total ...）表示表格结束
+            if (!layers.empty() && !tokens.empty() && tokens[0] == "Total")
+                break;
+            continue;
+        }
+        if ((int)tokens.size() <= std::max(col_time, col_op))
+            continue;
+        LayerPerf layer;
+        layer.id = atoi(tokens[0].c_str());
+        layer.op_type = tokens[col_op];
+        if (col_target >= 0 && col_target < (int)tokens.size())
+            layer.target = tokens[col_target];
+        layer.time_us = atof(tokens[col_time].c_str());
+        if (col_name >= 0 && col_name < (int)tokens.size())
+            layer.name = tokens[col_name];
+        layers.push_back(layer);
+    }
+    return layers.empty() ? -1 : 0;
+}
+
+int accumulate_perf(PerfReport &report, const std::vector<LayerPerf> &layers, double run_us)
+{
+    if (report.frames == 0) {
+        report.layers = layers;
+    }
+    else {
+        if (layers.size() != report.layers.size())
+            return -1;
+        for (size_t i = 0; i < layers.size(); i++)
+        {
+            if (layers[i].op_type != report.layers[i].op_type)
+                return -1;
+            report.layers[i].time_us += layers[i].time_us;
+        }
+    }
+    report.run_us += run_us;
+    report.frames++;
+    return 0;
+}
+
+void finish_perf_report(PerfReport &report)
+{
+    if (report.frames <= 1)
+        return;
+    for (auto &l : report.layers)
+        l.time_us /= report.frames;
+    report.run_us /= report.frames;
+}
+
+/**
+ * @Description: CSV 字段加引号，内部的引号写两次
+ */
+static std::string csv_quote(const std::string &s)
+{
+    std::string out = "\"";
+    for (char c : s)
+    {
+        if (c == '"')
+            out += '"';
+        out += c;
+    }
+    return out + "\"";
+}
+
+static std::string json_escape(const std::string &s)
+{
+    std::string out;
+    for (char c : s)
+    {
+        if (c == '"' || c == '\\')
+            out += '\\';
+        if ((unsigned char)c < 0x20)
+            continue;
+        out += c;
+    }
+    return out;
+}
+
+int write_perf_csv(const PerfReport &report, const std::string &path)
+{
+    FILE *fp = fopen(path.c_str(), "w");
+    if (fp == nullptr) {
+        std::cerr << "Failed to open: " << path << std::endl;
+        return -1;
+    }
+    double total = report.total_us();
+    // 以 # 开头的行记录汇总信息，read_perf_csv 读取
+    fprintf(fp, "# model=%s\n# frames=%d\n# run_us=%.1f\n# total_us=%.1f\n", report.model.c_str(), report.frames,
+            report.run_us, total);
+    fprintf(fp, "id,op_type,target,time_us,share,name\n");
+    for (const auto &l : report.layers)
+        fprintf(fp, "%d,%s,%s,%.2f,%.4f,%s\n", l.id, l.op_type.c_str(), l.target.c_str(), l.time_us,
+                total > 0 ? l.time_us / total : 0.0, csv_quote(l.name).c_str());
+    fclose(fp);
+    return 0;
+}
+
+/**
+ * @Description: 按算子类型汇总：耗时、层数，按耗时从大到小排序
+ */
+static std::vector<std::pair<std::string, std::pair<double, int>>> group_by_op(const PerfReport &report)
+{
+    std::map<std::string, std::pair<double, int>> groups;
+    for (const auto &l : report.layers)
+    {
+        groups[l.op_type].first += l.time_us;
+        groups[l.op_type].second++;
+    }
+    std::vector<std::pair<std::string, std::pair<double, int>>> sorted(groups.begin(), groups.end());
+    std::sort(sorted.begin(), sorted.end(),
+              [](const auto &a, const auto &b) { return a.second.first > b.second.first; });
+    return sorted;
+}
+
+int write_perf_json(const PerfReport &report, const std::string &path)
+{
+    FILE *fp = fopen(path.c_str(), "w");
+    if (fp == nullptr) {
+        std::cerr << "Failed to open: " << path << std::endl;
+        return -1;
+    }
+    double total = report.total_us();
+    fprintf(fp, "{\n  \"model\": \"%s\",\n  \"frames\": %d,\n  \"run_us\": %.1f,\n  \"total_us\": %.1f,\n",
+            json_escape(report.model).c_str(), report.frames, report.run_us, total);
+    fprintf(fp, "  \"op_types\": [\n");
+    auto groups = group_by_op(report);
+    for (size_t i = 0; i < groups.size(); i++)
+        fprintf(fp, "    {\"op_type\": \"%s\", \"count\": %d, \"time_us\": %.2f, \"share\": %.4f}%s\n",
+                json_escape(groups[i].first).c_str(), groups[i].second.second, groups[i].second.first,
+                total > 0 ? groups[i].second.first / total : 0.0, i + 1 < groups.size() ? "," : "");
+    fprintf(fp, "  ],\n  \"layers\": [\n");
+    for (size_t i = 0; i < report.layers.size(); i++)
+    {
+        const LayerPerf &l = report.layers[i];
+        fprintf(fp,
+                "    {\"id\": %d, \"op_type\": \"%s\", \"target\": \"%s\", \"time_us\": %.2f, \"share\": %.4f, "
+                "\"name\": \"%s\"}%s\n",
+                l.id, json_escape(l.op_type).c_str(), json_escape(l.target).c_str(), l.time_us,
+                total > 0 ? l.time_us / total : 0.0, json_escape(l.name).c_str(),
+                i + 1 < report.layers.size() ? "," : "");
+    }
+    fprintf(fp, "  ]\n}\n");
+    fclose(fp);
+    return 0;
+}
+
+int read_perf_csv(const std::string &path, PerfReport &report)
+{
+    std::ifstream ifs(path);
+    if (!ifs) {
+        std::cerr << "Failed to open: " << path << std::endl;
+        return -1;
+    }
+    report = PerfReport();
+    report.model = path;
+    std::string line;
+    while (std::getline(ifs, line))
+    {
+        if (line.empty())
+            continue;
+        if (line[0] == '#') {
+            size_t eq = line.find('=');
+            if (eq == std::string::npos)
+                continue;
+            std::string key = line.substr(2, eq - 2), value = line.substr(eq + 1);
+            if (key == "model")
+                report.model = value;
+            else if (key == "frames")
+                report.frames = atoi(value.c_str());
+            else if (key == "run_us")
+                report.run_us = atof(value.c_str());
+            continue;
+        }
+        if (line.compare(0, 3, "id,") == 0)
+            continue;
+        // 前 5 列不含逗号，最后一列为带引号的名称
+        std::vector<std::string> fields;
+        size_t start = 0;
+        for (int i = 0; i < 5; i++)
+        {
+            size_t comma = line.find(',', start);
+            if (comma == std::string::npos)
+                break;
+            fields.push_back(line.substr(start, comma - start));
+            start = comma + 1;
+        }
+        if (fields.size() != 5)
+            continue;
+        LayerPerf l;
+        l.id = atoi(fields[0].c_str());
+        l.op_type = fields[1];
+        l.target = fields[2];
+        l.time_us = atof(fields[3].c_str());
+        std::string name = line.substr(start);
+        if (name.size() >= 2 && name.front() == '"' && name.back() == '"') {
+            name = name.substr(1, name.size() - 2);
+            size_t pos = 0;
+            while ((pos = name.find("\"\"", pos)) != std::string::npos)
+                name.erase(pos++, 1);
+        }
+        l.name = name;
+        report.layers.push_back(l);
+    }
+    return report.layers.empty() ? -1 : 0;
+}
+
+/**
+ * @Description: 变化百分比，基准为 0 时返回 0
+ */
+static double delta_percent(double base, double test)
+{
+    return base > 0 ? (test - base) * 100.0 / base : 0.0;
+}
+
+void compare_perf_reports(const PerfReport &base, const PerfReport &test)
+{
+    printf("base: %s (%d frames)\n", base.model.c_str(), base.frames);
+    printf("test: %s (%d frames)\n", test.model.c_str(), test.frames);
+    printf("%-24s %12s %12s %12s %9s\n", "", "base(us)", "test(us)", "delta(us)", "delta");
+    printf("%-24s %12.1f %12.1f %12.1f %8.1f%%\n", "rknn_run", base.run_us, test.run_us, test.run_us - base.run_us,
+           delta_percent(base.run_us, test.run_us));
+    printf("%-24s %12.1f %12.1f %12.1f %8.1f%%\n", "sum of layers", base.total_us(), test.total_us(),
+           test.total_us() - base.total_us(), delta_percent(base.total_us(), test.total_us()));
+
+    // 按算子类型汇总，两份结果的算子类型取并集
+    std::map<std::string, std::pair<double, double>> ops;
+    std::map<std::string, std::pair<int, int>> counts;
+    for (const auto &l : base.layers)
+    {
+        ops[l.op_type].first += l.time_us;
+        counts[l.op_type].first++;
+    }
+    for (const auto &l : test.layers)
+    {
+        ops[l.op_type].second += l.time_us;
+        counts[l.op_type].second++;
+    }
+    std::vector<std::string> names;
+    for (const auto &kv : ops)
+        names.push_back(kv.first);
+    std::sort(names.begin(), names.end(), [&ops](const std::string &a, const std::string &b) {
+        return fabs(ops[a].second - ops[a].first) > fabs(ops[b].second - ops[b].first);
+    });
+    printf("\nby op type:\n%-24s %7s %12s %12s %12s %9s\n", "op_type", "layers", "base(us)", "test(us)", "delta(us)",
+           "delta");
+    for (const auto &n : names)
+    {
+        std::string layers = std::to_string(counts[n].first) + "/" + std::to_string(counts[n].second);
+        printf("%-24s %7s %12.1f %12.1f %12.1f %8.1f%%\n", n.c_str(), layers.c_str(), ops[n].first, ops[n].second,
+               ops[n].second - ops[n].first, delta_percent(ops[n].first, ops[n].second));
+    }
+
+    // 逐层对比只在层结构一致（同样的层数和算子类型）时有意义，例如同一模型的两次运行或只改量化的模型
+    bool same = base.layers.size() == test.layers.size();
+    for (size_t i = 0; same && i < base.layers.size(); i++)
+        same = base.layers[i].op_type == test.layers[i].op_type;
+    if (!same) {
+        printf("\nlayer structure differs, per-layer diff skipped\n");
+        return;
+    }
+    std::vector<size_t> order(base.layers.size());
+    for (size_t i = 0; i < order.size(); i++)
+        order[i] = i;
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return fabs(test.layers[a].time_us - base.layers[a].time_us) >
+               fabs(test.layers[b].time_us - base.layers[b].time_us);
+    });
+    const size_t top = std::min<size_t>(20, order.size());
+    printf("\ntop %zu layer changes:\n%6s %-20s %12s %12s %12s %9s  %s\n", top, "id", "op_type", "base(us)",
+           "test(us)", "delta(us)", "delta", "name");
+    for (size_t k = 0; k < top; k++)
+    {
+        const LayerPerf &b = base.layers[order[k]], &t = test.layers[order[k]];
+        printf("%6d %-20s %12.1f %12.1f %12.1f %8.1f%%  %s\n", b.id, b.op_type.c_str(), b.time_us, t.time_us,
+               t.time_us - b.time_us, delta_percent(b.time_us, t.time_us), b.name.c_str());
+    }
+}
+
+int run_perf_compare(const std::string &paths)
+{
+    size_t comma = paths.find(',');
+    if (comma == std::string::npos) {
+        std::cerr << "Error: --compare needs two CSV files: base.csv,test.csv" << std::endl;
+        return -1;
+    }
+    PerfReport base, test;
+    if (read_perf_csv(paths.substr(0, comma), base) != 0 || read_perf_csv(paths.substr(comma + 1), test) != 0)
+        return -1;
+    compare_perf_reports(base, test);
+    return 0;
+}
@@ -0,0 +1,113 @@
+/*
+ * @Author: Li RF
+ * @Date: 2025-04-16 10:05:44
+ * @LastEditors: Li RF
+ * @LastEditTime: 2025-04-16 10:05:44
+ * @Description: NPU 逐层性能分析：以 RKNN_FLAG_COLLECT_PERF_MASK 初始化独立的上下文，合成输入运行若干帧，
+ *               每帧取 RKNN_QUERY_PERF_DETAIL / RKNN_QUERY_PERF_RUN，取平均后输出
+ * Email: 1125962926@qq.com
+ * Copyright (c) 2025 Li RF, All Rights Reserved.
+ */
+#include <string.h>
+#include <iostream>
+#include <memory>
+
+#include "rknn_api.h"
+#include "input_buffer.h"
+#include "model_file.h"
+#include "profiler.h"
+
+int run_profile(const AppConfig &config)
+{
+    if (config.backend != BACKEND_TYPE::BACKEND_RKNN) {
+        std::cerr << "--profile needs the rknn backend" << std::endl;
+        return -1;
+    }
+    ModelFile model;
+    if (model.open(config.model_path) != 0)
+        return -1;
+    rknn_context ctx;
+    // 逐层统计会降低帧率，只用于分析
+    int ret = rknn_init(&ctx, model.data(), model.size(), RKNN_FLAG_COLLECT_PERF_MASK, NULL);
+    model.close();
+    if (ret < 0) {
+        std::cerr << "rknn_init error ret=" << ret << std::endl;
+        return -1;
+    }
+    // 与推理时的核心映射一致：latency 模式三核协同，其余模式单核
+    rknn_set_core_mask(ctx, config.core_mode == CORE_MODE::CORE_LATENCY ? RKNN_NPU_CORE_0_1_2 : RKNN_NPU_CORE_0);
+
+    rknn_input_output_num io_num;
+    rknn_tensor_attr input_attr;
+    memset(&input_attr, 0, sizeof(input_attr));
+    if (rknn_query(ctx, RKNN_QUERY_IN_OUT_NUM, &io_num, sizeof(io_num)) < 0 ||
+        rknn_query(ctx, RKNN_QUERY_INPUT_ATTR, &input_attr, sizeof(input_attr)) < 0) {
+        std::cerr << "rknn_query failed" << std::endl;
+        rknn_destroy(ctx);
+        return -1;
+    }
+    bool nchw = input_attr.fmt == RKNN_TENSOR_NCHW;
+    int channel = nchw ? input_attr.dims[1] : input_attr.dims[3];
+    int height = nchw ? input_attr.dims[2] : input_attr.dims[1];
+    int width = nchw ? input_attr.dims[3] : input_attr.dims[2];
+
+    // 合成输入：整幅填充色，各层耗时与输入内容基本无关
+    HostInputBuffer input_buf(width, height, channel);
+    input_buf.update_letterbox(width, height);
+    rknn_input inputs[1];
+    memset(inputs, 0, sizeof(inputs));
+    inputs[0].index = 0;
+    inputs[0].type = RKNN_TENSOR_UINT8;
+    inputs[0].size = input_buf.size();
+    inputs[0].fmt = RKNN_TENSOR_NHWC;
+    inputs[0].buf = input_buf.data();
+
+    PerfReport report;
+    report.model = config.model_path;
+    std::unique_ptr<rknn_output[]> outputs(new rknn_output[io_num.n_output]);
+    int frames = config.profile_frames;
+    for (int f = 0; f <= frames; f++)
+    {
+        memset(outputs.get(), 0, sizeof(rknn_output) * io_num.n_output);
+        rknn_inputs_set(ctx, io_num.n_input, inputs);
+        ret = rknn_run(ctx, NULL);
+        // PERF_DETAIL / PERF_RUN 需要在 rknn_outputs_get 之后查询
+        if (ret >= 0)
+            ret = rknn_outputs_get(ctx, io_num.n_output, outputs.get(), NULL);
+        if (ret < 0) {
+            std::cerr << "rknn_run error ret=" << ret << std::endl;
+            break;
+        }
+        rknn_perf_detail detail;
+        rknn_perf_run run;
+        memset(&detail, 0, sizeof(detail));
+        memset(&run, 0, sizeof(run));
+        rknn_query(ctx, RKNN_QUERY_PERF_DETAIL, &detail, sizeof(detail));
+        rknn_query(ctx, RKNN_QUERY_PERF_RUN, &run, sizeof(run));
+        rknn_outputs_release(ctx, io_num.n_output, outputs.get());
+
+        // 第一帧包含冷启动开销，不计入
+        if (f == 0)
+            continue;
+        std::vector<LayerPerf> layers;
+        if (parse_perf_detail(detail.perf_data, layers) != 0) {
+            std::cerr << "failed to parse RKNN_QUERY_PERF_DETAIL" << std::endl;
+            if (detail.perf_data != nullptr && config.verbose)
+                std::cout << detail.perf_data << std::endl;
+            break;
+        }
+        if (accumulate_perf(report, layers, run.run_duration) != 0)
+            std::cerr << "layer table changed at frame " << f << ", ignored" << std::endl;
+    }
+    rknn_destroy(ctx);
+    if (report.frames == 0)
+        return -1;
+    finish_perf_report(report);
+
+    std::string csv = config.profile_out + ".csv", json = config.profile_out + ".json";
+    if (write_perf_csv(report, csv) != 0 || write_perf_json(report, json) != 0)
+        return -1;
+    printf("profile: %d frames, rknn_run %.1f us, sum of %zu layers %.1f us -> %s, %s\n", report.frames,
+           report.run_us, report.layers.size(), report.total_us(), csv.c_str(), json.c_str());
+    return 0;
+}
@@ -229,6 +229,18 @@ int FFmpegReader::FFmpeg_yuv420sp_to_bgr(cv::Mat& bgr_frame) {
     return EXIT_SUCCESS;
 }
 
+/**
+ * @Description: 取最近一帧 NV12 的 Y 平面，按 linesize 设置行步长，不拷贝，供运动门控使用
+ * @param {Mat&} luma: 
+ * @return {*}
+ */
+bool FFmpegReader::getLuma(cv::Mat& luma) {
+    if (tempFrame == nullptr || tempFrame->format != AV_PIX_FMT_NV12 || tempFrame->data[0] == nullptr)
+        return false;
+    luma = cv::Mat(tempFrame->height, tempFrame->width, CV_8UC1, tempFrame->data[0], tempFrame->linesize[0]);
+    return true;
+}
+
 /**
  * @Description: 将 AVFrame 内的数据，转换为 OpenCV Mat 格式保存
  * @param {Mat&} frame: 
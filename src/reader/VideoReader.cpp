@@ -84,6 +84,15 @@ bool VideoReader::readFrame(cv::Mat& frame) {
     return reader_ptr->readFrame(frame);
 }
 
+/**
+ * @Description: 最近一帧的亮度平面（FFmpeg 引擎为解码得到的 NV12 Y 平面）
+ * @param {Mat&} luma: 
+ * @return {*}
+ */
+bool VideoReader::getLuma(cv::Mat& luma) {
+    return reader_ptr->getLuma(luma);
+}
+
 /**
  * @Description: 关闭视频文件并释放资源
  * @return {*}
@@ -1,447 +1,399 @@
 #include <stdio.h>
+#include <algorithm>
 #include <iostream>
 #include <mutex>
 #include <memory>
 #include <fstream>
 #include <vector>
-#include "rknn_api.h"
 
 #include "opencv2/core/core.hpp"
 #include "opencv2/highgui/highgui.hpp"
 #include "opencv2/imgproc/imgproc.hpp"
 
+#include "alloc_trace.h"
 #include "postprocess.h"
 #include "preprocess.h"
 #include "rkYolo.hpp"
 
 /**
- * @Description: 设置模型需要绑定的核心
+ * @Description: 构造函数，按配置创建推理后端
+ * @param {AppConfig&} config: 
  * @return {*}
  */
-static int get_core_num() {
-    static int core_num = 0;
-    static std::mutex mtx;
-
-    std::lock_guard<std::mutex> lock(mtx);
-
-    int temp = core_num % NPU_CORE_NUM;
-    core_num++;
-    return temp;
+rkYolo::rkYolo(const AppConfig& config) {
+    this->config = config;           // 配置参数
+    nms_threshold = NMS_THRESH;      // 默认的NMS阈值
+    box_conf_threshold = BOX_THRESH; // 默认的置信度阈值
+    backend = create_inference_backend(config);
 }
 
 /**
- * @Description: 打印 tensor 的格式
- * @param {rknn_tensor_attr} *attr: 
+ * @Description: 每个线程都要执行一次，初始化模型
+ * @param {InferenceBackend} *first: 第一个上下文的后端
+ * @param {bool} share: 是否共享 first 的权重（为 false 时也代表此时为第一个线程）
  * @return {*}
  */
-static void dump_tensor_attr(rknn_tensor_attr *attr) {
-    std::string shape_str = attr->n_dims < 1 ? "" : std::to_string(attr->dims[0]);
-    for (int i = 1; i < attr->n_dims; ++i)
-    {
-        shape_str += ", " + std::to_string(attr->dims[i]);
+int rkYolo::init(InferenceBackend *first, bool share) {
+    timeline.begin = std::chrono::steady_clock::now();
+    if (!backend) {
+        std::cerr << "unsupported backend: " << backend_name(this->config.backend) << std::endl;
+        return -1;
+    }
+    // 只需要第一个线程打印
+    bool verbose = !share;
+    if (backend->init(share ? first : nullptr, verbose) != 0) {
+        std::cerr << backend->name() << " backend init failed" << std::endl;
+        return -1;
+    }
+    timeline.loaded = std::chrono::steady_clock::now();
+
+    width = backend->get_input_width();
+    height = backend->get_input_height();
+    channel = backend->get_input_channel();
+    n_output = backend->get_outputs().size();
+
+    // 根据模型自定义字符串或输出形状选择检测头，类别数和标签也来自模型
+    decoder = create_head_decoder(backend->get_outputs(), height, width, backend->get_custom_string().c_str(),
+                                  this->config.logits, verbose);
+    if (!decoder) {
+        std::cerr << "create_head_decoder failed" << std::endl;
+        return -1;
     }
 
-    printf("  index=%d, name=%s, n_dims=%d, dims=[%s], n_elems=%d, size=%d, w_stride = %d, size_with_stride=%d, fmt=%s, "
-           "type=%s, qnt_type=%s, "
-           "zp=%d, scale=%f\n",
-           attr->index, attr->name, attr->n_dims, shape_str.c_str(), attr->n_elems, attr->size, attr->w_stride,
-           attr->size_with_stride, get_format_string(attr->fmt), get_type_string(attr->type),
-           get_qnt_type_string(attr->qnt_type), attr->zp, attr->scale);
-}
+    // 按检测头的网格尺寸预先分配后处理工作区，推理时不再申请内存
+    pp_ws.init(decoder->max_candidates(), decoder->max_survivors());
+
+    // 动态形状模型：初始化时为面积最大的形状，后处理工作区按它分配，之后切换到更小的形状时无需重新分配
+    dynamic_shape = backend->dynamic_shape();
+
+    input_buf = backend->create_input_buffer(verbose);
+    if (this->config.async) {
+        async = backend->supports_async();
+        // 双缓冲：第二块输入缓冲区，输出的第二组由后端管理
+        if (async)
+            input_buf_alt = backend->create_input_buffer(false);
+        if (verbose)
+            cout << (async ? "async mode: double buffered, results are returned one frame later"
+                           : "async mode unsupported by this backend, run synchronously") << endl;
+    }
 
-/*static unsigned char *load_data(FILE *fp, size_t ofst, size_t sz)
-{
-    unsigned char *data;
-    int ret;
+    // 录制输出，供 replay 后端回放
+    if (!this->config.record_dir.empty() && !share && record_meta(this->config.record_dir, *backend) != 0)
+        return -1;
+    timeline.queried = std::chrono::steady_clock::now();
 
-    data = NULL;
+    // 预热：首帧不再承担 NPU 冷启动、cache 和后处理查找表的首次访问开销
+    if (this->config.warmup > 0 && warmup(this->config.warmup) != 0)
+        cout << backend->name() << " context warmup failed" << endl;
+    timeline.warmed = std::chrono::steady_clock::now();
 
-    if (NULL == fp)
-    {
-        return NULL;
-    }
+    return 0;
+}
 
-    ret = fseek(fp, ofst, SEEK_SET);
-    if (ret != 0)
+/**
+ * @Description: 用合成输入（整幅填充色图像）运行若干次完整的推理和后处理
+ * @param {int} runs: 次数
+ * @return {int}: 0 成功
+ */
+int rkYolo::warmup(int runs) {
+    input_buf->update_letterbox(width, height);
+    for (int r = 0; r < runs; r++)
     {
-        printf("blob seek failure.\n");
-        return NULL;
+        int8_t *out_bufs[n_output];
+        if (async) {
+            // 异步上下文走与 infer 相同的提交 / 等待路径
+            if (backend->submit(*input_buf) != 0 || backend->collect(out_bufs) != 0)
+                return -1;
+        }
+        else if (backend->run(*input_buf, out_bufs) != 0) {
+            return -1;
+        }
+        detect_result_group_t detect_result_group;
+        post_process(decoder.get(), out_bufs, box_conf_threshold, nms_threshold, input_buf->get_pads(),
+                     input_buf->get_scale(), input_buf->get_scale(), this->config.nms_mode, &pp_ws,
+                     &detect_result_group);
+        pp_frames++;
+        if (!async)
+            backend->release_outputs();
     }
+    return 0;
+}
 
-    data = (unsigned char *)malloc(sz);
-    if (data == NULL)
-    {
-        printf("buffer malloc failure.\n");
-        return NULL;
+/**
+ * @Description: 源图尺寸变化时让后端按宽高比重新选择输入形状；形状切换后按当前形状重建检测头解码器（网格尺寸）
+ *               和输入缓冲区，调用时上下文必须空闲
+ * @param {int} src_w: 源图宽度
+ * @param {int} src_h: 源图高度
+ * @return {int}: 0 成功
+ */
+int rkYolo::update_input_shape(int src_w, int src_h) {
+    if (src_w == shape_src_w && src_h == shape_src_h)
+        return 0;
+    shape_src_w = src_w;
+    shape_src_h = src_h;
+    ret = backend->select_input_shape(src_w, src_h);
+    if (ret <= 0)
+        return ret;
+
+    width = backend->get_input_width();
+    height = backend->get_input_height();
+    decoder = create_head_decoder(backend->get_outputs(), height, width, backend->get_custom_string().c_str(),
+                                  this->config.logits, false);
+    if (!decoder) {
+        std::cerr << "create_head_decoder failed" << std::endl;
+        return -1;
+    }
+    // 旧的输入缓冲区按原形状分配（零拷贝时还绑定在上下文上），先释放再创建
+    input_buf.reset();
+    input_buf = backend->create_input_buffer(false);
+    if (async) {
+        input_buf_alt.reset();
+        input_buf_alt = backend->create_input_buffer(false);
     }
-    ret = fread(data, 1, sz, fp);
-    return data;
+    // 录制的 meta.txt 只描述一种输出形状
+    if (!this->config.record_dir.empty()) {
+        cout << "input shape changed, stop recording" << endl;
+        this->config.record_dir.clear();
+    }
+    return 0;
 }
 
-static unsigned char *load_model(const char *filename, int *model_size)
+InferenceBackend *rkYolo::get_pctx()
 {
-    FILE *fp;
-    unsigned char *data;
-
-    fp = fopen(filename, "rb");
-    if (NULL == fp)
-    {
-        printf("Open file %s failed.\n", filename);
-        return NULL;
-    }
-
-    fseek(fp, 0, SEEK_END);
-    int size = ftell(fp);
-
-    data = load_data(fp, 0, size);
-
-    fclose(fp);
-
-    *model_size = size;
-    return data;
-}*/
+    return backend.get();
+}
 
-// （）
 /**
- * @Description: 获取文件大小
- * @param {string&} filename: 
- * @return {size_t}: 返回字节数，失败返回0
+ * @Description: 前处理：源图尺寸变化时重新计算 letterbox 并填充边框，尺寸不变时只重写内容区域
+ *               YOLO 推理需要 RGB 格式，后处理绘制需要 BGR 格式：换通道在写入输入缓冲区时完成，orig_img 保持 BGR
+ * @param {Mat} &orig_img: BGR 源图
+ * @param {InputBuffer} &buf: 写入的输入缓冲区
+ * @return {int}: 0 成功
  */
-static size_t get_file_size(const std::string& filename) {
-    // std::ios::ate：打开文件后立即将文件指针移动到文件末尾（at end）
-    std::ifstream ifs(filename, std::ios::binary | std::ios::ate);
-    if (!ifs.is_open())
-        return 0;
-    
-    // 通过文件尾定位获取大小
-    size_t size = ifs.tellg();
-    ifs.close();
-    return size;
+int rkYolo::preprocess(const cv::Mat &orig_img, InputBuffer &buf) {
+    buf.update_letterbox(orig_img.cols, orig_img.rows);
+    if (this->config.accels_2d == ACCELS_2D::ACC_OPENCV) {
+        ret = buf.write_letterbox(orig_img, this->config.opencl);
+    }
+    else if (this->config.accels_2d == ACCELS_2D::ACC_RGA) {
+        ret = RGA_letterbox_into(orig_img, buf);
+    }
+    else {
+        cout << "Unsupported 2D acceleration" << endl;
+        return -1;
+    }
+    if (ret != 0) {
+        cout << "preprocess error" << endl;
+        return -1;
+    }
+    return 0;
 }
 
 /**
- * @Description: 加载文件数据
- * @param {ifstream&} ifs: 
- * @param {size_t} offset: 
- * @param {unsigned char*} buffer: 
- * @param {size_t} size: 
+ * @Description: 后处理：解码、NMS，结果换算回源图坐标
+ * @param {int8_t} **out_bufs: 该帧的模型输出
+ * @param {InputBuffer} &buf: 该帧使用的输入缓冲区，提供 letterbox 的填充和缩放比例
+ * @param {detect_result_group_t} *group: 输出
  * @return {*}
  */
-static bool load_data(std::ifstream& ifs, size_t offset, unsigned char* buffer, size_t size) {
-    if (!ifs.is_open()) {
-        std::cerr << "File stream not open" << std::endl;
-        return false;
-    }
-    // 定位到指定位置
-    ifs.seekg(offset, std::ios::beg);
-    if (ifs.fail()) {
-        std::cerr << "Seek failed at offset " << offset << std::endl;
-        return false;
-    }
-
-    ifs.read(reinterpret_cast<char*>(buffer), size);
-    // ifs.gcount()：返回实际读取的字节数
-    if (ifs.gcount() != static_cast<std::streamsize>(size)) {
-        std::cerr << "Read failed, expected " << size << " bytes, got " << ifs.gcount() << std::endl;
-        return false;
-    }
-    return true;
+void rkYolo::postprocess(int8_t **out_bufs, const InputBuffer &buf, detect_result_group_t *group) {
+    BOX_RECT pads = buf.get_pads();
+    float scale_w = buf.get_scale();
+    float scale_h = buf.get_scale();
+
+#ifdef ALLOC_TRACE
+    uint64_t alloc_before = alloc_trace_count();
+#endif
+    post_process(decoder.get(), out_bufs, box_conf_threshold, nms_threshold, pads, scale_w, scale_h,
+                 this->config.nms_mode, &pp_ws, group);
+    pp_frames++;
+#ifdef ALLOC_TRACE
+    // 预热之后后处理不应再有任何分配
+    uint64_t allocs = alloc_trace_count() - alloc_before;
+    if (pp_frames > ALLOC_TRACE_WARMUP_FRAMES && allocs != 0)
+        printf("[ALLOC_TRACE] frame %llu: post_process allocated %llu times\n", (unsigned long long)pp_frames,
+               (unsigned long long)allocs);
+#endif
 }
 
 /**
- * @Description: 加载模型
- * @param {string} &filename: 
- * @param {unsigned char} *buffer: 
- * @param {size_t&} buffer_size: 
+ * @Description: 在图上绘制检测框和标签
+ * @param {Mat} &img: BGR 图像，直接在上面绘制
+ * @param {detect_result_group_t} &group: 该图坐标的检测结果
  * @return {*}
  */
-static bool load_model(const std::string &filename, unsigned char *buffer, const size_t& buffer_size) {
-    // std::ios::binary：以二进制模式打开文件
-    std::ifstream ifs(filename, std::ios::binary);
-    if (!ifs)
-    {
-        std::cerr << "Failed to open: " << filename << std::endl;
-        return false;
-    }
-    if (buffer_size == 0)
+void rkYolo::draw(cv::Mat &img, const detect_result_group_t &group) {
+    char text[256];
+    for (int i = 0; i < group.count; i++)
     {
-        std::cerr << "Failed to open: " << filename << std::endl;
-        return false;
+        const detect_result_t *det_result = &(group.results[i]);
+        int n;
+        if (det_result->track_id >= 0)
+            n = sprintf(text, "%s #%d %.1f%%", det_result->name, det_result->track_id, det_result->prop * 100);
+        else
+            n = sprintf(text, "%s %.1f%%", det_result->name, det_result->prop * 100);
+        // 二级分类器的属性
+        if (det_result->attr[0] != '\0')
+            snprintf(text + n, sizeof(text) - n, " %s", det_result->attr);
+        // 打印预测物体的信息/Prints information about the predicted object
+        // printf("%s @ (%d %d %d %d) %f\n", det_result->name, det_result->box.left, det_result->box.top,
+        //        det_result->box.right, det_result->box.bottom, det_result->prop);
+        int x1 = det_result->box.left;
+        int y1 = det_result->box.top;
+        int x2 = det_result->box.right;
+        int y2 = det_result->box.bottom;
+        // rectangle 和 putText 需要 BGR 格式，光流传播的框用细的黄框区分
+        if (det_result->propagated)
+            rectangle(img, cv::Point(x1, y1), cv::Point(x2, y2), cv::Scalar(0, 255, 255), 1);
+        else
+            rectangle(img, cv::Point(x1, y1), cv::Point(x2, y2), cv::Scalar(256, 0, 0, 256), 3);
+        putText(img, text, cv::Point(x1, y1 + 12), cv::FONT_HERSHEY_SIMPLEX, 0.4, cv::Scalar(255, 255, 255));
     }
-
-    return load_data(ifs, 0, buffer, buffer_size);
 }
 
 /**
- * @Description: 构造函数
- * @param {AppConfig&} config: 
+ * @Description: 后处理并在原图上绘制检测框
+ * @param {Mat} &orig_img: BGR 源图，直接在上面绘制
+ * @param {int8_t} **out_bufs: 该帧的模型输出
+ * @param {InputBuffer} &buf: 该帧使用的输入缓冲区
  * @return {*}
  */
-rkYolo::rkYolo(const AppConfig& config) {
-    this->config = config;           // 配置参数
-    nms_threshold = NMS_THRESH;      // 默认的NMS阈值
-    box_conf_threshold = BOX_THRESH; // 默认的置信度阈值
+void rkYolo::postprocess_draw(cv::Mat &orig_img, int8_t **out_bufs, const InputBuffer &buf) {
+    detect_result_group_t detect_result_group;
+    postprocess(out_bufs, buf, &detect_result_group);
+    draw(orig_img, detect_result_group);
 }
 
 /**
- * @Description: 每个线程都要执行一次，初始化模型
- * @param {rknn_context} *ctx_in: 
- * @param {bool} share_weight: 
+ * @Description: 录制该帧的输出，失败时停止录制
+ * @param {int8_t} **out_bufs: 该帧的模型输出
  * @return {*}
  */
-int rkYolo::init(rknn_context *ctx_in, bool share_weight) {
-    // std::cout << "Loading model..." << std::endl;
-    
-    // 模型参数复用（为 false 时也代表此时为第一个线程）
-    if (share_weight == true)
-        ret = rknn_dup_context(ctx_in, &ctx);
-    else {
-        size_t file_size = get_file_size(this->config.model_path);
-        if (file_size == 0) {
-            std::cerr << "Failed to get file size" << std::endl;
-            return -1;
-        }
-        // 模型数据缓冲区
-        unsigned char* model_data = new unsigned char[file_size];
-        if (!load_model(this->config.model_path, model_data, file_size)) {
-            std::cerr << "Failed to load model" << std::endl;
-            delete[] model_data;
-            return -1;
-        }
-        ret = rknn_init(&ctx, model_data, file_size, 0, NULL);
-        delete[] model_data;
-    }
-        
-    if (ret < 0) {
-        std::cerr << "rknn_init error ret=" << ret << std::endl;
-        return -1;
-    }
-
-    // 设置模型绑定的核心
-    rknn_core_mask core_mask;
-    switch (get_core_num()) {
-    case 0:
-        core_mask = RKNN_NPU_CORE_0;
-        break;
-    case 1:
-        core_mask = RKNN_NPU_CORE_1;
-        break;
-    case 2:
-        core_mask = RKNN_NPU_CORE_2;
-        break;
-    }
-    ret = rknn_set_core_mask(ctx, core_mask);
-    if (ret < 0) {
-        std::cerr << "rknn_set_core_mask error ret=" << ret << std::endl;
-        return -1;
-    }
-
-    rknn_sdk_version version;
-    ret = rknn_query(ctx, RKNN_QUERY_SDK_VERSION, &version, sizeof(rknn_sdk_version));
-    if (ret < 0) {
-        std::cerr << "rknn_init error ret=" << ret << std::endl;
-        return -1;
-    }
-    // 只需要第一个线程打印
-    if (!share_weight)
-        cout << "sdk version: " << version.api_version << " driver version: " << version.drv_version << endl;
-
-    // 获取模型输入输出参数
-    ret = rknn_query(ctx, RKNN_QUERY_IN_OUT_NUM, &io_num, sizeof(io_num));
-    if (ret < 0) {
-        std::cerr << "rknn_init error ret=" << ret << std::endl;
-        return -1;
-    }
-    // 只需要第一个线程打印
-    if (!share_weight)
-        cout << "model input num: " << io_num.n_input << ", output num: " << io_num.n_output << endl;
+void rkYolo::record(int8_t **out_bufs) {
+    if (this->config.record_dir.empty())
+        return;
+    if (record_frame(this->config.record_dir, *backend, out_bufs) != 0)
+        this->config.record_dir.clear();
+}
 
-    // 设置输入参数
-    // input_attrs = (rknn_tensor_attr *)calloc(io_num.n_input, sizeof(rknn_tensor_attr));
-    input_attrs = std::make_unique<rknn_tensor_attr[]>(io_num.n_input);
-    for (int i = 0; i < io_num.n_input; i++)
-    {
-        input_attrs[i].index = i;
-        ret = rknn_query(ctx, RKNN_QUERY_INPUT_ATTR, &(input_attrs[i]), sizeof(rknn_tensor_attr));
-        if (ret < 0) {
-            cout << "rknn_query input attr failed" << endl;
-            return -1;
-        }
-        // dump_tensor_attr(&(input_attrs[i]));
-    }
+cv::Mat rkYolo::infer(cv::Mat orig_img)
+{
+    std::lock_guard<std::mutex> lock(mtx);
 
-    // 设置输出参数
-    // output_attrs = (rknn_tensor_attr *)calloc(io_num.n_output, sizeof(rknn_tensor_attr));
-    output_attrs = std::make_unique<rknn_tensor_attr[]>(io_num.n_output); 
-    for (int i = 0; i < io_num.n_output; i++)
-    {
-        output_attrs[i].index = i;
-        ret = rknn_query(ctx, RKNN_QUERY_OUTPUT_ATTR, &(output_attrs[i]), sizeof(rknn_tensor_attr));
-        // dump_tensor_attr(&(output_attrs[i]));
-    }
+    if (async)
+        return infer_async(orig_img);
 
-    if (input_attrs[0].fmt == RKNN_TENSOR_NCHW) {
-        // 只需要第一个线程打印
-        if (!share_weight)
-            cout << "model input fmt is NCHW" << endl;
-        channel = input_attrs[0].dims[1];
-        height = input_attrs[0].dims[2];
-        width = input_attrs[0].dims[3];
-    }
-    else {
-        // 只需要第一个线程打印
-        if (!share_weight)
-            cout << "model input fmt is NHWC" << endl;
-        height = input_attrs[0].dims[1];
-        width = input_attrs[0].dims[2];
-        channel = input_attrs[0].dims[3];
-    }
-    // 只需要第一个线程打印
-    if (!share_weight)
-        cout << "model input height=" << height << ", width=" << width << ", channel=" << channel << endl;
+    if (dynamic_shape && update_input_shape(orig_img.cols, orig_img.rows) != 0)
+        return cv::Mat();
+    if (preprocess(orig_img, *input_buf) != 0)
+        return cv::Mat();
 
-    memset(inputs, 0, sizeof(inputs));
-    inputs[0].index = 0;
-    inputs[0].type = RKNN_TENSOR_UINT8;
-    inputs[0].size = width * height * channel;
-    inputs[0].fmt = RKNN_TENSOR_NHWC;
-    inputs[0].pass_through = 0;
+    // 模型推理，输出在 release_outputs 之前有效
+    int8_t *out_bufs[n_output];
+    if (backend->run(*input_buf, out_bufs) != 0)
+        return cv::Mat();
+    record(out_bufs);
 
-    return 0;
-}
+    postprocess_draw(orig_img, out_bufs, *input_buf);
 
-rknn_context *rkYolo::get_pctx()
-{
-    return &ctx;
+    backend->release_outputs();
+    return orig_img;
 }
 
-cv::Mat rkYolo::infer(cv::Mat orig_img)
-{
+/**
+ * @Description: 同步检测一幅图，用于分块推理和运动门控：每块可能来自不同的源图区域，letterbox 几何随块的尺寸更新
+ *               分块时动态形状模型保持当前形状，避免块与整帧块交替时反复切换
+ * @param {Mat} &img: BGR 图像，可以是整帧的 ROI
+ * @param {detect_result_group_t} *group: 输出，img 坐标
+ * @param {bool} select_shape: 动态形状模型按 img 的宽高比选择输入形状
+ * @return {int}: 0 成功
+ */
+int rkYolo::detect(const cv::Mat &img, detect_result_group_t *group, bool select_shape) {
     std::lock_guard<std::mutex> lock(mtx);
-    // 创建需要 resize 的空图像，这里只申明，不申请内存
-    cv::Mat resized_img;
-    // 创建 rgb 空图像
-    cv::Mat rgb_img(orig_img.rows, orig_img.cols, CV_8UC3);
-
-    BOX_RECT pads;
-    memset(&pads, 0, sizeof(BOX_RECT));
 
-    // YOLO 推理需要 RGB 格式，后处理需要 BGR 格式
-    // 即使前处理时提前转换为 RGB，后处理部分任然需要转换为 BGR，需要在本函数中保留两种格式
-    if (this->config.accels_2d == ACCELS_2D::ACC_OPENCV) {
-        cv::cvtColor(orig_img, rgb_img, cv::COLOR_BGR2RGB);
-    }
-    else if (this->config.accels_2d == ACCELS_2D::ACC_RGA) {
-        if (RGA_bgr_to_rgb(orig_img, rgb_img) != 0) {
-            cout << "RGA_bgr_to_rgb error" << endl;
-            return cv::Mat();
-        }
-    }
-    else {
-        cout << "Unsupported 2D acceleration" << endl;
-        return cv::Mat();
-    }
-    
-    // 计算缩放比例
-    float scale_w = (float)width / rgb_img.cols;
-    float scale_h = (float)height / rgb_img.rows;
+    group->count = 0;
+    if (select_shape && dynamic_shape && update_input_shape(img.cols, img.rows) != 0)
+        return -1;
+    if (preprocess(img, *input_buf) != 0)
+        return -1;
+    int8_t *out_bufs[n_output];
+    if (backend->run(*input_buf, out_bufs) != 0)
+        return -1;
+    record(out_bufs);
+    postprocess(out_bufs, *input_buf, group);
+    backend->release_outputs();
+    return 0;
+}
 
-    // 图像缩放
-    if (orig_img.cols != width || orig_img.rows != height)
-    {
-        // 如果需要缩放，再对 resized_img 申请大小，节约内存开销
-        resized_img.create(height, width, CV_8UC3);
-        if (this->config.accels_2d == ACCELS_2D::ACC_OPENCV)
-        {
-            // 打包模型输入尺寸
-            cv::Size target_size(width, height);
-            float min_scale = std::min(scale_w, scale_h);
-			scale_w = min_scale;
-			scale_h = min_scale;
-			letterbox(rgb_img, resized_img, pads, min_scale, target_size, this->config.opencl);
-        }
-        else if (this->config.accels_2d == ACCELS_2D::ACC_RGA)
-        {
-            ret = RGA_resize(rgb_img, resized_img);
-            if (ret != 0) {
-                cout << "resize_rga error" << endl;
-            }
-        }
-        else {
-            cout << "Unsupported 2D acceleration" << endl;
-            return cv::Mat();
-        }
-        inputs[0].buf = resized_img.data;
-    }
-    else
-    {
-        inputs[0].buf = rgb_img.data;
-    }
-    
-    rknn_inputs_set(ctx, io_num.n_input, inputs);
-    
-    rknn_output outputs[io_num.n_output];
-    memset(outputs, 0, sizeof(outputs));
-    for (int i = 0; i < io_num.n_output; i++)
-    {
-        outputs[i].want_float = 0;
+/**
+ * @Description: 异步推理：当前帧写入空闲的缓冲区并提交，后端运行期间对上一帧做后处理和绘制
+ *               前处理与上一帧的运行重叠，后处理与当前帧的运行重叠，一个上下文即可让 NPU 保持忙碌
+ * @param {Mat} &orig_img: 当前帧
+ * @return {Mat}: 上一帧的绘制结果，第一帧返回空图；切换输入形状时为切换前取回的一帧
+ */
+cv::Mat rkYolo::infer_async(cv::Mat &orig_img) {
+    // 0. 动态形状模型的源图尺寸变化：先按旧形状取回上一帧，上下文空闲后再切换形状
+    cv::Mat drained;
+    if (dynamic_shape && (orig_img.cols != shape_src_w || orig_img.rows != shape_src_h)) {
+        drained = drain();
+        if (update_input_shape(orig_img.cols, orig_img.rows) != 0)
+            return drained;
     }
 
-    // 模型推理
-    ret = rknn_run(ctx, NULL);
-    ret = rknn_outputs_get(ctx, io_num.n_output, outputs, NULL);
-
-    // 后处理
-    detect_result_group_t detect_result_group;
-    std::vector<float> out_scales;
-    std::vector<int32_t> out_zps;
-    for (int i = 0; i < io_num.n_output; ++i)
-    {
-        out_scales.push_back(output_attrs[i].scale);
-        out_zps.push_back(output_attrs[i].zp);
+    // 1. 前处理写入空闲的一块，此时 NPU 可能仍在处理上一帧
+    if (preprocess(orig_img, *input_buf_alt) != 0)
+        return drained;
+
+    // 2. 等待上一帧完成并取得输出
+    cv::Mat prev_img;
+    std::swap(prev_img, pending_img);
+    int8_t *out_bufs[n_output];
+    bool has_prev = pending && backend->collect(out_bufs) == 0;
+    pending = false;
+
+    // 3. 提交当前帧，后端切换到另一组输出，上一帧的输出在下一次 collect 之前保持有效
+    if (backend->submit(*input_buf_alt) == 0) {
+        pending = true;
+        pending_img = orig_img;
     }
-    post_process((int8_t *)outputs[0].buf, (int8_t *)outputs[1].buf, (int8_t *)outputs[2].buf, height, width,
-                 box_conf_threshold, nms_threshold, pads, scale_w, scale_h, out_zps, out_scales, &detect_result_group);
 
-    // 绘制框体
-    char text[256];
-    for (int i = 0; i < detect_result_group.count; i++)
-    {
-        detect_result_t *det_result = &(detect_result_group.results[i]);
-        sprintf(text, "%s %.1f%%", det_result->name, det_result->prop * 100);
-        // 打印预测物体的信息/Prints information about the predicted object
-        // printf("%s @ (%d %d %d %d) %f\n", det_result->name, det_result->box.left, det_result->box.top,
-        //        det_result->box.right, det_result->box.bottom, det_result->prop);
-        int x1 = det_result->box.left;
-        int y1 = det_result->box.top;
-        int x2 = det_result->box.right;
-        int y2 = det_result->box.bottom;
-        // rectangle 和 putText 需要 BGR 格式
-        rectangle(orig_img, cv::Point(x1, y1), cv::Point(x2, y2), cv::Scalar(256, 0, 0, 256), 3);
-        putText(orig_img, text, cv::Point(x1, y1 + 12), cv::FONT_HERSHEY_SIMPLEX, 0.4, cv::Scalar(255, 255, 255));
+    // 4. 当前帧运行期间处理上一帧，上一帧的输入几何在交换前的一块中
+    if (has_prev) {
+        record(out_bufs);
+        postprocess_draw(prev_img, out_bufs, *input_buf);
     }
 
-    ret = rknn_outputs_release(ctx, io_num.n_output, outputs);
-    return orig_img;
+    // 5. 交换两块输入缓冲区，刚提交的一块成为当前块
+    if (pending)
+        std::swap(input_buf, input_buf_alt);
+    return has_prev ? prev_img : drained;
 }
 
-rkYolo::~rkYolo()
+cv::Mat rkYolo::flush()
 {
-    ret = rknn_destroy(ctx);
-    if (ret < 0) {
-        cout << "rknn_destroy fail! ret=" << ret << endl;
-    }
+    std::lock_guard<std::mutex> lock(mtx);
+    return drain();
+}
 
-    // 更新为智能指针
-    /*if (input_attrs)
-    {
-        free(input_attrs);
-        input_attrs = nullptr;
-    }
+cv::Mat rkYolo::drain()
+{
+    if (!pending)
+        return cv::Mat();
+    pending = false;
+    cv::Mat done;
+    std::swap(done, pending_img);
+    int8_t *out_bufs[n_output];
+    if (backend->collect(out_bufs) != 0)
+        return cv::Mat();
+    record(out_bufs);
+    postprocess_draw(done, out_bufs, *input_buf);
+    return done;
+}
 
-    if (output_attrs)
-    {
-        free(output_attrs);
-        output_attrs = nullptr;
-    }*/
+rkYolo::~rkYolo()
+{
+    // 零拷贝的输入内存属于后端的上下文，需要在后端销毁之前释放
+    input_buf.reset();
+    input_buf_alt.reset();
+    backend.reset();
 }
@@ -0,0 +1,124 @@
+/*
+ * @Author: Li RF
+ * @Date: 2025-04-18 10:05:37
+ * @LastEditors: Li RF
+ * @LastEditTime: 2025-04-18 10:05:37
+ * @Description: 分块布局与跨块合并，不依赖 NPU
+ * Email: 1125962926@qq.com
+ * Copyright (c) 2025 Li RF, All Rights Reserved.
+ */
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+
+#include "tiling.h"
+
+/**
+ * @Description: 一个方向上的分块：块数与块长，count 为 0 时块长取模型输入边长
+ * @param {int} src: 源图边长
+ * @param {int} model: 模型输入边长
+ * @param {int} &count: 块数，0 为自动，返回实际块数
+ * @param {float} overlap: 重叠比例
+ * @return {int}: 块长
+ */
+static int tile_axis(int src, int model, int &count, float overlap)
+{
+    if (count <= 0) {
+        if (src <= model) {
+            count = 1;
+            return src;
+        }
+        // 相邻两块的起点间隔不超过 model * (1 - overlap)
+        float step = std::max(1.f, model * (1.f - overlap));
+        count = 1 + (int)ceilf((src - model) / step);
+        return model;
+    }
+    // count 块、每两块重叠 overlap 覆盖整条边：len * (count - (count - 1) * overlap) = src
+    int len = (int)ceilf(src / (count - (count - 1) * overlap));
+    return std::min(src, len);
+}
+
+std::vector<tile_t> make_tiles(int src_w, int src_h, int model_w, int model_h, int cols, int rows, float overlap,
+                               bool full_frame)
+{
+    overlap = std::min(0.9f, std::max(0.f, overlap));
+    int tile_w = tile_axis(src_w, model_w, cols, overlap);
+    int tile_h = tile_axis(src_h, model_h, rows, overlap);
+
+    std::vector<tile_t> tiles;
+    for (int r = 0; r < rows; r++)
+    {
+        // 均匀分布，首尾贴齐边缘，实际重叠不小于要求的比例
+        int y = rows > 1 ? (int)((long long)(src_h - tile_h) * r / (rows - 1)) : 0;
+        for (int c = 0; c < cols; c++)
+        {
+            int x = cols > 1 ? (int)((long long)(src_w - tile_w) * c / (cols - 1)) : 0;
+            tiles.push_back({cv::Rect(x, y, tile_w, tile_h), false});
+        }
+    }
+    if (full_frame && tiles.size() > 1)
+        tiles.push_back({cv::Rect(0, 0, src_w, src_h), true});
+    return tiles;
+}
+
+int merge_tile_detections(const std::vector<tile_t> &tiles, const detect_result_group_t *groups, int src_w,
+                          int src_h, int nms_mode, float nms_threshold, TileMergeWorkspace &ws,
+                          detect_result_group_t *merged)
+{
+    ws.boxes.clear();
+    ws.scores.clear();
+    ws.class_ids.clear();
+    ws.sources.clear();
+    ws.names.clear();
+    for (size_t t = 0; t < tiles.size(); t++)
+    {
+        const cv::Rect &r = tiles[t].rect;
+        // 块的四条边中不在源图边缘上的是内部切边
+        bool cut_left = !tiles[t].full && r.x > 0;
+        bool cut_top = !tiles[t].full && r.y > 0;
+        bool cut_right = !tiles[t].full && r.x + r.width < src_w;
+        bool cut_bottom = !tiles[t].full && r.y + r.height < src_h;
+        int margin_x = std::max(1, (int)(r.width * TILE_EDGE_MARGIN));
+        int margin_y = std::max(1, (int)(r.height * TILE_EDGE_MARGIN));
+        for (int i = 0; i < groups[t].count; i++)
+        {
+            const detect_result_t &det = groups[t].results[i];
+            const BOX_RECT &b = det.box;
+            if ((cut_left && b.left <= margin_x) || (cut_top && b.top <= margin_y) ||
+                (cut_right && b.right >= r.width - 1 - margin_x) || (cut_bottom && b.bottom >= r.height - 1 - margin_y))
+                continue;
+
+            // 按类别名编号，同名即同类
+            int id = 0;
+            while (id < (int)ws.names.size() && strncmp(ws.names[id], det.name, OBJ_NAME_MAX_SIZE) != 0)
+                id++;
+            if (id == (int)ws.names.size())
+                ws.names.push_back(det.name);
+
+            ws.boxes.push_back((float)(b.left + r.x));
+            ws.boxes.push_back((float)(b.top + r.y));
+            ws.boxes.push_back((float)(b.right - b.left));
+            ws.boxes.push_back((float)(b.bottom - b.top));
+            ws.scores.push_back(det.prop);
+            ws.class_ids.push_back(id);
+            ws.sources.push_back(&det);
+        }
+    }
+
+    int count = (int)ws.scores.size();
+    int keep_count = count == 0 ? 0
+                                : nms_run(nms_mode, count, ws.boxes.data(), ws.scores.data(), ws.class_ids.data(),
+                                          nms_threshold, OBJ_NUMB_MAX_SIZE, ws.keep, TILE_NMS_CELL, ws.nms);
+    merged->count = keep_count;
+    for (int i = 0; i < keep_count; i++)
+    {
+        int n = ws.keep[i];
+        detect_result_t &out = merged->results[i];
+        out = *ws.sources[n];
+        out.box.left = (int)ws.boxes[n * 4 + 0];
+        out.box.top = (int)ws.boxes[n * 4 + 1];
+        out.box.right = out.box.left + (int)ws.boxes[n * 4 + 2];
+        out.box.bottom = out.box.top + (int)ws.boxes[n * 4 + 3];
+    }
+    return keep_count;
+}
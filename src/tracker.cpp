@@ -0,0 +1,486 @@
+/*
+ * @Author: Li RF
+ * @Date: 2025-04-21 14:26:09
+ * @LastEditors: Li RF
+ * @LastEditTime: 2025-04-21 14:26:09
+ * @Description: 多目标跟踪（ByteTrack）：SoA 卡尔曼滤波、IoU 矩阵与贪心 / 匈牙利分配
+ * Email: 1125962926@qq.com
+ * Copyright (c) 2025 Li RF, All Rights Reserved.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <numeric>
+
+#include "SharedTypes.hpp"
+#include "tracker.h"
+
+/* 位置与速度的过程噪声标准差相对框高的比例（与 ByteTrack 相同） */
+#define TRACK_STD_POS (1.f / 20)
+#define TRACK_STD_VEL (1.f / 160)
+
+Tracker::Tracker(int match_mode, int buffer)
+{
+    this->match_mode = match_mode;
+    this->buffer = std::max(1, buffer);
+}
+
+int Tracker::class_id(const char *name)
+{
+    for (int i = 0; i < (int)names.size(); i++)
+        if (strncmp(names[i].c_str(), name, OBJ_NAME_MAX_SIZE) == 0)
+            return i;
+    names.push_back(std::string(name, strnlen(name, OBJ_NAME_MAX_SIZE)));
+    return (int)names.size() - 1;
+}
+
+/**
+ * @Description: 全部轨迹预测一步：x += v，P = F P F^T + Q，每个维度的 2x2 块独立，按轨迹连续计算
+ * @return {*}
+ */
+void Tracker::predict()
+{
+    int n = size();
+    // 没有跟踪上的轨迹不再延续高度变化（与 ByteTrack 相同）
+    for (int i = 0; i < n; i++)
+        if (state[i] != TRACK_STATE::TRACK_TRACKED)
+            vel[3][i] = 0.f;
+    // 噪声按预测前的框高计算，先取出再更新高度本身
+    const float *h = pos[3].data();
+    for (int d = 0; d < 4; d++)
+    {
+        float *x = pos[d].data(), *v = vel[d].data();
+        float *a00 = p00[d].data(), *a01 = p01[d].data(), *a11 = p11[d].data();
+        bool aspect = d == 2;
+        for (int i = 0; i < n; i++)
+        {
+            float hp = TRACK_STD_POS * h[i], hv = TRACK_STD_VEL * h[i];
+            float qp = aspect ? 1e-4f : hp * hp;
+            float qv = aspect ? 1e-10f : hv * hv;
+            x[i] += v[i];
+            a00[i] += 2.f * a01[i] + a11[i] + qp;
+            a01[i] += a11[i];
+            a11[i] += qv;
+        }
+    }
+}
+
+/**
+ * @Description: 用匹配上的检测更新轨迹 t（H = [I 0]，逐维度的标量卡尔曼增益）
+ * @return {*}
+ */
+void Tracker::correct(int t, const detect_result_t &det)
+{
+    float w = (float)(det.box.right - det.box.left);
+    float bh = std::max(1.f, (float)(det.box.bottom - det.box.top));
+    float z[4] = {det.box.left + w * 0.5f, det.box.top + bh * 0.5f, w / bh, bh};
+    float hr = TRACK_STD_POS * pos[3][t];
+    for (int d = 0; d < 4; d++)
+    {
+        float r = d == 2 ? 1e-2f : hr * hr;
+        float s = p00[d][t] + r;
+        float k0 = p00[d][t] / s, k1 = p01[d][t] / s;
+        float y = z[d] - pos[d][t];
+        pos[d][t] += k0 * y;
+        vel[d][t] += k1 * y;
+        p11[d][t] -= k1 * p01[d][t];
+        p01[d][t] *= 1.f - k0;
+        p00[d][t] *= 1.f - k0;
+    }
+    last_frame[t] = frame;
+}
+
+void Tracker::add_track(const detect_result_t &det, int c, bool confirmed)
+{
+    float w = (float)(det.box.right - det.box.left);
+    float bh = std::max(1.f, (float)(det.box.bottom - det.box.top));
+    float z[4] = {det.box.left + w * 0.5f, det.box.top + bh * 0.5f, w / bh, bh};
+    float hp = 2.f * TRACK_STD_POS * bh, hv = 10.f * TRACK_STD_VEL * bh;
+    for (int d = 0; d < 4; d++)
+    {
+        pos[d].push_back(z[d]);
+        vel[d].push_back(0.f);
+        p00[d].push_back(d == 2 ? 1e-4f : hp * hp);
+        p01[d].push_back(0.f);
+        p11[d].push_back(d == 2 ? 1e-10f : hv * hv);
+    }
+    id.push_back(confirmed ? next_id++ : -1);
+    state.push_back(confirmed ? TRACK_STATE::TRACK_TRACKED : TRACK_STATE::TRACK_TENTATIVE);
+    cls.push_back(c);
+    last_frame.push_back(frame);
+}
+
+/**
+ * @Description: 删除上一帧新建但本帧没有确认的轨迹，以及丢失超过 buffer 帧的轨迹，保持 SoA 数组连续
+ * @return {*}
+ */
+void Tracker::remove_tracks()
+{
+    int n = size(), kept = 0;
+    for (int i = 0; i < n; i++)
+    {
+        if ((state[i] == TRACK_STATE::TRACK_TENTATIVE && last_frame[i] < frame) ||
+            (state[i] == TRACK_STATE::TRACK_LOST && frame - last_frame[i] > buffer))
+            continue;
+        if (kept != i) {
+            for (int d = 0; d < 4; d++)
+            {
+                pos[d][kept] = pos[d][i];
+                vel[d][kept] = vel[d][i];
+                p00[d][kept] = p00[d][i];
+                p01[d][kept] = p01[d][i];
+                p11[d][kept] = p11[d][i];
+            }
+            id[kept] = id[i];
+            state[kept] = state[i];
+            cls[kept] = cls[i];
+            last_frame[kept] = last_frame[i];
+        }
+        kept++;
+    }
+    for (int d = 0; d < 4; d++)
+    {
+        pos[d].resize(kept);
+        vel[d].resize(kept);
+        p00[d].resize(kept);
+        p01[d].resize(kept);
+        p11[d].resize(kept);
+    }
+    id.resize(kept);
+    state.resize(kept);
+    cls.resize(kept);
+    last_frame.resize(kept);
+}
+
+void Tracker::associate(const std::vector<int> &tracks, const std::vector<int> &dets, float min_iou)
+{
+    int rows = (int)tracks.size(), cols = (int)dets.size();
+    ws.row_match.assign(rows, -1);
+    ws.col_match.assign(cols, -1);
+    if (rows == 0 || cols == 0)
+        return;
+
+    // 取出参与关联的轨迹的预测框，连续存放
+    ws.tx1.reserve(rows);
+    ws.ty1.reserve(rows);
+    ws.tx2.reserve(rows);
+    ws.ty2.reserve(rows);
+    ws.tarea.reserve(rows);
+    ws.tcls.reserve(rows);
+    for (int r = 0; r < rows; r++)
+    {
+        int t = tracks[r];
+        float h = std::max(1.f, pos[3][t]), w = std::max(0.f, pos[2][t]) * h;
+        ws.tx1[r] = pos[0][t] - w * 0.5f;
+        ws.ty1[r] = pos[1][t] - h * 0.5f;
+        ws.tx2[r] = pos[0][t] + w * 0.5f;
+        ws.ty2[r] = pos[1][t] + h * 0.5f;
+        ws.tarea[r] = w * h;
+        ws.tcls[r] = cls[t];
+    }
+
+    // IoU 矩阵：每个检测一行，内层对轨迹的循环只有 min/max 和选择，编译器可向量化；不同类别为 0
+    ws.iou.reserve((size_t)rows * cols);
+    const float *tx1 = ws.tx1.data(), *ty1 = ws.ty1.data(), *tx2 = ws.tx2.data(), *ty2 = ws.ty2.data();
+    const float *tarea = ws.tarea.data();
+    const int *tcls = ws.tcls.data();
+    for (int c = 0; c < cols; c++)
+    {
+        int d = dets[c];
+        float bx1 = dx1[d], by1 = dy1[d], bx2 = dx2[d], by2 = dy2[d];
+        float barea = (bx2 - bx1) * (by2 - by1);
+        int bcls = dcls[d];
+        float *row = ws.iou.data() + (size_t)c * rows;
+        for (int r = 0; r < rows; r++)
+        {
+            float iw = std::max(0.f, std::min(bx2, tx2[r]) - std::max(bx1, tx1[r]));
+            float ih = std::max(0.f, std::min(by2, ty2[r]) - std::max(by1, ty1[r]));
+            float inter = iw * ih;
+            float uni = barea + tarea[r] - inter;
+            float v = uni > 0.f ? inter / uni : 0.f;
+            row[r] = tcls[r] == bcls ? v : 0.f;
+        }
+    }
+
+    if (match_mode == TRACK_MODE::TRACK_HUNGARIAN)
+        assign_hungarian(rows, cols, min_iou);
+    else
+        assign_greedy(rows, cols, min_iou);
+}
+
+/**
+ * @Description: 贪心分配：满足 IoU 阈值的匹配对按 IoU 降序依次选取
+ * @return {*}
+ */
+void Tracker::assign_greedy(int rows, int cols, float min_iou)
+{
+    ws.pairs.clear();
+    const float *iou = ws.iou.data();
+    for (int i = 0; i < rows * cols; i++)
+        if (iou[i] >= min_iou)
+            ws.pairs.push_back({iou[i], i});
+    // IoU 相同时按下标，结果与顺序无关
+    std::sort(ws.pairs.begin(), ws.pairs.end(), [](const std::pair<float, int> &a, const std::pair<float, int> &b) {
+        return a.first > b.first || (a.first == b.first && a.second < b.second);
+    });
+    for (const auto &pr : ws.pairs)
+    {
+        int c = pr.second / rows, r = pr.second % rows;
+        if (ws.row_match[r] < 0 && ws.col_match[c] < 0) {
+            ws.row_match[r] = c;
+            ws.col_match[c] = r;
+        }
+    }
+}
+
+/**
+ * @Description: 匈牙利分配：满足 IoU 阈值的匹配对构成二分图，按连通分量分别求最小代价分配
+ *               代价为 1 - IoU，不满足阈值的为 1 - min_iou，等价于不匹配，结果使 Σ(IoU - min_iou) 最大
+ *               场景中目标互不重叠时分量都很小，大量轨迹下耗时接近线性
+ * @return {*}
+ */
+void Tracker::assign_hungarian(int rows, int cols, float min_iou)
+{
+    const float *iou = ws.iou.data();
+    // 并查集：行为 0..rows-1，列为 rows..rows+cols-1
+    std::vector<int> &parent = ws.parent;
+    parent.resize(rows + cols);
+    std::iota(parent.begin(), parent.end(), 0);
+    auto find = [&parent](int x) {
+        while (parent[x] != x)
+            x = parent[x] = parent[parent[x]];
+        return x;
+    };
+    bool any = false;
+    for (int c = 0; c < cols; c++)
+        for (int r = 0; r < rows; r++)
+            if (iou[(size_t)c * rows + r] >= min_iou) {
+                parent[find(r)] = find(rows + c);
+                any = true;
+            }
+    if (!any)
+        return;
+
+    // 按根节点排序，同一分量的节点相邻
+    std::vector<int> &order = ws.order;
+    order.resize(rows + cols);
+    std::iota(order.begin(), order.end(), 0);
+    for (int i = 0; i < rows + cols; i++)
+        parent[i] = find(i);
+    std::sort(order.begin(), order.end(), [&parent](int a, int b) {
+        return parent[a] < parent[b] || (parent[a] == parent[b] && a < b);
+    });
+
+    std::vector<int> &way = ws.way, &p = ws.p;
+    for (size_t begin = 0; begin < order.size();)
+    {
+        size_t end = begin;
+        ws.comp_rows.clear();
+        ws.comp_cols.clear();
+        while (end < order.size() && parent[order[end]] == parent[order[begin]])
+        {
+            if (order[end] < rows)
+                ws.comp_rows.push_back(order[end]);
+            else
+                ws.comp_cols.push_back(order[end] - rows);
+            end++;
+        }
+        begin = end;
+        if (ws.comp_rows.empty() || ws.comp_cols.empty())
+            continue;
+        if (ws.comp_rows.size() == 1 && ws.comp_cols.size() == 1) {
+            ws.row_match[ws.comp_rows[0]] = ws.comp_cols[0];
+            ws.col_match[ws.comp_cols[0]] = ws.comp_rows[0];
+            continue;
+        }
+
+        // 行数不多于列数，必要时转置
+        bool transpose = ws.comp_rows.size() > ws.comp_cols.size();
+        const std::vector<int> &ri = transpose ? ws.comp_cols : ws.comp_rows;
+        const std::vector<int> &ci = transpose ? ws.comp_rows : ws.comp_cols;
+        int n = (int)ri.size(), m = (int)ci.size();
+        auto cost = [&](int i, int j) {
+            int r = transpose ? ci[j] : ri[i], c = transpose ? ri[i] : ci[j];
+            float v = iou[(size_t)c * rows + r];
+            return v >= min_iou ? 1.0 - v : 1.0 - min_iou;
+        };
+        // 最短增广路（势函数）实现，下标从 1 开始，p[j] 为列 j 匹配的行
+        const double INF = 1e18;
+        ws.u.assign(n + 1, 0.0);
+        ws.v.assign(m + 1, 0.0);
+        p.assign(m + 1, 0);
+        way.assign(m + 1, 0);
+        for (int i = 1; i <= n; i++)
+        {
+            p[0] = i;
+            int j0 = 0;
+            ws.minv.assign(m + 1, INF);
+            ws.used.assign(m + 1, 0);
+            do {
+                ws.used[j0] = 1;
+                int i0 = p[j0], j1 = 0;
+                double delta = INF;
+                for (int j = 1; j <= m; j++)
+                {
+                    if (ws.used[j])
+                        continue;
+                    double cur = cost(i0 - 1, j - 1) - ws.u[i0] - ws.v[j];
+                    if (cur < ws.minv[j]) {
+                        ws.minv[j] = cur;
+                        way[j] = j0;
+                    }
+                    if (ws.minv[j] < delta) {
+                        delta = ws.minv[j];
+                        j1 = j;
+                    }
+                }
+                for (int j = 0; j <= m; j++)
+                {
+                    if (ws.used[j]) {
+                        ws.u[p[j]] += delta;
+                        ws.v[j] -= delta;
+                    }
+                    else {
+                        ws.minv[j] -= delta;
+                    }
+                }
+                j0 = j1;
+            } while (p[j0] != 0);
+            do {
+                int j1 = way[j0];
+                p[j0] = p[j1];
+                j0 = j1;
+            } while (j0);
+        }
+        // 只保留满足阈值的匹配
+        for (int j = 1; j <= m; j++)
+        {
+            if (p[j] == 0)
+                continue;
+            int r = transpose ? ci[j - 1] : ri[p[j] - 1], c = transpose ? ri[p[j] - 1] : ci[j - 1];
+            if (iou[(size_t)c * rows + r] >= min_iou) {
+                ws.row_match[r] = c;
+                ws.col_match[c] = r;
+            }
+        }
+    }
+}
+
+int Tracker::update(detect_result_t *dets, int count)
+{
+    auto begin = std::chrono::steady_clock::now();
+    frame++;
+
+    // 检测分组：高分、低分，更低的不参与
+    dx1.resize(count);
+    dy1.resize(count);
+    dx2.resize(count);
+    dy2.resize(count);
+    dcls.resize(count);
+    high.clear();
+    low.clear();
+    for (int i = 0; i < count; i++)
+    {
+        detect_result_t &det = dets[i];
+        det.track_id = -1;
+        dx1[i] = (float)det.box.left;
+        dy1[i] = (float)det.box.top;
+        dx2[i] = (float)det.box.right;
+        dy2[i] = (float)det.box.bottom;
+        dcls[i] = class_id(det.name);
+        if (det.prop >= TRACK_HIGH_THRESH)
+            high.push_back(i);
+        else if (det.prop >= TRACK_LOW_THRESH)
+            low.push_back(i);
+    }
+
+    predict();
+    int n = size();
+    matched.assign(n, 0);
+
+    // 第一阶段：高分检测与已确认的轨迹（跟踪中和丢失的）
+    cand.clear();
+    for (int t = 0; t < n; t++)
+        if (state[t] != TRACK_STATE::TRACK_TENTATIVE)
+            cand.push_back(t);
+    associate(cand, high, TRACK_IOU_HIGH);
+    for (int r = 0; r < (int)cand.size(); r++)
+    {
+        int c = ws.row_match[r];
+        if (c < 0)
+            continue;
+        int t = cand[r], d = high[c];
+        correct(t, dets[d]);
+        state[t] = TRACK_STATE::TRACK_TRACKED;
+        matched[t] = 1;
+        dets[d].track_id = id[t];
+    }
+    rest.clear();
+    for (int c = 0; c < (int)high.size(); c++)
+        if (ws.col_match[c] < 0)
+            rest.push_back(high[c]);
+
+    // 第二阶段：低分检测（遮挡、模糊）与剩余的跟踪中轨迹，仍未匹配的轨迹转为丢失
+    cand.clear();
+    for (int t = 0; t < n; t++)
+        if (state[t] == TRACK_STATE::TRACK_TRACKED && !matched[t])
+            cand.push_back(t);
+    associate(cand, low, TRACK_IOU_LOW);
+    for (int r = 0; r < (int)cand.size(); r++)
+    {
+        int c = ws.row_match[r], t = cand[r];
+        if (c < 0) {
+            state[t] = TRACK_STATE::TRACK_LOST;
+            continue;
+        }
+        correct(t, dets[low[c]]);
+        matched[t] = 1;
+        dets[low[c]].track_id = id[t];
+    }
+
+    // 第三阶段：上一帧新建的轨迹与剩余高分检测，匹配上的确认并分配编号
+    cand.clear();
+    for (int t = 0; t < n; t++)
+        if (state[t] == TRACK_STATE::TRACK_TENTATIVE)
+            cand.push_back(t);
+    associate(cand, rest, TRACK_IOU_TENTATIVE);
+    for (int r = 0; r < (int)cand.size(); r++)
+    {
+        int c = ws.row_match[r];
+        if (c < 0)
+            continue;
+        int t = cand[r], d = rest[c];
+        correct(t, dets[d]);
+        state[t] = TRACK_STATE::TRACK_TRACKED;
+        id[t] = next_id++;
+        dets[d].track_id = id[t];
+    }
+
+    // 仍未匹配的高分检测新建轨迹，第一帧直接确认
+    for (int c = 0; c < (int)rest.size(); c++)
+    {
+        int d = rest[c];
+        if (ws.col_match[c] >= 0 || dets[d].prop < TRACK_NEW_THRESH)
+            continue;
+        add_track(dets[d], dcls[d], frame == 1);
+        dets[d].track_id = id.back();
+    }
+    remove_tracks();
+
+    int tracked = 0;
+    for (int t = 0; t < size(); t++)
+        tracked += state[t] == TRACK_STATE::TRACK_TRACKED && id[t] >= 0;
+    frames++;
+    total_us += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - begin).count();
+    return tracked;
+}
+
+void Tracker::report() const
+{
+    if (frames == 0)
+        return;
+    printf("tracker: %s, frames: %lld, ids: %d, active tracks: %d, %.1f us/frame\n",
+           match_mode == TRACK_MODE::TRACK_HUNGARIAN ? "hungarian" : "greedy", frames, next_id, (int)id.size(),
+           total_us / frames);
+}